@@ -0,0 +1,29 @@
+#ifndef __RECORDER_CALL_SITES_H_
+#define __RECORDER_CALL_SITES_H_
+#include <stdint.h>
+#include "recorder-logger.h"
+
+/*
+ * Call sites of intercepted calls (RECORDER_CALL_SITES).
+ *
+ * The return addresses of up to N frames, innermost first,
+ * are taken by walking the frame pointer chain from the
+ * wrapper; the walk stops early at a frame without a frame
+ * pointer. Each distinct tuple is interned to a small id,
+ * from 1 in the order first seen, which is what the call
+ * signature carries (see compose_cs_key()).
+ *
+ * At finalize time each rank writes its stack table and a
+ * copy of /proc/self/maps, for the reader to symbolize the
+ * addresses:
+ *   <rank>.stk:  uint32 count, then per id: uint8 depth, depth * uint64
+ *   <rank>.maps: /proc/self/maps
+ */
+
+#define CALL_SITES_MAX_DEPTH    16
+
+void     call_sites_init(int depth);
+uint32_t call_sites_capture(void* frame);
+void     call_sites_finalize(RecorderLogger* logger);
+
+#endif
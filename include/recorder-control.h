@@ -0,0 +1,42 @@
+#ifndef __RECORDER_CONTROL_H
+#define __RECORDER_CONTROL_H
+
+/*
+ * Runtime control of tracing, for applications.
+ *
+ * recorder_pause() and recorder_resume() bracket code whose
+ * calls should not be traced, e.g., warm-up or setup I/O.
+ * They apply to all threads and nest: tracing resumes at the
+ * resume() matching the outermost pause().
+ *
+ * recorder_region_begin() and recorder_region_end() mark
+ * application phases. Regions nest per thread; end() closes
+ * the innermost open region of the calling thread. Both are
+ * stored as records (also while paused), so the reader can
+ * slice the trace by phase, see recorder_region_marker() in
+ * tools/reader.h.
+ *
+ * Link with -lrecorder, or declare the functions weak if the
+ * application should also run without Recorder.
+ *
+ * Fortran:
+ *   call recorder_pause()
+ *   call recorder_resume()
+ *   call recorder_region_begin("solve")
+ *   call recorder_region_end()
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void recorder_pause(void);
+void recorder_resume(void);
+void recorder_region_begin(const char* name);
+void recorder_region_end(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RECORDER_CONTROL_H */
@@ -0,0 +1,52 @@
+#ifndef __RECORDER_CS_TABLE_H
+#define __RECORDER_CS_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct CallSignature_t;
+
+/**
+ * Call Signature Table (CST)
+ *
+ * Open-addressing hash table with linear probing.
+ * Each slot stores the 64-bit hash of the key and the index
+ * of the entry, so probing compares hashes only and the key
+ * is compared (memcmp) only when the hashes are equal.
+ *
+ * The hash is computed once per key (see cs_key_hash()) and
+ * stored in the entry, it is reused when growing the table,
+ * and when CSTs are merged at finalize time.
+ *
+ * Entries are kept in insertion order, so iterating over
+ * them gives the same order on every rank for the same
+ * sequence of calls.
+ */
+typedef struct CSTable_t {
+    uint64_t* slot_hashes;
+    int*      slot_indices;         // index into entries, -1 if empty
+    int       num_slots;            // always a power of 2
+    struct CallSignature_t** entries;
+    int       num_entries;
+    int       max_entries;
+} CSTable;
+
+/* 64-bit hash of a key (wyhash-style multiply-mix) */
+uint64_t cs_hash64(const void* data, size_t len);
+
+void cs_table_init(CSTable* table);
+/* Free the table, but not the entries (see cleanup_cst()) */
+void cs_table_destroy(CSTable* table);
+
+/* Return the entry with the given key, or NULL */
+struct CallSignature_t* cs_table_find(CSTable* table, const void* key, int key_len, uint64_t hash);
+
+/* Add a new entry, entry->hash must already be set */
+void cs_table_add(CSTable* table, struct CallSignature_t* entry);
+
+/* Replace the key of an existing entry (position in insertion order is kept) */
+void cs_table_rekey(CSTable* table, struct CallSignature_t* entry, void* new_key, int new_key_len);
+
+#define cs_table_count(table) ((table)->num_entries)
+
+#endif
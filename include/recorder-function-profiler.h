@@ -0,0 +1,8 @@
+#ifndef __RECORDER_FUNCTION_PROFILER_H_
+#define __RECORDER_FUNCTION_PROFILER_H_
+#include "recorder-logger.h"
+
+void function_profiler_init();
+void function_profiler_finalize(RecorderLogger* logger);
+
+#endif
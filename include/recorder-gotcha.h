@@ -2,9 +2,16 @@
 #define __RECORDER_GOTCHA_H
 #include <sys/uio.h>
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <dirent.h>
 #include <utime.h>
+#include <aio.h>
+#include <signal.h>
 #include <stdbool.h>
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
 #include "mpi.h"
 #include "hdf5.h"
 #include "gotcha/gotcha.h"
@@ -25,6 +32,8 @@ bool gotcha_posix_tracing();
 bool gotcha_mpi_tracing();
 bool gotcha_mpiio_tracing();
 bool gotcha_hdf5_tracing();
+bool gotcha_async_tracing();
+bool gotcha_func_traced(int func_id);     // wrapped, i.e., its layer is on and it was selected
 
 
 /**
@@ -85,6 +94,9 @@ bool gotcha_hdf5_tracing();
             intercept = gotcha_mpiio_tracing();                         \
         if (func_type == RECORDER_HDF5)                                \
             intercept = gotcha_hdf5_tracing();                         \
+        /* not wrapped if excluded by RECORDER_FUNCTION_EXCLUSION */    \
+        if (WRAPPEE_HANDLE(func) == NULL)                               \
+            intercept = false;                                          \
         if (intercept) {                                                \
             void* funcptr = gotcha_get_wrappee(WRAPPEE_HANDLE(func));   \
             GOTCHA_REAL_CALL(func) = (WRAPPER_TYPE(func)) (funcptr);    \
@@ -134,6 +146,57 @@ GOTCHA_WRAP(__lxstat64, int, (int vers, const char *path, struct stat64 *buf));
 GOTCHA_WRAP(__fxstat, int, (int vers, int fd, struct stat *buf));
 GOTCHA_WRAP(__fxstat64, int, (int vers, int fd, struct stat64 *buf));
 #endif
+// As of glibc-2.33, they are regular functions
+#if __GLIBC__ == 2 && __GLIBC_MINOR__ >= 33
+GOTCHA_WRAP(stat, int, (const char *path, struct stat *buf));
+GOTCHA_WRAP(stat64, int, (const char *path, struct stat64 *buf));
+GOTCHA_WRAP(lstat, int, (const char *path, struct stat *buf));
+GOTCHA_WRAP(lstat64, int, (const char *path, struct stat64 *buf));
+GOTCHA_WRAP(fstat, int, (int fd, struct stat *buf));
+GOTCHA_WRAP(fstat64, int, (int fd, struct stat64 *buf));
+GOTCHA_WRAP(fstatat, int, (int dirfd, const char *path, struct stat *buf, int flag));
+GOTCHA_WRAP(fstatat64, int, (int dirfd, const char *path, struct stat64 *buf, int flag));
+#endif
+#ifdef HAVE_STATX
+struct statx;
+GOTCHA_WRAP(statx, int, (int dirfd, const char *path, int flags, unsigned int mask, struct statx *buf));
+#endif
+GOTCHA_WRAP(preadv, ssize_t, (int fd, const struct iovec *iov, int iovcnt, off_t offset));
+GOTCHA_WRAP(preadv64, ssize_t, (int fd, const struct iovec *iov, int iovcnt, off64_t offset));
+GOTCHA_WRAP(pwritev, ssize_t, (int fd, const struct iovec *iov, int iovcnt, off_t offset));
+GOTCHA_WRAP(pwritev64, ssize_t, (int fd, const struct iovec *iov, int iovcnt, off64_t offset));
+#ifdef HAVE_PREADV2
+GOTCHA_WRAP(preadv2, ssize_t, (int fd, const struct iovec *iov, int iovcnt, off_t offset, int flags));
+GOTCHA_WRAP(preadv64v2, ssize_t, (int fd, const struct iovec *iov, int iovcnt, off64_t offset, int flags));
+GOTCHA_WRAP(pwritev2, ssize_t, (int fd, const struct iovec *iov, int iovcnt, off_t offset, int flags));
+GOTCHA_WRAP(pwritev64v2, ssize_t, (int fd, const struct iovec *iov, int iovcnt, off64_t offset, int flags));
+#endif
+GOTCHA_WRAP(openat, int, (int dirfd, const char *path, int flags, ...));
+GOTCHA_WRAP(openat64, int, (int dirfd, const char *path, int flags, ...));
+#ifdef HAVE_COPY_FILE_RANGE
+GOTCHA_WRAP(copy_file_range, ssize_t, (int fd_in, off64_t *off_in, int fd_out, off64_t *off_out, size_t len, unsigned int flags));
+#endif
+GOTCHA_WRAP(posix_fadvise, int, (int fd, off_t offset, off_t len, int advice));
+GOTCHA_WRAP(posix_fadvise64, int, (int fd, off64_t offset, off64_t len, int advice));
+/* Asynchronous I/O, see RECORDER_ASYNC_TRACING */
+GOTCHA_WRAP(aio_read, int, (struct aiocb *aiocbp));
+GOTCHA_WRAP(aio_read64, int, (struct aiocb64 *aiocbp));
+GOTCHA_WRAP(aio_write, int, (struct aiocb *aiocbp));
+GOTCHA_WRAP(aio_write64, int, (struct aiocb64 *aiocbp));
+GOTCHA_WRAP(aio_suspend, int, (const struct aiocb *const aiocb_list[], int nitems, const struct timespec *timeout));
+GOTCHA_WRAP(aio_suspend64, int, (const struct aiocb64 *const aiocb_list[], int nitems, const struct timespec *timeout));
+GOTCHA_WRAP(aio_return, ssize_t, (struct aiocb *aiocbp));
+GOTCHA_WRAP(aio_return64, ssize_t, (struct aiocb64 *aiocbp));
+// io_uring_wait_cqe() and io_uring_peek_cqe() are inline,
+// the former ends up in __io_uring_get_cqe() if it has to wait
+#ifdef HAVE_LIBURING
+GOTCHA_WRAP(io_uring_submit, int, (struct io_uring *ring));
+GOTCHA_WRAP(io_uring_submit_and_wait, int, (struct io_uring *ring, unsigned wait_nr));
+GOTCHA_WRAP(__io_uring_get_cqe, int, (struct io_uring *ring, struct io_uring_cqe **cqe_ptr, unsigned submit, unsigned wait_nr, sigset_t *sigmask));
+GOTCHA_WRAP(io_uring_wait_cqes, int, (struct io_uring *ring, struct io_uring_cqe **cqe_ptr, unsigned wait_nr, struct __kernel_timespec *ts, sigset_t *sigmask));
+GOTCHA_WRAP(io_uring_wait_cqe_timeout, int, (struct io_uring *ring, struct io_uring_cqe **cqe_ptr, struct __kernel_timespec *ts));
+GOTCHA_WRAP(io_uring_peek_batch_cqe, unsigned, (struct io_uring *ring, struct io_uring_cqe **cqes, unsigned count));
+#endif
 /* Other POSIX Function Calls, not directly related to I/O */
 // Files and Directories
 GOTCHA_WRAP(getcwd, char*, (char *buf, size_t size));
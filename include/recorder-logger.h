@@ -11,6 +11,7 @@
 #include <inttypes.h>
 #endif
 #include "recorder-sequitur.h"
+#include "recorder-cs-table.h"
 #include "uthash.h"
 
 /**
@@ -19,7 +20,7 @@
  * major.minor guarantees compatibility
  */
 #define RECORDER_VERSION_MAJOR  2
-#define RECORDER_VERSION_MINOR  5
+#define RECORDER_VERSION_MINOR  7
 #define RECORDER_VERSION_PATCH  2
 
 #define RECORDER_POSIX          0
@@ -27,8 +28,18 @@
 #define RECORDER_MPI            2
 #define RECORDER_HDF5           3
 #define RECORDER_FTRACE         4
+#define RECORDER_MARKER         5       // recorder_pause() etc., see recorder-control.h
 
-#define RECORDER_USER_FUNCTION  255
+#define RECORDER_USER_FUNCTION  0xFFFF  // names in args[0] (object) and args[1] (symbol)
+
+// Upper bound of the ids of func_list below,
+// tables indexed by function id use this size
+#define RECORDER_MAX_FUNCS      512
+
+// User functions get ids of their own at runtime, above
+// func_list, their names are saved in recorder.sym
+#define RECORDER_USER_FUNCTION_START    RECORDER_MAX_FUNCS
+#define RECORDER_MAX_USER_FUNCS         (RECORDER_USER_FUNCTION - RECORDER_USER_FUNCTION_START)
 
 
 
@@ -36,11 +47,12 @@
 typedef struct Record_t {
     double tstart, tend;
     unsigned char call_depth;
-    unsigned char func_id;      // we have about 200 functions in total
+    uint16_t func_id;           // index into func_list, a user function id, or RECORDER_USER_FUNCTION
     unsigned char arg_count;
     char **args;                // Store all arguments in array
-    pthread_t tid;
-    void* res;                  // return value
+    pthread_t tid;              // 0 if not stored, a thread index with only intraprocess pattern recognition
+    int64_t res;                // return value, integers and pointers are stored as is
+    uint32_t stack_id;          // interned call site, 0 if none, see recorder-call-sites.h
 
     void* record_stack;         // per-thread record stack of cascading calls
     struct Record_t *prev, *next;
@@ -56,7 +68,7 @@ typedef struct CallSignature_t {
     int rank;
     int terminal_id;
     int count;
-    UT_hash_handle hh;
+    uint64_t hash;      // cs_key_hash(key, key_len), computed once
 } CallSignature;
 
 
@@ -75,6 +87,12 @@ typedef struct RecorderMetadata_t {
     bool   interprocess_compression;    // interprocess compression of cst/cfg
     bool   interprocess_pattern_recognition;
     bool   intraprocess_pattern_recognition;
+    bool   ts_prediction;               // whether timestamps are stored as residuals of a per-terminal prediction
+    bool   relative_peers;              // whether point-to-point peers are stored relative to the caller
+    bool   value_streams;               // whether value fields are stored in a stream after the timestamps
+    bool   return_values;               // whether byte count returns are stored in that stream
+    uint8_t call_sites;                 // frames per call site, 0 if none were captured
+    uint8_t traced_funcs[RECORDER_MAX_FUNCS/8]; // bit i set if func_list[i] was wrapped
 } RecorderMetadata;
 
 
@@ -91,7 +109,7 @@ typedef struct RecorderLogger_t {
     int current_cfg_terminal;
 
     Grammar        cfg;
-    CallSignature* cst;
+    CSTable        cst;
 
     char traces_dir[512];
     char cst_path[1024];
@@ -105,12 +123,21 @@ typedef struct RecorderLogger_t {
     int       ts_max_elements;  // max elements can be stored in the buffer
     double    ts_resolution;
     bool      ts_compression;
+    bool      ts_prediction;    // store residuals of per-terminal predicted gap/duration
+
+    bool      value_streams;    // move value fields (offsets, counts) out of signatures
+    bool      return_values;    // store byte count returns in the value stream
+    uint32_t* vs;               // memory buffer for the value stream
+    int       vs_index;
+    int       vs_max_elements;
 
     bool      store_tid;            // Wether to store thread id
     bool      store_call_depth;     // Wether to store the call depth
     bool      interprocess_compression; // Wether to perform interprocess compression of cst/cfg
     bool      interprocess_pattern_recognition; 
     bool      intraprocess_pattern_recognition; 
+    bool      relative_peers;       // Wether to store point-to-point peers relative to the caller
+    int       call_sites;           // frames per call site, 0 to capture none
 } RecorderLogger;
 
 
@@ -124,8 +151,13 @@ void logger_finalize();
 bool logger_initialized();
 void logger_record_enter(Record *record);
 void logger_record_exit(Record *record);
+void logger_pause();
+void logger_resume();
+bool logger_paused();
+bool logger_tracing();
 bool logger_intraprocess_pattern_recognition();
 bool logger_interprocess_pattern_recognition();
+bool logger_relative_peers();
 
 void free_record(Record *record);
 // TODO only used by ftrace logger
@@ -135,11 +167,12 @@ void write_record(Record* record);
 
 /* recorder-cst-cfg.c */
 int  cs_key_args_start();
-int  cs_key_args_strlen(Record* record);
-int  cs_key_length(Record* record);
-char* compose_cs_key(Record *record, int* key_len);
+int  cs_key_args_end(CallSignature* cs);
+uint64_t cs_key_hash(const void* key, int key_len);
+char* compose_cs_key(Record *record, int* key_len, uint64_t* hash);
+bool  cs_key_matches_record(CallSignature* cs, Record* record);
 Record* cs_to_record(CallSignature* cs);
-void cleanup_cst(CallSignature* cst);
+void cleanup_cst(CSTable* cst);
 void save_cst_local(RecorderLogger* logger);
 void save_cst_merged(RecorderLogger* logger);
 void save_cfg_local(RecorderLogger* logger);
@@ -149,7 +182,7 @@ void save_cfg_merged(RecorderLogger* logger);
 
 
 static const char* func_list[] = {
-    // POSIX I/O - 72 functions
+    // POSIX I/O - 95 functions
     "creat",        "creat64",      "open",         "open64",   "close",
     "write",        "read",         "lseek",        "lseek64",  "pread",
     "pread64",      "pwrite",       "pwrite64",     "readv",    "writev",
@@ -165,6 +198,16 @@ static const char* func_list[] = {
     "fdopen",       "fileno",       "access",       "faccessat","tmpfile",
     "remove",       "truncate",     "ftruncate",    "msync",
     "fseeko",       "ftello",       "fflush",
+    // stat family of glibc >= 2.33, vectored and *at() I/O
+    "stat",         "lstat",        "fstat",        "fstatat",  "statx",
+    "preadv",       "pwritev",      "preadv2",      "pwritev2", "openat",
+    "copy_file_range",              "posix_fadvise",
+    // POSIX AIO and io_uring (liburing)
+    "aio_read",     "aio_write",    "aio_suspend",  "aio_return",
+    "io_uring_submit",              "io_uring_submit_and_wait",
+    "io_uring_wait_cqe",            "io_uring_wait_cqes",
+    "io_uring_wait_cqe_timeout",    "io_uring_peek_batch_cqe",
+    "io_uring_complete",            // written by the tracer, see lib/recorder-posix.c
 
 
     // MPI 84 functions
@@ -211,6 +254,9 @@ static const char* func_list[] = {
     "MPI_Igather",                 "MPI_Ialltoall",
     // Added 2021/01/25
     "MPI_Comm_free",               "MPI_Cart_sub",            "MPI_Comm_split_type",
+    // Not an MPI function, written when a nonblocking
+    // MPI-IO request completes (see lib/recorder-mpi.c)
+    "MPI_File_request_complete",
 
     // HDF5 I/O - 74 functions
     "H5Fcreate",            "H5Fopen",              "H5Fclose",     "H5Fflush", // File interface
@@ -239,7 +285,12 @@ static const char* func_list[] = {
     "H5Oclose",              "H5Oget_info",                         // Object interface
     "H5Oget_info_by_name",   "H5Oopen",
     "H5Pset_coll_metadata_write",                   "H5Pget_coll_metadata_write",   // collective metadata
-    "H5Pset_all_coll_metadata_ops",                 "H5Pget_all_coll_metadata_ops"
+    "H5Pset_all_coll_metadata_ops",                 "H5Pget_all_coll_metadata_ops",
+
+    // Markers written by the recorder-control.h API,
+    // not wrapped functions (see lib/recorder-control.c)
+    "recorder_pause",       "recorder_resume",
+    "recorder_region_begin","recorder_region_end"
 };
 
 #endif /* __RECORDER_LOGGER_H */
@@ -1,5 +1,10 @@
 #ifndef __RECORDER_PATTERN_RECOGNITION_H_
 #define __RECORDER_PATTERN_RECOGNITION_H_
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
 #include "uthash.h"
 #include "recorder-logger.h"
 
@@ -7,9 +12,44 @@
 typedef int64_t off64_t;
 #endif
 
+/*
+ * Functions that carry an offset argument, the argument
+ * that identifies the file (or dataspace) and the offset
+ * argument itself. The offset argument is either a single
+ * integer or an integer vector "[a,b,...]".
+ *
+ * Shared by the tracer and the reader, so both agree on
+ * what gets delta encoded.
+ */
+static const struct {
+    const char* func;
+    int file_arg_idx;
+    int offset_arg_idx;
+} iopr_offset_funcs[] = {
+    {"lseek", 0, 1},                        {"lseek64", 0, 1},
+    {"pread", 0, 3},                        {"pread64", 0, 3},
+    {"pwrite", 0, 3},                       {"pwrite64", 0, 3},
+    {"preadv", 0, 3},                       {"pwritev", 0, 3},
+    {"preadv2", 0, 3},                      {"pwritev2", 0, 3},
+    {"aio_read", 0, 1},                     {"aio_write", 0, 1},
+    {"MPI_File_set_view", 0, 1},
+    {"MPI_File_read_at", 0, 1},             {"MPI_File_read_at_all", 0, 1},
+    {"MPI_File_write_at", 0, 1},            {"MPI_File_write_at_all", 0, 1},
+    {"MPI_File_iread_at", 0, 1},            {"MPI_File_iwrite_at", 0, 1},
+    {"MPI_File_read_at_all_begin", 0, 1},   {"MPI_File_write_at_all_begin", 0, 1},
+    {"H5Sselect_hyperslab", 0, 2},
+};
+#define IOPR_NUM_OFFSET_FUNCS (sizeof(iopr_offset_funcs)/sizeof(iopr_offset_funcs[0]))
+
+#define IOPR_MAX_DIMS 32        // H5S_MAX_RANK
+
+/*
+ * Previous offset of one (thread, function, file)
+ */
 typedef struct offset_map {
-    char* func;         // key
-    off64_t offset;     // value, this is the previous offset
+    char* key;                          // tid, func id and file argument
+    int   count;                        // 1 for scalars, the rank for vectors
+    int64_t offsets[IOPR_MAX_DIMS];     // the previous offset
     UT_hash_handle hh;
 } offset_map_t;
 
@@ -18,10 +58,130 @@ typedef struct offset_map {
  *
  */
 
+/*
+ * Index into iopr_offset_funcs, -1 if the function
+ * carries no offset.
+ */
+static inline int iopr_offset_func_index(const char* func) {
+    for(int f = 0; f < (int)IOPR_NUM_OFFSET_FUNCS; f++)
+        if(strcmp(func, iopr_offset_funcs[f].func) == 0)
+            return f;
+    return -1;
+}
+
+/*
+ * Parse "123" or "[1,2,3]". Return the number of
+ * integers, or 0 if arg is neither, e.g., "???".
+ */
+static inline int iopr_parse_offsets(const char* arg, int64_t* vals, int* is_vector) {
+    char* end;
+    int count = 0;
+    *is_vector = (arg[0] == '[');
+    const char* p = *is_vector ? arg+1 : arg;
+    while(count < IOPR_MAX_DIMS) {
+        if(*p == 0 || *p == ',' || *p == ']')
+            return 0;
+        vals[count++] = strtoll(p, &end, 10);
+        if(end == p)
+            return 0;
+        p = end;
+        if(!*is_vector)
+            return *p == 0 ? 1 : 0;
+        if(*p == ']')
+            return *(p+1) == 0 ? count : 0;
+        if(*p != ',')
+            return 0;
+        p++;
+    }
+    return 0;
+}
+
+static inline char* iopr_format_offsets(int64_t* vals, int count, int is_vector) {
+    char* str = (char*) calloc(24*count + 3, sizeof(char));
+    if(!is_vector) {
+        sprintf(str, "%lld", (long long)vals[0]);
+        return str;
+    }
+    int pos = 0;
+    str[pos++] = '[';
+    for(int i = 0; i < count; i++)
+        pos += sprintf(str+pos, i == count-1 ? "%lld]" : "%lld,", (long long)vals[i]);
+    return str;
+}
+
+/*
+ * Delta encode (or decode) the offset argument of a record.
+ *
+ * The first offset of every (thread, function, file) is kept
+ * as is, later ones are replaced by the difference to the
+ * previous one. A strided loop thus produces one signature.
+ * The reader applies the same function with decode set, on
+ * the records in the order they were written.
+ *
+ * Returns the new argument (the caller frees the old one),
+ * or NULL if the argument is left unchanged.
+ */
+static inline char* iopr_delta_code(offset_map_t** map, pthread_t tid, uint16_t func_id,
+                                    const char* file, const char* arg, int decode) {
+    int64_t vals[IOPR_MAX_DIMS];
+    int is_vector;
+    int count = iopr_parse_offsets(arg, vals, &is_vector);
+    if(count == 0)
+        return NULL;
+
+    size_t key_len = strlen(file) + 48;
+    char* key = (char*) malloc(key_len);
+    snprintf(key, key_len, "%lu:%d:%s", (unsigned long)tid, func_id, file);
+
+    offset_map_t* entry = NULL;
+    HASH_FIND_STR(*map, key, entry);
+    if(!entry) {
+        entry = (offset_map_t*) malloc(sizeof(offset_map_t));
+        entry->key = key;
+        entry->count = count;
+        memcpy(entry->offsets, vals, sizeof(int64_t)*count);
+        HASH_ADD_KEYPTR(hh, *map, entry->key, strlen(entry->key), entry);
+        return NULL;
+    }
+    free(key);
+
+    // Different rank of a vector, start over
+    if(entry->count != count) {
+        entry->count = count;
+        memcpy(entry->offsets, vals, sizeof(int64_t)*count);
+        return NULL;
+    }
+
+    for(int i = 0; i < count; i++) {
+        if(decode) {
+            vals[i] += entry->offsets[i];
+            entry->offsets[i] = vals[i];
+        } else {
+            int64_t delta = vals[i] - entry->offsets[i];
+            entry->offsets[i] = vals[i];
+            vals[i] = delta;
+        }
+    }
+    return iopr_format_offsets(vals, count, is_vector);
+}
+
+static inline void iopr_free_offset_map(offset_map_t** map) {
+    offset_map_t *entry, *tmp;
+    HASH_ITER(hh, *map, entry, tmp) {
+        HASH_DEL(*map, entry);
+        free(entry->key);
+        free(entry);
+    }
+    *map = NULL;
+}
+
 // intraprocess
-off64_t iopr_intraprocess(const char* func, off64_t offset);
+void    iopr_intraprocess(Record* record);
+void    iopr_intraprocess_finalize();
 
 // interprocess
+void    iopr_escape_args(RecorderLogger* logger);
 void    iopr_interprocess(RecorderLogger* logger);
+void    iopr_filename_templates(RecorderLogger* logger);
 
 #endif
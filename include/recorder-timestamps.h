@@ -1,9 +1,150 @@
 #ifndef __RECORDER_TIMESTAMPS_H_
 #define __RECORDER_TIMESTAMPS_H_
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include "recorder-logger.h"
 
+/*
+ * Timestamps are stored as uint32_t deltas (in units of
+ * ts_resolution) relative to the tstart of the previous record.
+ *
+ * A delta that does not fit in 32 bits (e.g., more than ~429
+ * seconds of idle time at the default 100ns resolution) is
+ * stored as an escape word followed by the 64-bit delta split
+ * into two uint32_t words (low, high). So one record takes
+ * between 2 and 6 words in the buffer.
+ */
+#define RECORDER_TS_ESCAPE          UINT32_MAX
+#define RECORDER_TS_MAX_RECORD_WORDS 6
+
+static inline int ts_encode_delta(uint32_t* buf, uint64_t delta) {
+    if (delta < RECORDER_TS_ESCAPE) {
+        buf[0] = (uint32_t) delta;
+        return 1;
+    }
+    buf[0] = RECORDER_TS_ESCAPE;
+    buf[1] = (uint32_t) (delta & 0xFFFFFFFF);
+    buf[2] = (uint32_t) (delta >> 32);
+    return 3;
+}
+
+static inline uint64_t ts_decode_delta(uint32_t** buf) {
+    uint32_t* p = *buf;
+    if (p[0] != RECORDER_TS_ESCAPE) {
+        *buf = p + 1;
+        return p[0];
+    }
+    *buf = p + 3;
+    return ((uint64_t)p[2] << 32) | p[1];
+}
+
+/*
+ * Encode the (tstart, tend) pair of one record into buf.
+ * Return the number of uint32_t words written.
+ */
+static inline int ts_encode_record(uint32_t* buf, double tstart, double tend,
+                                   double prev_tstart, double resolution) {
+    uint64_t delta_tstart = (tstart - prev_tstart) / resolution;
+    uint64_t delta_tend   = (tend   - prev_tstart) / resolution;
+    int n = ts_encode_delta(buf, delta_tstart);
+    n += ts_encode_delta(buf+n, delta_tend);
+    return n;
+}
+
+/*
+ * Decode the (tstart, tend) pair of one record and
+ * advance the cursor past it. prev_tstart is updated.
+ */
+static inline void ts_decode_record(uint32_t** cursor, double resolution,
+                                    double* prev_tstart, double* tstart, double* tend) {
+    uint64_t delta_tstart = ts_decode_delta(cursor);
+    uint64_t delta_tend   = ts_decode_delta(cursor);
+    *tstart = delta_tstart * resolution + *prev_tstart;
+    *tend   = delta_tend   * resolution + *prev_tstart;
+    *prev_tstart = *tstart;
+}
+
+/*
+ * Optional predictive coding (RECORDER_TIME_PREDICTION=1)
+ *
+ * In loops, the same call signature tends to have a near
+ * constant duration and a near constant gap from the previous
+ * record. So for each terminal id we predict the gap and the
+ * duration from its last occurrence and only store the
+ * zigzag-encoded residuals (still escaped if they overflow).
+ * Residuals are mostly 0 and compress very well with zlib.
+ *
+ * Terminal ids are remapped by interprocess compression, but
+ * the mapping is one-to-one within a rank, so the reader sees
+ * the same per-terminal history as the tracer did.
+ */
+typedef struct TimestampPredictor_t {
+    int      capacity;          // number of terminals tracked
+    int64_t* last_gap;          // in ts_resolution units
+    int64_t* last_duration;
+} TimestampPredictor;
+
+static inline uint64_t ts_zigzag_encode(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t ts_zigzag_decode(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static inline void ts_predictor_init(TimestampPredictor* pred) {
+    pred->capacity = 0;
+    pred->last_gap = NULL;
+    pred->last_duration = NULL;
+}
+
+static inline void ts_predictor_free(TimestampPredictor* pred) {
+    free(pred->last_gap);
+    free(pred->last_duration);
+    ts_predictor_init(pred);
+}
+
+static inline void ts_predictor_reserve(TimestampPredictor* pred, int terminal_id) {
+    if (terminal_id < pred->capacity)
+        return;
+    int capacity = pred->capacity ? pred->capacity : 256;
+    while (capacity <= terminal_id)
+        capacity *= 2;
+    pred->last_gap      = (int64_t*) realloc(pred->last_gap, capacity*sizeof(int64_t));
+    pred->last_duration = (int64_t*) realloc(pred->last_duration, capacity*sizeof(int64_t));
+    memset(pred->last_gap+pred->capacity, 0, (capacity-pred->capacity)*sizeof(int64_t));
+    memset(pred->last_duration+pred->capacity, 0, (capacity-pred->capacity)*sizeof(int64_t));
+    pred->capacity = capacity;
+}
+
+static inline int ts_encode_record_predicted(uint32_t* buf, TimestampPredictor* pred, int terminal_id,
+                                             double tstart, double tend,
+                                             double prev_tstart, double resolution) {
+    ts_predictor_reserve(pred, terminal_id);
+    int64_t gap      = (int64_t) ((tstart - prev_tstart) / resolution);
+    int64_t duration = (int64_t) ((tend - prev_tstart) / resolution) - gap;
+    int n = ts_encode_delta(buf, ts_zigzag_encode(gap - pred->last_gap[terminal_id]));
+    n += ts_encode_delta(buf+n, ts_zigzag_encode(duration - pred->last_duration[terminal_id]));
+    pred->last_gap[terminal_id] = gap;
+    pred->last_duration[terminal_id] = duration;
+    return n;
+}
+
+static inline void ts_decode_record_predicted(uint32_t** cursor, TimestampPredictor* pred, int terminal_id,
+                                              double resolution, double* prev_tstart,
+                                              double* tstart, double* tend) {
+    ts_predictor_reserve(pred, terminal_id);
+    int64_t gap      = pred->last_gap[terminal_id] + ts_zigzag_decode(ts_decode_delta(cursor));
+    int64_t duration = pred->last_duration[terminal_id] + ts_zigzag_decode(ts_decode_delta(cursor));
+    pred->last_gap[terminal_id] = gap;
+    pred->last_duration[terminal_id] = duration;
+    *tstart = gap * resolution + *prev_tstart;
+    *tend   = (gap + duration) * resolution + *prev_tstart;
+    *prev_tstart = *tstart;
+}
+
 /* 
  * get the per-rank timestamp filename
  */
@@ -1,6 +1,7 @@
 #ifndef __RECORDER_UTILS_H_
 #define __RECORDER_UTILS_H_
 #include <fcntl.h>
+#include <stdint.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <mpi.h>
@@ -19,9 +20,11 @@ char* ptoa(const void* ptr);                    // convert a pointer to string
 char* arrtoa(size_t arr[], int count);          // convert an array of size_t to a string
 char** assemble_args_list(int arg_count, ...);
 const char* get_function_name_by_id(int id);
-unsigned char get_function_id_by_name(const char* name);
+uint16_t get_function_id_by_name(const char* name);
 char* realrealpath(const char* path);           // return the absolute path (mapped to id in string)
 int mkpath(char* file_path, mode_t mode);       // recursive mkdir()
+char** parse_glob_list(const char* list);       // split "a*,b" into a NULL terminated list
+int match_glob_list(char** patterns, const char* name);
 
 
 // recorder send/recv/bcast only handles MPI_BYTE stream
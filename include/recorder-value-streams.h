@@ -0,0 +1,174 @@
+#ifndef __RECORDER_VALUE_STREAMS_H_
+#define __RECORDER_VALUE_STREAMS_H_
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "recorder-timestamps.h"
+
+/*
+ * Value streams
+ *
+ * Arguments that change from call to call (offsets, counts)
+ * give every call its own signature. With value streams enabled,
+ * those arguments are replaced by VS_PLACEHOLDER in the signature
+ * and their values go to a separate per-rank stream instead,
+ * delta coded against the previous value of the same function
+ * and argument, then zigzag coded.
+ *
+ * The same stream also holds the return value of calls that
+ * return a byte (or item) count, coded as the difference to
+ * the requested count, which is 0 unless the transfer was short.
+ *
+ * Like timestamps, the stream holds the values of all records
+ * in the order they were stored, so the reader consumes it
+ * while walking the grammar. It is written right after the
+ * timestamps of the rank in recorder.ts.
+ */
+#define VS_PLACEHOLDER      "#"
+#define VS_MAX_FIELDS       2
+#define VS_MAX_RECORD_WORDS (3*VS_MAX_FIELDS+3) // see ts_encode_delta()
+
+/*
+ * Per-function schema: argument indices of the value fields
+ */
+static const struct {
+    const char* func;
+    int fields[VS_MAX_FIELDS];
+} vs_schemas[] = {
+    {"read",  {2, -1}},                     {"write", {2, -1}},
+    {"pread", {2, 3}},                      {"pread64", {2, 3}},
+    {"pwrite", {2, 3}},                     {"pwrite64", {2, 3}},
+    {"preadv", {1, 3}},                     {"pwritev", {1, 3}},
+    {"preadv2", {1, 3}},                    {"pwritev2", {1, 3}},
+    {"fread", {1, 2}},                      {"fwrite", {1, 2}},
+    {"lseek", {1, -1}},                     {"lseek64", {1, -1}},
+    {"fseek", {1, -1}},                     {"fseeko", {1, -1}},
+    {"aio_read", {1, 2}},                   {"aio_write", {1, 2}},
+    {"MPI_File_read", {2, -1}},             {"MPI_File_write", {2, -1}},
+    {"MPI_File_read_all", {2, -1}},         {"MPI_File_write_all", {2, -1}},
+    {"MPI_File_read_shared", {2, -1}},      {"MPI_File_write_shared", {2, -1}},
+    {"MPI_File_read_ordered", {2, -1}},     {"MPI_File_write_ordered", {2, -1}},
+    {"MPI_File_read_all_begin", {2, -1}},   {"MPI_File_write_all_begin", {2, -1}},
+    {"MPI_File_read_ordered_begin", {2, -1}}, {"MPI_File_write_ordered_begin", {2, -1}},
+    {"MPI_File_iread", {2, -1}},            {"MPI_File_iwrite", {2, -1}},
+    {"MPI_File_iread_shared", {2, -1}},     {"MPI_File_iwrite_shared", {2, -1}},
+    {"MPI_File_read_at", {1, 3}},           {"MPI_File_write_at", {1, 3}},
+    {"MPI_File_read_at_all", {1, 3}},       {"MPI_File_write_at_all", {1, 3}},
+    {"MPI_File_read_at_all_begin", {1, 3}}, {"MPI_File_write_at_all_begin", {1, 3}},
+    {"MPI_File_iread_at", {1, 3}},          {"MPI_File_iwrite_at", {1, 3}},
+    {"MPI_File_seek", {1, -1}},             {"MPI_File_seek_shared", {1, -1}},
+};
+#define VS_NUM_SCHEMAS (sizeof(vs_schemas)/sizeof(vs_schemas[0]))
+
+/*
+ * Functions that return the number of bytes (items for
+ * fread/fwrite) transferred, and the argument with the
+ * requested count, -1 if there is none.
+ */
+static const struct {
+    const char* func;
+    int count_arg;
+} vs_returns[] = {
+    {"read", 2},    {"write", 2},
+    {"pread", 2},   {"pread64", 2},
+    {"pwrite", 2},  {"pwrite64", 2},
+    {"fread", 2},   {"fwrite", 2},
+    {"readv", 1},   {"writev", 1},
+    {"preadv", 1},  {"pwritev", 1},
+    {"preadv2", 1}, {"pwritev2", 1},
+    {"aio_return", -1},
+};
+#define VS_NUM_RETURNS (sizeof(vs_returns)/sizeof(vs_returns[0]))
+
+/*
+ * Previous value of each (function, field)
+ */
+typedef struct ValueStreamState_t {
+    int64_t prev[RECORDER_MAX_FUNCS][VS_MAX_FIELDS];
+} ValueStreamState;
+
+static inline int vs_schema_index(const char* func) {
+    for(int i = 0; i < (int)VS_NUM_SCHEMAS; i++)
+        if(strcmp(func, vs_schemas[i].func) == 0)
+            return i;
+    return -1;
+}
+
+static inline int vs_return_index(const char* func) {
+    for(int i = 0; i < (int)VS_NUM_RETURNS; i++)
+        if(strcmp(func, vs_returns[i].func) == 0)
+            return i;
+    return -1;
+}
+
+static inline int64_t vs_requested_count(int ret_idx, char** args, int arg_count) {
+    int idx = vs_returns[ret_idx].count_arg;
+    if(idx < 0 || idx >= arg_count || !args[idx])
+        return 0;
+    return strtoll(args[idx], NULL, 10);
+}
+
+static inline int vs_encode_return(uint32_t* buf, int ret_idx, int64_t res,
+                                   char** args, int arg_count) {
+    int64_t requested = vs_requested_count(ret_idx, args, arg_count);
+    return ts_encode_delta(buf, ts_zigzag_encode(res - requested));
+}
+
+/*
+ * Must be called after vs_decode_args(),
+ * as it needs the requested count.
+ */
+static inline int64_t vs_decode_return(uint32_t** cursor, int ret_idx,
+                                       char** args, int arg_count) {
+    int64_t requested = vs_requested_count(ret_idx, args, arg_count);
+    return requested + ts_zigzag_decode(ts_decode_delta(cursor));
+}
+
+static inline void vs_state_init(ValueStreamState* state) {
+    memset(state, 0, sizeof(ValueStreamState));
+}
+
+/*
+ * Move the value fields of args into buf, replacing each
+ * by VS_PLACEHOLDER. Fields that are not plain integers,
+ * e.g., "???", stay in the signature.
+ * Returns the number of words written.
+ */
+static inline int vs_encode_args(uint32_t* buf, ValueStreamState* state, int schema,
+                                 uint16_t func_id, char** args, int arg_count) {
+    int n = 0;
+    for(int f = 0; f < VS_MAX_FIELDS; f++) {
+        int idx = vs_schemas[schema].fields[f];
+        if(idx < 0 || idx >= arg_count || !args[idx] || !args[idx][0])
+            continue;
+        char* end;
+        int64_t v = strtoll(args[idx], &end, 10);
+        if(*end != 0)
+            continue;
+        n += ts_encode_delta(buf+n, ts_zigzag_encode(v - state->prev[func_id][f]));
+        state->prev[func_id][f] = v;
+        free(args[idx]);
+        args[idx] = strdup(VS_PLACEHOLDER);
+    }
+    return n;
+}
+
+/*
+ * Fill in the placeholders of args from the stream.
+ */
+static inline void vs_decode_args(uint32_t** cursor, ValueStreamState* state, int schema,
+                                  uint16_t func_id, char** args, int arg_count) {
+    for(int f = 0; f < VS_MAX_FIELDS; f++) {
+        int idx = vs_schemas[schema].fields[f];
+        if(idx < 0 || idx >= arg_count || strcmp(args[idx], VS_PLACEHOLDER) != 0)
+            continue;
+        int64_t v = state->prev[func_id][f] + ts_zigzag_decode(ts_decode_delta(cursor));
+        state->prev[func_id][f] = v;
+        free(args[idx]);
+        args[idx] = (char*) calloc(24, sizeof(char));
+        sprintf(args[idx], "%lld", (long long)v);
+    }
+}
+
+#endif
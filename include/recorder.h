@@ -6,18 +6,23 @@
 #include "recorder-gotcha.h"
 #include "recorder-pattern-recognition.h"
 #include "recorder-timestamps.h"
+#include "recorder-value-streams.h"
 
 /* List of runtime environment variables */
 #define RECORDER_WITH_NON_MPI       		        "RECORDER_WITH_NON_MPI"
 #define RECORDER_TRACES_DIR         		        "RECORDER_TRACES_DIR"
 #define RECORDER_TIME_RESOLUTION    		        "RECORDER_TIME_RESOLUTION"
 #define RECORDER_TIME_COMPRESSION                   "RECORDER_TIME_COMPRESSION"
+#define RECORDER_TIME_PREDICTION                    "RECORDER_TIME_PREDICTION"
 #define RECORDER_STORE_POINTER        		        "RECORDER_STORE_POINTER"
 #define RECORDER_STORE_TID            		        "RECORDER_STORE_TID"
 #define RECORDER_STORE_CALL_DEPTH          		    "RECORDER_STORE_CALL_DEPTH"
 #define RECORDER_INTERPROCESS_COMPRESSION	        "RECORDER_INTERPROCESS_COMPRESSION"
 #define RECORDER_INTERPROCESS_PATTERN_RECOGNITION   "RECORDER_INTERPROCESS_PATTERN_RECOGNITION"
 #define RECORDER_INTRAPROCESS_PATTERN_RECOGNITION   "RECORDER_INTRAPROCESS_PATTERN_RECOGNITION"
+#define RECORDER_RELATIVE_PEERS                     "RECORDER_RELATIVE_PEERS"
+#define RECORDER_VALUE_STREAMS                      "RECORDER_VALUE_STREAMS"
+#define RECORDER_STORE_RETURN_VALUES                "RECORDER_STORE_RETURN_VALUES"
 #define RECORDER_EXCLUSION_FILE     		        "RECORDER_EXCLUSION_FILE"
 #define RECORDER_INCLUSION_FILE     		        "RECORDER_INCLUSION_FILE"
 #define RECORDER_DEBUG_LEVEL                        "RECORDER_DEBUG_LEVEL"
@@ -32,6 +37,36 @@
 #define RECORDER_MPIIO_TRACING              "RECORDER_MPIIO_TRACING"
 #define RECORDER_MPI_TRACING                "RECORDER_MPI_TRACING"
 #define RECORDER_HDF5_TRACING               "RECORDER_HDF5_TRACING"
+#define RECORDER_ASYNC_TRACING              "RECORDER_ASYNC_TRACING"     // POSIX AIO and io_uring
+
+/*
+ * Finer control within the layers that are on: comma separated
+ * glob patterns over the function names of func_list, e.g.,
+ * export RECORDER_FUNCTION_EXCLUSION="ftell*,fileno,umask"
+ * Functions not selected are not wrapped at all.
+ */
+#define RECORDER_FUNCTION_INCLUSION         "RECORDER_FUNCTION_INCLUSION"
+#define RECORDER_FUNCTION_EXCLUSION         "RECORDER_FUNCTION_EXCLUSION"
+
+/*
+ * Filters of user functions (-finstrument-functions), resolved
+ * to address ranges when Recorder starts. Objects are matched by
+ * comma separated glob patterns over their paths, symbols by a
+ * POSIX extended regex over their (mangled) names. Calls shorter
+ * than the minimum duration, in microseconds, are dropped.
+ */
+#define RECORDER_USER_OBJECT_INCLUSION      "RECORDER_USER_OBJECT_INCLUSION"
+#define RECORDER_USER_OBJECT_EXCLUSION      "RECORDER_USER_OBJECT_EXCLUSION"
+#define RECORDER_USER_SYMBOL_INCLUSION      "RECORDER_USER_SYMBOL_INCLUSION"
+#define RECORDER_USER_SYMBOL_EXCLUSION      "RECORDER_USER_SYMBOL_EXCLUSION"
+#define RECORDER_USER_MIN_DURATION          "RECORDER_USER_MIN_DURATION"
+
+/*
+ * Number of frames (at most 16) of the call site of each
+ * intercepted call, 0 (default) to capture none. Frames of
+ * code built without frame pointers end the walk early.
+ */
+#define RECORDER_CALL_SITES                 "RECORDER_CALL_SITES"
 
 
 /**
@@ -48,42 +83,66 @@
  * can change the fields, e.g., fopen will convert the FILE* to an integer res.
  *
  */
-#define RECORDER_INTERCEPTOR_PROLOGUE_CORE(ret, func, real_args)                    \
+#define RECORDER_INTERCEPTOR_PROLOGUE_CORE(ret, func, name, real_args)              \
     Record *record = recorder_malloc(sizeof(Record));                               \
-    record->func_id = get_function_id_by_name(#func);                               \
+    record->func_id = get_function_id_by_name(name);                                \
     record->tid = recorder_gettid();                                                \
     logger_record_enter(record);                                                    \
     record->tstart = recorder_wtime();                                              \
     GOTCHA_SET_REAL_CALL_NOCHECK(func);                                             \
     ret res = GOTCHA_REAL_CALL(func) real_args ;                                    \
     record->tend = recorder_wtime();                                                \
-    record->res = NULL;                                                             \
-    if (sizeof(ret)) {                                                              \
-        record->res = malloc(sizeof(ret));                                          \
-        memcpy(record->res, &res, sizeof(ret));                                     \
-    } 
+    record->res = (int64_t)(intptr_t) res;
 
-// Fortran wrappers call this
-// ierr is of type MPI_Fint*, set only for fortran calls
-#define RECORDER_INTERCEPTOR_PROLOGUE_F(ret, func, real_args, ierr)                 \
-    if(!logger_initialized()) {                                                     \
+/*
+ * Calls are not recorded before the logger is initialized, nor
+ * while tracing is paused (see recorder-control.h); they go
+ * straight to the real function. Wrappers that keep a table
+ * current, e.g., of open files, communicators or pending
+ * requests, use the _TRACKED variants instead, which run the
+ * whole wrapper while paused and drop the record at exit.
+ */
+#define RECORDER_INTERCEPTOR_PROLOGUE_F_IF(cond, ret, func, real_args, ierr)        \
+    if(!(cond)) {                                                                   \
         GOTCHA_SET_REAL_CALL_NOCHECK(func);                                         \
         ret res = GOTCHA_REAL_CALL(func) real_args ;                                \
         if ((ierr) != NULL) { *(ierr) = res; }                                      \
         return res;                                                                 \
     }                                                                               \
-    RECORDER_INTERCEPTOR_PROLOGUE_CORE(ret, func, real_args)                        \
+    RECORDER_INTERCEPTOR_PROLOGUE_CORE(ret, func, #func, real_args)                 \
     if ((ierr) != NULL) { *(ierr) = res; }
 
-// C wrappers call this
-#define RECORDER_INTERCEPTOR_PROLOGUE(ret, func, real_args)                         \
-    /*RECORDER_LOGINFO("[Recorder] intercept %s\n", #func);*/                       \
-    if(!logger_initialized()) {                                                     \
+#define RECORDER_INTERCEPTOR_PROLOGUE_IF(cond, ret, func, name, real_args)          \
+    if(!(cond)) {                                                                   \
         GOTCHA_SET_REAL_CALL_NOCHECK(func);                                         \
         ret res = GOTCHA_REAL_CALL(func) real_args ;                                \
         return res;                                                                 \
     }                                                                               \
-    RECORDER_INTERCEPTOR_PROLOGUE_CORE(ret, func, real_args)
+    RECORDER_INTERCEPTOR_PROLOGUE_CORE(ret, func, name, real_args)
+
+// Fortran wrappers call this
+// ierr is of type MPI_Fint*, set only for fortran calls
+#define RECORDER_INTERCEPTOR_PROLOGUE_F(ret, func, real_args, ierr)                 \
+    RECORDER_INTERCEPTOR_PROLOGUE_F_IF(logger_tracing(), ret, func, real_args, ierr)
+
+#define RECORDER_INTERCEPTOR_PROLOGUE_F_TRACKED(ret, func, real_args, ierr)         \
+    RECORDER_INTERCEPTOR_PROLOGUE_F_IF(logger_initialized(), ret, func, real_args, ierr)
+
+// C wrappers call this
+#define RECORDER_INTERCEPTOR_PROLOGUE(ret, func, real_args)                         \
+    /*RECORDER_LOGINFO("[Recorder] intercept %s\n", #func);*/                       \
+    RECORDER_INTERCEPTOR_PROLOGUE_IF(logger_tracing(), ret, func, #func, real_args)
+
+#define RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(ret, func, real_args)                 \
+    RECORDER_INTERCEPTOR_PROLOGUE_IF(logger_initialized(), ret, func, #func, real_args)
+
+// C wrappers of functions recorded under the id of another
+// one, e.g., stat64 as stat (see lib/recorder-posix.c)
+#define RECORDER_INTERCEPTOR_PROLOGUE_AS(ret, func, name, real_args)                \
+    RECORDER_INTERCEPTOR_PROLOGUE_IF(logger_tracing(), ret, func, name, real_args)
+
+#define RECORDER_INTERCEPTOR_PROLOGUE_AS_TRACKED(ret, func, name, real_args)        \
+    RECORDER_INTERCEPTOR_PROLOGUE_IF(logger_initialized(), ret, func, name, real_args)
 
 /**
  * I/O Interceptor
@@ -0,0 +1,188 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "recorder.h"
+#include "recorder-call-sites.h"
+#include "uthash.h"
+
+/*
+ * Stacks are interned in a global table, behind a per-thread
+ * direct-mapped cache, so a call site seen before costs the
+ * walk, a hash and a compare, without a lock.
+ */
+
+#define STACK_CACHE_SIZE    256     // per thread, power of 2
+
+typedef struct call_stack {
+    uintptr_t addrs[CALL_SITES_MAX_DEPTH];  // key, unused frames are 0
+    uint32_t  id;
+    UT_hash_handle hh;
+} call_stack_t;
+
+typedef struct stack_cache_entry {
+    uint64_t      hash;
+    call_stack_t* stack;
+} stack_cache_entry_t;
+
+static int depth = 0;                   // frames per call site, 0 if off
+static call_stack_t* stack_table = NULL;
+static uint32_t num_stacks = 0;
+static pthread_mutex_t stack_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread stack_cache_entry_t stack_cache[STACK_CACHE_SIZE];
+static __thread uintptr_t stack_lo = 0, stack_hi = 0;     // of this thread
+
+
+void call_sites_init(int frames) {
+    depth = frames;
+}
+
+/*
+ * Frames outside the stack of the thread end the walk, so a
+ * frame pointer register used for something else, e.g., code
+ * built with -fomit-frame-pointer, is never dereferenced.
+ */
+static void get_stack_bounds() {
+    pthread_attr_t attr;
+    void* addr;
+    size_t size;
+
+    stack_hi = 1;       // tried, walk nothing if it fails
+    if(pthread_getattr_np(pthread_self(), &attr) != 0)
+        return;
+    if(pthread_attr_getstack(&attr, &addr, &size) == 0) {
+        stack_lo = (uintptr_t) addr;
+        stack_hi = (uintptr_t) addr + size;
+    }
+    pthread_attr_destroy(&attr);
+}
+
+static call_stack_t* intern_stack(uintptr_t* addrs) {
+    size_t key_len = depth * sizeof(uintptr_t);
+    call_stack_t* stack = NULL;
+
+    pthread_mutex_lock(&stack_mutex);
+    HASH_FIND(hh, stack_table, addrs, key_len, stack);
+    if(!stack) {
+        stack = calloc(1, sizeof(call_stack_t));
+        memcpy(stack->addrs, addrs, key_len);
+        stack->id = ++num_stacks;
+        HASH_ADD(hh, stack_table, addrs, key_len, stack);
+    }
+    pthread_mutex_unlock(&stack_mutex);
+    return stack;
+}
+
+/*
+ * frame is that of logger_record_enter(), its return
+ * address points into the wrapper and is skipped.
+ * Return the stack id, or 0 if nothing was captured.
+ */
+uint32_t call_sites_capture(void* frame) {
+    if(depth == 0)
+        return 0;
+    if(stack_hi == 0)
+        get_stack_bounds();
+
+    uintptr_t addrs[CALL_SITES_MAX_DEPTH] = {0};
+    uintptr_t* fp = (uintptr_t*) frame;
+    int n = -1;
+    while(n < depth) {
+        uintptr_t p = (uintptr_t) fp;
+        if(p < stack_lo || p + 2*sizeof(uintptr_t) > stack_hi || (p & (sizeof(uintptr_t)-1)))
+            break;
+        uintptr_t ret = fp[1];
+        if(ret == 0)
+            break;
+        if(n >= 0)
+            addrs[n] = ret;
+        n++;
+        uintptr_t* next = (uintptr_t*) fp[0];
+        if(next <= fp)          // stacks grow down
+            break;
+        fp = next;
+    }
+    if(n <= 0)
+        return 0;
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for(int i = 0; i < n; i++)
+        hash = (hash ^ addrs[i]) * 0x9E3779B97F4A7C15ULL;
+
+    stack_cache_entry_t* e = &stack_cache[hash & (STACK_CACHE_SIZE-1)];
+    if(e->stack && e->hash == hash &&
+       memcmp(e->stack->addrs, addrs, depth*sizeof(uintptr_t)) == 0)
+        return e->stack->id;
+
+    e->stack = intern_stack(addrs);
+    e->hash = hash;
+    return e->stack->id;
+}
+
+static void save_stack_table(RecorderLogger* logger) {
+    char filename[1024];
+    sprintf(filename, "%s/%d.stk", logger->traces_dir, logger->rank);
+    FILE* f = GOTCHA_REAL_CALL(fopen)(filename, "wb");
+    if(!f) return;
+
+    GOTCHA_REAL_CALL(fwrite)(&num_stacks, sizeof(num_stacks), 1, f);
+    // ids are given in insertion order
+    for(call_stack_t* stack = stack_table; stack != NULL; stack = stack->hh.next) {
+        uint8_t n = 0;
+        while(n < depth && stack->addrs[n])
+            n++;
+        uint64_t addrs[CALL_SITES_MAX_DEPTH];
+        for(int i = 0; i < n; i++)
+            addrs[i] = stack->addrs[i];
+        GOTCHA_REAL_CALL(fwrite)(&n, sizeof(n), 1, f);
+        GOTCHA_REAL_CALL(fwrite)(addrs, sizeof(uint64_t), n, f);
+    }
+    GOTCHA_REAL_CALL(fclose)(f);
+}
+
+static void save_maps(RecorderLogger* logger) {
+    GOTCHA_SET_REAL_CALL(open,  RECORDER_POSIX);
+    GOTCHA_SET_REAL_CALL(read,  RECORDER_POSIX);
+    GOTCHA_SET_REAL_CALL(close, RECORDER_POSIX);
+
+    int fd = GOTCHA_REAL_CALL(open)("/proc/self/maps", O_RDONLY);
+    if(fd < 0) return;
+
+    char filename[1024];
+    sprintf(filename, "%s/%d.maps", logger->traces_dir, logger->rank);
+    FILE* f = GOTCHA_REAL_CALL(fopen)(filename, "w");
+    if(f) {
+        char buf[4096];
+        ssize_t n;
+        while((n = GOTCHA_REAL_CALL(read)(fd, buf, sizeof(buf))) > 0)
+            GOTCHA_REAL_CALL(fwrite)(buf, 1, n, f);
+        GOTCHA_REAL_CALL(fclose)(f);
+    }
+    GOTCHA_REAL_CALL(close)(fd);
+}
+
+/*
+ * The maps are copied at the end, so objects unloaded
+ * with dlclose() before can not be resolved.
+ */
+void call_sites_finalize(RecorderLogger* logger) {
+    if(depth == 0)
+        return;
+
+    pthread_mutex_lock(&stack_mutex);
+    save_stack_table(logger);
+    save_maps(logger);
+
+    call_stack_t *stack, *tmp;
+    HASH_ITER(hh, stack_table, stack, tmp) {
+        HASH_DEL(stack_table, stack);
+        free(stack);
+    }
+    num_stacks = 0;
+    depth = 0;
+    pthread_mutex_unlock(&stack_mutex);
+}
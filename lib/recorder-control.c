@@ -0,0 +1,110 @@
+/**
+ * Implementation of include/recorder-control.h
+ *
+ * Pausing is handled by the logger: while paused, wrappers
+ * go straight to the real call. Those keeping a table, e.g.,
+ * of open files, still run and drop their record (see
+ * logger_record_enter()), so a file opened during a paused
+ * phase is still known after resume.
+ *
+ * The markers are written as records of their own func_list
+ * entries, "recorder_pause", "recorder_resume" (no args),
+ * "recorder_region_begin" and "recorder_region_end" (region name).
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "recorder.h"
+#include "recorder-control.h"
+#include "utlist.h"
+
+
+typedef struct region_node {
+    char* name;
+    struct region_node *next;
+} region_node_t;
+
+// Open regions of this thread, innermost first
+static __thread region_node_t* regions = NULL;
+
+
+static void write_marker(const char* func, const char* name) {
+    if(!logger_initialized()) return;
+
+    Record *record = recorder_malloc(sizeof(Record));
+    record->func_id = get_function_id_by_name(func);
+    record->call_depth = 0;
+    record->res = 0;
+    record->stack_id = 0;
+    record->tid = recorder_gettid();
+    record->tstart = recorder_wtime();
+    record->tend = record->tstart;
+    record->arg_count = name ? 1 : 0;
+    record->args = NULL;
+    if(name) {
+        record->args = recorder_malloc(sizeof(char*));
+        record->args[0] = strdup(name);
+    }
+    write_record(record);
+    free_record(record);
+}
+
+void recorder_pause(void) {
+    // Written before pausing, so that it is kept
+    if(!logger_paused())
+        write_marker("recorder_pause", NULL);
+    logger_pause();
+}
+
+void recorder_resume(void) {
+    if(!logger_paused()) return;
+    logger_resume();
+    if(!logger_paused())
+        write_marker("recorder_resume", NULL);
+}
+
+void recorder_region_begin(const char* name) {
+    region_node_t *node = recorder_malloc(sizeof(region_node_t));
+    node->name = strdup(name ? name : "???");
+    LL_PREPEND(regions, node);
+    write_marker("recorder_region_begin", node->name);
+}
+
+void recorder_region_end(void) {
+    region_node_t *node = regions;
+    if(node == NULL) {
+        RECORDER_LOGERR("[Recorder] recorder_region_end() without an open region\n");
+        return;
+    }
+    write_marker("recorder_region_end", node->name);
+    LL_DELETE(regions, node);
+    free(node->name);
+    recorder_free(node, sizeof(region_node_t));
+}
+
+
+/*
+ * Fortran bindings. Strings come with a hidden length
+ * argument, a size_t with gfortran 8+ and ifort, and are
+ * padded with blanks, not terminated.
+ */
+void recorder_pause_(void) {
+    recorder_pause();
+}
+
+void recorder_resume_(void) {
+    recorder_resume();
+}
+
+void recorder_region_begin_(const char* name, size_t name_len) {
+    while(name_len > 0 && name[name_len-1] == ' ')
+        name_len--;
+    char* str = strndup(name, name_len);
+    recorder_region_begin(str);
+    free(str);
+}
+
+void recorder_region_end_(void) {
+    recorder_region_end();
+}
@@ -0,0 +1,168 @@
+#include <stdlib.h>
+#include <string.h>
+#include "recorder-logger.h"
+#include "recorder-cs-table.h"
+
+#define CS_TABLE_INITIAL_SLOTS  1024
+#define CS_HASH_SEED            0xa0761d6478bd642fULL
+#define CS_HASH_P1              0xe7037ed1a0b428dbULL
+#define CS_HASH_P2              0x8ebc6af09c88c6e3ULL
+
+static inline uint64_t cs_hash_mix(uint64_t a, uint64_t b) {
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
+static inline uint64_t cs_hash_read64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t cs_hash_read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/*
+ * Reads the key 16 bytes at a time and folds them with a
+ * 64x64->128 multiply, the tail is read with (possibly
+ * overlapping) 8 or 4 byte loads. Same idea as wyhash.
+ */
+uint64_t cs_hash64(const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*) data;
+    uint64_t seed = CS_HASH_SEED ^ cs_hash_mix(len ^ CS_HASH_P1, CS_HASH_P2);
+    size_t remain = len;
+
+    while(remain > 16) {
+        seed = cs_hash_mix(cs_hash_read64(p) ^ CS_HASH_P1, cs_hash_read64(p+8) ^ seed);
+        p += 16;
+        remain -= 16;
+    }
+
+    uint64_t a = 0, b = 0;
+    if(remain >= 8) {
+        a = cs_hash_read64(p);
+        b = cs_hash_read64(p+remain-8);
+    } else if(remain >= 4) {
+        a = cs_hash_read32(p);
+        b = cs_hash_read32(p+remain-4);
+    } else if(remain > 0) {
+        a = ((uint64_t)p[0] << 16) | ((uint64_t)p[remain>>1] << 8) | p[remain-1];
+    }
+
+    return cs_hash_mix(CS_HASH_P1 ^ len, cs_hash_mix(a ^ CS_HASH_P1, b ^ seed));
+}
+
+static void cs_table_alloc_slots(CSTable* table, int num_slots) {
+    table->num_slots = num_slots;
+    table->slot_hashes  = malloc(sizeof(uint64_t) * num_slots);
+    table->slot_indices = malloc(sizeof(int) * num_slots);
+    memset(table->slot_indices, -1, sizeof(int) * num_slots);
+}
+
+static void cs_table_put_slot(CSTable* table, uint64_t hash, int index) {
+    int mask = table->num_slots - 1;
+    int slot = hash & mask;
+    while(table->slot_indices[slot] != -1)
+        slot = (slot + 1) & mask;
+    table->slot_hashes[slot]  = hash;
+    table->slot_indices[slot] = index;
+}
+
+// keep load factor under 1/2, rehash with the stored hashes
+static void cs_table_grow(CSTable* table) {
+    uint64_t* old_hashes  = table->slot_hashes;
+    int*      old_indices = table->slot_indices;
+    int       old_slots   = table->num_slots;
+
+    cs_table_alloc_slots(table, old_slots * 2);
+    for(int i = 0; i < old_slots; i++) {
+        if(old_indices[i] != -1)
+            cs_table_put_slot(table, old_hashes[i], old_indices[i]);
+    }
+    free(old_hashes);
+    free(old_indices);
+}
+
+void cs_table_init(CSTable* table) {
+    cs_table_alloc_slots(table, CS_TABLE_INITIAL_SLOTS);
+    table->max_entries = CS_TABLE_INITIAL_SLOTS / 2;
+    table->num_entries = 0;
+    table->entries = malloc(sizeof(CallSignature*) * table->max_entries);
+}
+
+void cs_table_destroy(CSTable* table) {
+    free(table->slot_hashes);
+    free(table->slot_indices);
+    free(table->entries);
+    memset(table, 0, sizeof(CSTable));
+}
+
+static int cs_table_find_slot(CSTable* table, const void* key, int key_len, uint64_t hash) {
+    int mask = table->num_slots - 1;
+    int slot = hash & mask;
+    while(table->slot_indices[slot] != -1) {
+        if(table->slot_hashes[slot] == hash) {
+            CallSignature* entry = table->entries[table->slot_indices[slot]];
+            if(entry->key_len == key_len && memcmp(entry->key, key, key_len) == 0)
+                return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+CallSignature* cs_table_find(CSTable* table, const void* key, int key_len, uint64_t hash) {
+    int slot = cs_table_find_slot(table, key, key_len, hash);
+    if(slot == -1)
+        return NULL;
+    return table->entries[table->slot_indices[slot]];
+}
+
+void cs_table_add(CSTable* table, CallSignature* entry) {
+    if(table->num_entries == table->max_entries) {
+        table->max_entries *= 2;
+        table->entries = realloc(table->entries, sizeof(CallSignature*) * table->max_entries);
+    }
+    if(2 * (table->num_entries + 1) > table->num_slots)
+        cs_table_grow(table);
+
+    table->entries[table->num_entries] = entry;
+    cs_table_put_slot(table, entry->hash, table->num_entries);
+    table->num_entries++;
+}
+
+/*
+ * Remove a slot with backward-shift deletion, so that
+ * no tombstones are needed for linear probing.
+ */
+static void cs_table_remove_slot(CSTable* table, int slot) {
+    int mask = table->num_slots - 1;
+    int hole = slot;
+    int next = (hole + 1) & mask;
+    while(table->slot_indices[next] != -1) {
+        int home = table->slot_hashes[next] & mask;
+        // move next into the hole if its home slot
+        // is not in the (cyclic) range (hole, next]
+        if(((next - home) & mask) >= ((next - hole) & mask)) {
+            table->slot_hashes[hole]  = table->slot_hashes[next];
+            table->slot_indices[hole] = table->slot_indices[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    table->slot_indices[hole] = -1;
+}
+
+void cs_table_rekey(CSTable* table, CallSignature* entry, void* new_key, int new_key_len) {
+    int slot = cs_table_find_slot(table, entry->key, entry->key_len, entry->hash);
+    int index = table->slot_indices[slot];
+    cs_table_remove_slot(table, slot);
+
+    entry->key = new_key;
+    entry->key_len = new_key_len;
+    entry->hash = cs_hash64(new_key, new_key_len);
+    cs_table_put_slot(table, entry->hash, index);
+}
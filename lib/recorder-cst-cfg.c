@@ -15,6 +15,7 @@
  *   arg count:     sizeof(record->arg_count)
  *   arg strlen:    sizeof(int)
  *   args:          arg_strlen
+ *   stack id:      sizeof(record->stack_id), only if not 0
  *
  * arguments seperated by space ' '
  */
@@ -25,76 +26,152 @@ int cs_key_args_start() {
     return ((int)args_start);
 }
 
-int cs_key_args_strlen(Record* record) {
-    int arg_count = record->arg_count;
-    char **args = record->args;
-
-    char invalid_str[] = "???";
-    int invalid_str_len = strlen(invalid_str);
-
-    int args_strlen = arg_count;
-    for(int i = 0; i < arg_count; i++) {
-        if(args[i]) {
-            for(int j = 0; j < strlen(args[i]); j++)
-                if(args[i][j] == ' ') args[i][j] = '_';
-            args_strlen += strlen(args[i]);
-        } else {
-            args_strlen += strlen(invalid_str);
-        }
-    }
+/**
+ * End of the args, the key may go on with a stack id
+ */
+int cs_key_args_end(CallSignature* cs) {
+    int args_start = cs_key_args_start();
+    int arg_strlen;
+    memcpy(&arg_strlen, (char*)cs->key + args_start - sizeof(int), sizeof(int));
+    return args_start + arg_strlen;
+}
 
-    return args_strlen;
+/**
+ * Hash of a call signature key, used by the CST
+ * (see recorder-cs-table.h)
+ */
+uint64_t cs_key_hash(const void* key, int key_len) {
+    return cs_hash64(key, key_len);
 }
 
-int cs_key_length(Record* record) {
-    int key_len = cs_key_args_start() + cs_key_args_strlen(record);
-    return key_len;
+/**
+ * Per-thread scratch buffer for composing keys.
+ * It only grows, so in steady state composing a key
+ * does not allocate any memory.
+ */
+static __thread char* cs_key_scratch = NULL;
+static __thread int   cs_key_scratch_size = 0;
+
+static char* cs_key_scratch_grow(int min_size) {
+    int size = cs_key_scratch_size ? cs_key_scratch_size : 256;
+    while(size < min_size)
+        size *= 2;
+    cs_key_scratch = realloc(cs_key_scratch, size);
+    cs_key_scratch_size = size;
+    return cs_key_scratch;
 }
 
-char* compose_cs_key(Record* record, int* key_len) {
+static const char invalid_str[] = "???";
+
+/**
+ * Compose the key of a record in a single pass.
+ *
+ * Args are copied (spaces replaced by '_') in one loop,
+ * then the header is filled in and the key is hashed.
+ *
+ * The returned key lives in a per-thread buffer that is
+ * overwritten by the next call. Caller should copy it if
+ * the key needs to be kept (i.e., a new CST entry).
+ */
+char* compose_cs_key(Record* record, int* key_len, uint64_t* hash) {
     int arg_count = record->arg_count;
     char **args = record->args;
 
-    char invalid_str[] = "???";
-    int invalid_str_len = strlen(invalid_str);
-
-    int args_strlen = cs_key_args_strlen(record);
-    *key_len = cs_key_length(record);
-
-    char* key = recorder_malloc(*key_len);
-    int pos = 0;
-    memcpy(key+pos, &record->tid, sizeof(pthread_t));
-    pos += sizeof(pthread_t);
-    memcpy(key+pos, &record->func_id, sizeof(record->func_id));
-    pos += sizeof(record->func_id);
-    memcpy(key+pos, &record->call_depth, sizeof(record->call_depth));
-    pos += sizeof(record->call_depth);
-    memcpy(key+pos, &record->arg_count, sizeof(record->arg_count));
-    pos += sizeof(record->arg_count);
-    memcpy(key+pos, &args_strlen, sizeof(int));
-    pos += sizeof(int);
+    int args_start = cs_key_args_start();
+    char* key = cs_key_scratch;
+    if(cs_key_scratch_size < args_start + 64)
+        key = cs_key_scratch_grow(args_start + 64);
 
+    int pos = args_start;
     for(int i = 0; i < arg_count; i++) {
-        if(args[i]) {
-            memcpy(key+pos, args[i], strlen(args[i]));
-            pos += strlen(args[i]);
-        } else {
-            memcpy(key+pos, invalid_str, strlen(invalid_str));
-            pos += invalid_str_len;
+        const char* arg = args[i] ? args[i] : invalid_str;
+        for(; *arg; arg++) {
+            if(pos + 1 >= cs_key_scratch_size)
+                key = cs_key_scratch_grow(pos + 2);
+            char c = (*arg == ' ') ? '_' : *arg;
+            key[pos++] = c;
         }
-        key[pos] = ' ';
-        pos += 1;
+        if(pos >= cs_key_scratch_size)
+            key = cs_key_scratch_grow(pos + 1);
+        key[pos++] = ' ';
     }
 
+    int args_strlen = pos - args_start;
+    if(record->stack_id) {
+        if(pos + (int)sizeof(record->stack_id) > cs_key_scratch_size)
+            key = cs_key_scratch_grow(pos + sizeof(record->stack_id));
+        memcpy(key+pos, &record->stack_id, sizeof(record->stack_id));
+        pos += sizeof(record->stack_id);
+    }
+    int hpos = 0;
+    memcpy(key+hpos, &record->tid, sizeof(pthread_t));
+    hpos += sizeof(pthread_t);
+    memcpy(key+hpos, &record->func_id, sizeof(record->func_id));
+    hpos += sizeof(record->func_id);
+    memcpy(key+hpos, &record->call_depth, sizeof(record->call_depth));
+    hpos += sizeof(record->call_depth);
+    memcpy(key+hpos, &record->arg_count, sizeof(record->arg_count));
+    hpos += sizeof(record->arg_count);
+    memcpy(key+hpos, &args_strlen, sizeof(int));
+
+    *key_len = pos;
+    *hash = cs_key_hash(key, pos);
     return key;
 }
 
+/**
+ * Check if cs has the key compose_cs_key() would give for
+ * record, without composing it: one compare pass over the
+ * header and args that stops at the first difference, and
+ * no hashing.
+ */
+bool cs_key_matches_record(CallSignature* cs, Record* record) {
+    const char* key = cs->key;
+    int hpos = 0;
+    if(memcmp(key+hpos, &record->tid, sizeof(pthread_t)))
+        return false;
+    hpos += sizeof(pthread_t);
+    if(memcmp(key+hpos, &record->func_id, sizeof(record->func_id)))
+        return false;
+    hpos += sizeof(record->func_id);
+    if(memcmp(key+hpos, &record->call_depth, sizeof(record->call_depth)))
+        return false;
+    hpos += sizeof(record->call_depth);
+    if(memcmp(key+hpos, &record->arg_count, sizeof(record->arg_count)))
+        return false;
+
+    int pos = cs_key_args_start();
+    int args_end = cs_key_args_end(cs);
+    for(int i = 0; i < record->arg_count; i++) {
+        const char* arg = record->args[i] ? record->args[i] : invalid_str;
+        int len = strlen(arg);
+        if(pos + len >= args_end || key[pos+len] != ' ')
+            return false;
+        if(memchr(arg, ' ', len)) {         // stored as '_'
+            for(int j = 0; j < len; j++)
+                if(key[pos+j] != (arg[j] == ' ' ? '_' : arg[j]))
+                    return false;
+        } else if(memcmp(key+pos, arg, len)) {
+            return false;
+        }
+        pos += len + 1;
+    }
+    if(pos != args_end)
+        return false;
+
+    int tail = cs->key_len - args_end;
+    if(!record->stack_id)
+        return tail == 0;
+    return tail == sizeof(record->stack_id) &&
+           memcmp(key+args_end, &record->stack_id, sizeof(record->stack_id)) == 0;
+}
+
 // Construct a Recorder* from a call signature key
 // Caller needs to free the record after use
 Record* cs_to_record(CallSignature *cs) {
 
     Record *record = recorder_malloc(sizeof(Record));
-    record->res = NULL; // we don't keep return value in Call Signature
+    record->res = 0;    // we don't keep return value in Call Signature
 
     char* key = cs->key;
 
@@ -125,35 +202,47 @@ Record* cs_to_record(CallSignature *cs) {
     }
 
     assert(ai == record->arg_count);
+
+    record->stack_id = 0;
+    if(cs->key_len >= pos + arg_strlen + (int)sizeof(record->stack_id))
+        memcpy(&record->stack_id, key+pos+arg_strlen, sizeof(record->stack_id));
     return record;
 }
 
-void cleanup_cst(CallSignature* cst) {
-    CallSignature *entry, *tmp;
-    HASH_ITER(hh, cst, entry, tmp) {
-        HASH_DEL(cst, entry);
+void cleanup_cst(CSTable* cst) {
+    for(int i = 0; i < cs_table_count(cst); i++) {
+        CallSignature* entry = cst->entries[i];
         recorder_free(entry->key, entry->key_len);
         recorder_free(entry, sizeof(CallSignature));
     }
-    cst = NULL;
+    cs_table_destroy(cst);
 }
 
-void* serialize_cst(CallSignature *cst, size_t *len) {
+/**
+ * with_hash: also store the 64-bit hash of each entry.
+ * Used for the CST streams exchanged at finalize time,
+ * so the receivers do not need to rehash the keys.
+ * The CST files (read by the reader) do not have it.
+ */
+void* serialize_cst(CSTable *cst, size_t *len, bool with_hash) {
     *len = sizeof(int);
 
-    CallSignature *entry, *tmp;
-    HASH_ITER(hh, cst, entry, tmp) {
+    int entries = cs_table_count(cst);
+    for(int i = 0; i < entries; i++) {
+        CallSignature *entry = cst->entries[i];
         *len = *len + entry->key_len + sizeof(int)*3 + sizeof(unsigned);
+        if(with_hash)
+            *len = *len + sizeof(uint64_t);
     }
 
-    int entries = HASH_COUNT(cst);
     void *res = recorder_malloc(*len);
     void *ptr = res;
 
     memcpy(ptr, &entries, sizeof(int));
     ptr += sizeof(int);
 
-    HASH_ITER(hh, cst, entry, tmp) {
+    for(int i = 0; i < entries; i++) {
+        CallSignature *entry = cst->entries[i];
 
         memcpy(ptr, &entry->terminal_id, sizeof(int));
         ptr = ptr + sizeof(int);
@@ -167,6 +256,11 @@ void* serialize_cst(CallSignature *cst, size_t *len) {
         memcpy(ptr, &entry->count, sizeof(unsigned));
         ptr = ptr + sizeof(unsigned);
 
+        if(with_hash) {
+            memcpy(ptr, &entry->hash, sizeof(uint64_t));
+            ptr = ptr + sizeof(uint64_t);
+        }
+
         memcpy(ptr, entry->key, entry->key_len);
         ptr = ptr + entry->key_len;
     }
@@ -174,13 +268,14 @@ void* serialize_cst(CallSignature *cst, size_t *len) {
     return res;
 }
 
-CallSignature* deserialize_cst(void *data) {
+void deserialize_cst(void *data, CSTable *cst, bool with_hash) {
     int num;
     memcpy(&num, data, sizeof(int));
 
     void *ptr = data + sizeof(int);
 
-    CallSignature *cst= NULL, *entry = NULL;
+    cs_table_init(cst);
+    CallSignature *entry = NULL;
     for(int i = 0; i < num; i++) {
         entry = recorder_malloc(sizeof(CallSignature));
 
@@ -196,42 +291,52 @@ CallSignature* deserialize_cst(void *data) {
         memcpy( &(entry->count), ptr, sizeof(unsigned) );
         ptr += sizeof(unsigned);
 
+        if(with_hash) {
+            memcpy( &(entry->hash), ptr, sizeof(uint64_t) );
+            ptr += sizeof(uint64_t);
+        }
+
         entry->key = recorder_malloc(entry->key_len);
         memcpy( entry->key, ptr, entry->key_len );
         ptr += entry->key_len;
 
-        HASH_ADD_KEYPTR(hh, cst, entry->key, entry->key_len, entry);
+        if(!with_hash)
+            entry->hash = cs_key_hash(entry->key, entry->key_len);
+        cs_table_add(cst, entry);
     }
-
-    return cst;
 }
 
 
 void save_cst_local(RecorderLogger* logger) {
     FILE* f = GOTCHA_REAL_CALL(fopen) (logger->cst_path, "wb");
     size_t len;
-    void* data = serialize_cst(logger->cst, &len);
+    void* data = serialize_cst(&logger->cst, &len, false);
     recorder_write_zlib((unsigned char*)data, len, f);
     GOTCHA_REAL_CALL(fclose)(f);
 }
 
-CallSignature* copy_cst(CallSignature* origin) {
-    CallSignature* cst = NULL;
-    CallSignature *entry, *tmp, *new_entry;
-    HASH_ITER(hh, origin, entry, tmp) {
-        new_entry = recorder_malloc(sizeof(CallSignature));
+void copy_cst(CSTable* origin, CSTable* cst) {
+    cs_table_init(cst);
+    for(int i = 0; i < cs_table_count(origin); i++) {
+        CallSignature *entry = origin->entries[i];
+        CallSignature *new_entry = recorder_malloc(sizeof(CallSignature));
         new_entry->terminal_id = entry->terminal_id;
         new_entry->key_len = entry->key_len;
         new_entry->rank = entry->rank;
         new_entry->count = entry->count;
+        new_entry->hash = entry->hash;
         new_entry->key = recorder_malloc(entry->key_len);
         memcpy(new_entry->key, entry->key, entry->key_len);
-        HASH_ADD_KEYPTR(hh, cst, new_entry->key, new_entry->key_len, new_entry);
+        cs_table_add(cst, new_entry);
     }
-    return cst;
 }
 
-CallSignature* compress_csts(RecorderLogger* logger) {
+/*
+ * Eventually the root (rank 0) will get the fully
+ * merged CST in merged_cst. On other ranks, merged_cst
+ * is freed before return.
+ */
+void compress_csts(RecorderLogger* logger, CSTable* merged_cst) {
 
     int my_rank = logger->rank;
     int other_rank;
@@ -240,7 +345,7 @@ CallSignature* compress_csts(RecorderLogger* logger) {
 
     int phases = recorder_ceil(recorder_log2(logger->nprocs));
 
-    CallSignature* merged_cst = copy_cst(logger->cst);
+    copy_cst(&logger->cst, merged_cst);
 
     for(int k = 0; k < phases; k++, mask*=2) {
         if(done) break;
@@ -249,9 +354,8 @@ CallSignature* compress_csts(RecorderLogger* logger) {
 
         if(other_rank >= logger->nprocs) continue;
 
-        size_t size, remain_cst_size;
+        size_t size;
         void* buf;
-        void* buf_ptr;
 
         // bigger ranks send to smaller ranks
         if(my_rank < other_rank) {
@@ -261,6 +365,7 @@ CallSignature* compress_csts(RecorderLogger* logger) {
 
             int cst_rank, entries, key_len;
             unsigned count;
+            uint64_t hash;
             void *ptr = buf;
             memcpy(&entries, ptr, sizeof(int));
             ptr = ptr + sizeof(int);
@@ -280,45 +385,33 @@ CallSignature* compress_csts(RecorderLogger* logger) {
                 memcpy(&count, ptr, sizeof(unsigned));
                 ptr = ptr + sizeof(unsigned);
 
+                // 8 bytes hash, computed by the sender
+                memcpy(&hash, ptr, sizeof(uint64_t));
+                ptr = ptr + sizeof(uint64_t);
+
                 // key length bytes key
-                void *key = recorder_malloc(key_len);
-                memcpy(key, ptr, key_len);
+                void *key = ptr;
                 ptr = ptr + key_len;
 
                 // Check to see if this function entry is already in the cst
-                CallSignature *entry = NULL;
-                HASH_FIND(hh, merged_cst, key, key_len, entry);
+                CallSignature *entry = cs_table_find(merged_cst, key, key_len, hash);
                 if(entry) {
-                    recorder_free(key, key_len);
                     entry->count += count;
                 } else {                                // Not exist, add to cst
                     entry = (CallSignature*) recorder_malloc(sizeof(CallSignature));
-                    entry->key = key;
+                    entry->key = recorder_malloc(key_len);
+                    memcpy(entry->key, key, key_len);
                     entry->key_len = key_len;
                     entry->rank = cst_rank;
                     entry->count = count;
-                    HASH_ADD_KEYPTR(hh, merged_cst, key, key_len, entry);
-
-                    //*key_len = sizeof(pthread_t) + sizeof(record->func_id) + sizeof(record->call_depth) +
-                    //           sizeof(record->arg_count) + sizeof(int) + arg_strlen;
-                    /*
-                    pthread_t thread_id;
-                    unsigned char func_id, call_depth, arg_count;
-                    int arg_strlen;
-                    memcpy(&thread_id, key, sizeof(thread_id));
-                    memcpy(&func_id, key+sizeof(thread_id), sizeof(func_id));
-                    memcpy(&call_depth, key+sizeof(thread_id)+sizeof(func_id), sizeof(call_depth));
-                    memcpy(&arg_count, key+sizeof(thread_id)+sizeof(func_id)+sizeof(call_depth), sizeof(arg_count));
-                    memcpy(&arg_strlen, key+sizeof(thread_id)+sizeof(func_id)+sizeof(call_depth)+sizeof(arg_count), sizeof(arg_strlen));
-                    printf("CHEN2 rank:%d tid: %ld, func_id:%d, call_depth:%d, arg_count:%d, arg_strlen:%d, count:%u, key:%s\n",
-                    cst_rank, thread_id, func_id, call_depth, arg_count, arg_strlen, count, ((char*)key)+15);
-                    */
+                    entry->hash = hash;
+                    cs_table_add(merged_cst, entry);
                 }
             }
             recorder_free(buf, size);
 
         } else {   // SENDER
-            buf = serialize_cst(merged_cst, &size);
+            buf = serialize_cst(merged_cst, &size, true);
             recorder_send(&size, sizeof(size), other_rank, mask, MPI_COMM_WORLD);
             recorder_send(buf, size, other_rank, mask, MPI_COMM_WORLD);
             recorder_free(buf, size);
@@ -329,45 +422,45 @@ CallSignature* compress_csts(RecorderLogger* logger) {
     // Eventually the root (rank 0) will get the fully merged CST
     // Update (re-assign) terminal id for all unique signatures
     if(my_rank == 0) {
-        //linear_regression(merged_cst);
-        int terminal_id = 0;
-        CallSignature *entry, *tmp;
-        HASH_ITER(hh, merged_cst, entry, tmp) {
-            entry->terminal_id = terminal_id++;
-        }
+        for(int i = 0; i < cs_table_count(merged_cst); i++)
+            merged_cst->entries[i]->terminal_id = i;
     } else {
         cleanup_cst(merged_cst);
     }
-    return merged_cst;
 }
 
 
 void save_cst_merged(RecorderLogger* logger) {
     // 1. Inter-process copmression for CSTs
     // Eventually, rank 0 will have the compressed cst.
-    CallSignature* compressed_cst = compress_csts(logger);
+    CSTable compressed_cst;
+    compress_csts(logger, &compressed_cst);
 
     // 2. Broadcast the merged CST to all ranks
     size_t cst_stream_size;
     void *cst_stream;
 
     if(logger->rank == 0) {
-        cst_stream = serialize_cst(compressed_cst, &cst_stream_size);
+        cst_stream = serialize_cst(&compressed_cst, &cst_stream_size, true);
 
         recorder_bcast(&cst_stream_size, sizeof(cst_stream_size), 0, MPI_COMM_WORLD);
         recorder_bcast(cst_stream, cst_stream_size, 0, MPI_COMM_WORLD);
 
         // 3. Rank 0 write out the compressed CST
+        // (without the hashes, which the reader does not need)
+        size_t file_stream_size;
+        void* file_stream = serialize_cst(&compressed_cst, &file_stream_size, false);
         errno = 0;
         char cst_fname[1096];
         sprintf(cst_fname, "%s/recorder.cst", logger->traces_dir);
         FILE *cst_file = fopen(cst_fname, "wb");
         if(cst_file) {
-            recorder_write_zlib(cst_stream, cst_stream_size, cst_file);
+            recorder_write_zlib(file_stream, file_stream_size, cst_file);
             GOTCHA_REAL_CALL(fclose)(cst_file);
         } else {
             printf("[Recorder] Open file: %s failed, errno: %d\n", cst_fname, errno);
         }
+        recorder_free(file_stream, file_stream_size);
     } else {
         recorder_bcast(&cst_stream_size, sizeof(cst_stream_size), 0, MPI_COMM_WORLD);
         cst_stream = recorder_malloc(cst_stream_size);
@@ -375,14 +468,14 @@ void save_cst_merged(RecorderLogger* logger) {
 
         // 3. Other rank get the compressed cst stream from rank 0
         // then convert it to the CST
-        compressed_cst = deserialize_cst(cst_stream);
+        deserialize_cst(cst_stream, &compressed_cst, true);
     }
 
     // 4. Update function entry's terminal id
     int *update_terminal_id = recorder_malloc(sizeof(int) * logger->current_cfg_terminal);
-    CallSignature *entry, *tmp, *res;
-    HASH_ITER(hh, logger->cst, entry, tmp) {
-        HASH_FIND(hh, compressed_cst, entry->key, entry->key_len, res);
+    for(int i = 0; i < cs_table_count(&logger->cst); i++) {
+        CallSignature *entry = logger->cst.entries[i];
+        CallSignature *res = cs_table_find(&compressed_cst, entry->key, entry->key_len, entry->hash);
         if(res)
             update_terminal_id[entry->terminal_id] = res->terminal_id;
         else
@@ -390,7 +483,7 @@ void save_cst_merged(RecorderLogger* logger) {
     }
 
 
-    cleanup_cst(compressed_cst);
+    cleanup_cst(&compressed_cst);
     recorder_free(cst_stream, cst_stream_size);
 
     sequitur_update(&(logger->cfg), update_terminal_id);
@@ -3,113 +3,606 @@
 
 #include <pthread.h>
 #include <stdio.h>
+#include <dlfcn.h>
+#include <link.h>
+#include <elf.h>
+#include <regex.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include "recorder.h"
-#include "utlist.h"
+#include "recorder-function-profiler.h"
 #include "uthash.h"
 
+/*
+ * Tracing of user functions compiled with -finstrument-functions.
+ *
+ * Enter and exit calls come in pairs on each thread, so a
+ * per-thread shadow stack of (func, tstart) is enough to
+ * match them. Symbols are resolved once per function address
+ * and cached, a per-thread direct-mapped cache in front of
+ * a global table, so the common path takes no lock and does
+ * no allocation.
+ *
+ * Filters (RECORDER_USER_* in recorder.h) are resolved once,
+ * at init, to sorted address intervals; the enter hook only
+ * does a binary search, see user_function_traced().
+ *
+ * Each distinct (symbol, object) gets a function id above
+ * func_list, so records carry no names. The ids are made
+ * global and the names saved at finalize time, see
+ * function_profiler_finalize().
+ */
 
-typedef struct tstart_node {
-    double tstart;
-    struct tstart_node *next;
-} tstart_node_t;
+#define SHADOW_STACK_SIZE   256     // deeper frames are not recorded
+#define SYMBOL_CACHE_SIZE   1024    // per thread, power of 2
 
-typedef struct func_hash {
-    int key_len;
-    void *key;          // thread id + func addr as key
-    tstart_node_t *tstart_head;
+typedef struct symbol {
+    void* func;             // key
+    char* fname;            // NULL if dladdr() knows nothing about it
+    char* sname;
+    uint16_t id;            // RECORDER_USER_FUNCTION if out of ids
     UT_hash_handle hh;
-} func_hash_t;
+} symbol_t;
 
+/*
+ * Distinct "symbol\tobject" names, aliases (e.g., static
+ * functions of the same name) share one. Ids are given
+ * in insertion order, RECORDER_USER_FUNCTION_START + i.
+ */
+typedef struct user_func {
+    char* name;             // key
+    uint16_t id;
+    UT_hash_handle hh;
+} user_func_t;
 
-func_hash_t* func_table;
+typedef struct shadow_frame {
+    void*  func;
+    double tstart;          // -1 if not traced, e.g., paused at enter
+} shadow_frame_t;
 
+static symbol_t* symbol_table = NULL;
+static user_func_t* user_funcs = NULL;
+static int num_user_funcs = 0;
+static pthread_mutex_t symbol_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-void* compose_func_hash_key(void* func, int *key_len) {
-    pthread_t tid = recorder_gettid();
-    *key_len = sizeof(pthread_t) + sizeof(void*);
-    void* key = recorder_malloc(*key_len);
-    memcpy(key, &tid, sizeof(pthread_t));
-    memcpy(key+sizeof(pthread_t), &func, sizeof(void*));
-    return key;
-}
+static __thread symbol_t* symbol_cache[SYMBOL_CACHE_SIZE];
+static __thread shadow_frame_t shadow_stack[SHADOW_STACK_SIZE];
+static __thread int shadow_depth = 0;
 
 
 void __cyg_profile_func_enter(void *func, void *caller)
                               __attribute__((no_instrument_function));
+void __cyg_profile_func_exit(void *func, void *caller)
+                             __attribute__((no_instrument_function));
 
-void __cyg_profile_func_enter (void *func,  void *caller)
-{
-    if(!logger_initialized()) return;
 
-    Dl_info info;
-    if(!dladdr(func, &info)) return;
-    if(!info.dli_sname && !info.dli_fname) return;
+/*
+ * Id of a name, a new one if not in the table yet
+ */
+static uint16_t user_func_id(user_func_t** table, int* count, const char* name, int len) {
+    user_func_t* uf = NULL;
+    HASH_FIND(hh, *table, name, len, uf);
+    if(uf) return uf->id;
+    if(*count >= RECORDER_MAX_USER_FUNCS)
+        return RECORDER_USER_FUNCTION;
 
-    //printf("enter %s %s\n", info.dli_fname, info.dli_sname);
+    uf = malloc(sizeof(user_func_t));
+    uf->name = strndup(name, len);
+    uf->id = RECORDER_USER_FUNCTION_START + (*count)++;
+    HASH_ADD_KEYPTR(hh, *table, uf->name, len, uf);
+    return uf->id;
+}
 
-    func_hash_t *entry = NULL;
-    int key_len;
-    void* key = compose_func_hash_key(func, &key_len);
-    HASH_FIND(hh, func_table, key, key_len, entry);
-    if(entry) {
-        recorder_free(key, key_len);
-    } else {
-        entry = recorder_malloc(sizeof(func_hash_t));
-        entry->key = key;
-        entry->key_len = key_len;
-        entry->tstart_head = NULL;
-        HASH_ADD_KEYPTR(hh, func_table, entry->key, entry->key_len, entry);
+static void free_user_funcs(user_func_t** table) {
+    user_func_t *uf, *tmp;
+    HASH_ITER(hh, *table, uf, tmp) {
+        HASH_DEL(*table, uf);
+        free(uf->name);
+        free(uf);
     }
+}
+
+/*
+ * Symbols are never freed, records point to their names
+ */
+static symbol_t* lookup_symbol(void* func) {
+    size_t slot = ((uintptr_t)func >> 4) & (SYMBOL_CACHE_SIZE-1);
+    symbol_t* sym = symbol_cache[slot];
+    if(sym && sym->func == func)
+        return sym;
+
+    pthread_mutex_lock(&symbol_mutex);
+    HASH_FIND_PTR(symbol_table, &func, sym);
+    if(!sym) {
+        sym = recorder_malloc(sizeof(symbol_t));
+        sym->func  = func;
+        sym->fname = NULL;
+        sym->sname = NULL;
+        sym->id    = RECORDER_USER_FUNCTION;
+        Dl_info info;
+        if(dladdr(func, &info) && (info.dli_fname || info.dli_sname)) {
+            sym->fname = strdup(info.dli_fname ? info.dli_fname : "???");
+            sym->sname = strdup(info.dli_sname ? info.dli_sname : "???");
+            char name[strlen(sym->sname) + strlen(sym->fname) + 2];
+            int len = sprintf(name, "%s\t%s", sym->sname, sym->fname);
+            sym->id = user_func_id(&user_funcs, &num_user_funcs, name, len);
+        }
+        HASH_ADD_PTR(symbol_table, func, sym);
+    }
+    pthread_mutex_unlock(&symbol_mutex);
 
-    tstart_node_t *node = recorder_malloc(sizeof(tstart_node_t));
-    node->tstart = recorder_wtime();
-    LL_PREPEND(entry->tstart_head, node);
+    symbol_cache[slot] = sym;
+    return sym;
 }
 
 
-void __cyg_profile_func_exit(void *func, void *caller)
-                             __attribute__((no_instrument_function));
+/*
+ * [start, end) of an object or a function symbol
+ * and whether calls in it are traced
+ */
+typedef struct addr_interval {
+    uintptr_t start, end;
+    bool traced;
+} addr_interval_t;
+
+typedef struct interval_set {
+    addr_interval_t* list;
+    int count, capacity;
+} interval_set_t;
+
+static bool filters_enabled = false;
+static bool default_traced = true;      // for addresses in no interval
+static interval_set_t object_intervals;
+static interval_set_t symbol_intervals; // take precedence over objects
+static double min_duration = 0;         // in seconds
+
+static char** object_inclusion = NULL;
+static char** object_exclusion = NULL;
+static regex_t symbol_inclusion, symbol_exclusion;
+static bool has_symbol_inclusion = false, has_symbol_exclusion = false;
+
+
+static void interval_add(interval_set_t* set, uintptr_t start, uintptr_t end, bool traced) {
+    if(set->count == set->capacity) {
+        set->capacity = set->capacity ? set->capacity*2 : 64;
+        set->list = realloc(set->list, set->capacity*sizeof(addr_interval_t));
+    }
+    addr_interval_t* iv = &set->list[set->count++];
+    iv->start = start;
+    iv->end = end;
+    iv->traced = traced;
+}
+
+static int interval_cmp(const void* a, const void* b) {
+    uintptr_t sa = ((const addr_interval_t*)a)->start;
+    uintptr_t sb = ((const addr_interval_t*)b)->start;
+    return (sa > sb) - (sa < sb);
+}
+
+/*
+ * Sort by start and merge duplicates, e.g., aliases
+ * of one function, traced if any of them is
+ */
+static void interval_sort(interval_set_t* set) {
+    if(set->count == 0) return;
+    qsort(set->list, set->count, sizeof(addr_interval_t), interval_cmp);
+    int n = 0;
+    for(int i = 1; i < set->count; i++) {
+        if(set->list[i].start == set->list[n].start) {
+            set->list[n].traced |= set->list[i].traced;
+            if(set->list[i].end > set->list[n].end)
+                set->list[n].end = set->list[i].end;
+        } else {
+            set->list[++n] = set->list[i];
+        }
+    }
+    set->count = n+1;
+}
+
+/*
+ * The last interval starting at or before addr,
+ * NULL if addr is not in it
+ */
+static addr_interval_t* interval_find(interval_set_t* set, uintptr_t addr) {
+    int lo = 0, hi = set->count-1, found = -1;
+    while(lo <= hi) {
+        int mid = (lo+hi) / 2;
+        if(set->list[mid].start <= addr) {
+            found = mid;
+            lo = mid+1;
+        } else {
+            hi = mid-1;
+        }
+    }
+    if(found == -1 || addr >= set->list[found].end)
+        return NULL;
+    return &set->list[found];
+}
+
+static inline bool user_function_traced(void* func) {
+    if(!filters_enabled)
+        return true;
+    addr_interval_t* iv = interval_find(&symbol_intervals, (uintptr_t)func);
+    if(!iv)
+        iv = interval_find(&object_intervals, (uintptr_t)func);
+    return iv ? iv->traced : default_traced;
+}
+
+static bool symbol_selected(const char* name) {
+    if(has_symbol_inclusion && regexec(&symbol_inclusion, name, 0, NULL, 0) != 0)
+        return false;
+    if(has_symbol_exclusion && regexec(&symbol_exclusion, name, 0, NULL, 0) == 0)
+        return false;
+    return true;
+}
+
+/*
+ * Add the function symbols of an object, loaded at base, whose
+ * decision differs from that of the rest of the object. Uses
+ * .symtab, or .dynsym if the object was stripped.
+ */
+static void add_symbol_intervals(const char* path, uintptr_t base, bool object_traced) {
+    GOTCHA_SET_REAL_CALL(open,  RECORDER_POSIX);
+    GOTCHA_SET_REAL_CALL(lseek, RECORDER_POSIX);
+    GOTCHA_SET_REAL_CALL(mmap,  RECORDER_POSIX);
+    GOTCHA_SET_REAL_CALL(close, RECORDER_POSIX);
+
+    int fd = GOTCHA_REAL_CALL(open)(path, O_RDONLY);
+    if(fd < 0) return;
+    off_t file_size = GOTCHA_REAL_CALL(lseek)(fd, 0, SEEK_END);
+    if(file_size < (off_t)sizeof(ElfW(Ehdr))) {
+        GOTCHA_REAL_CALL(close)(fd);
+        return;
+    }
+    char* data = GOTCHA_REAL_CALL(mmap)(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    GOTCHA_REAL_CALL(close)(fd);
+    if(data == MAP_FAILED) return;
+
+    ElfW(Ehdr)* ehdr = (ElfW(Ehdr)*) data;
+    if(memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 || ehdr->e_shoff == 0 ||
+       ehdr->e_shoff + ehdr->e_shnum*sizeof(ElfW(Shdr)) > file_size) {
+        munmap(data, file_size);
+        return;
+    }
+
+    ElfW(Shdr)* shdrs = (ElfW(Shdr)*) (data + ehdr->e_shoff);
+    ElfW(Shdr)* symtab = NULL;
+    for(int i = 0; i < ehdr->e_shnum; i++) {
+        if(shdrs[i].sh_type == SHT_SYMTAB)
+            symtab = &shdrs[i];
+        if(shdrs[i].sh_type == SHT_DYNSYM && symtab == NULL)
+            symtab = &shdrs[i];
+    }
+
+    ElfW(Shdr)* strtab = symtab && symtab->sh_link < ehdr->e_shnum ? &shdrs[symtab->sh_link] : NULL;
+    if(strtab && symtab->sh_offset + symtab->sh_size <= file_size &&
+       strtab->sh_offset + strtab->sh_size <= file_size) {
+        ElfW(Sym)* syms = (ElfW(Sym)*) (data + symtab->sh_offset);
+        size_t num_syms = symtab->sh_size / sizeof(ElfW(Sym));
+        for(size_t i = 0; i < num_syms; i++) {
+            if(ELF64_ST_TYPE(syms[i].st_info) != STT_FUNC || syms[i].st_value == 0 ||
+               syms[i].st_name >= strtab->sh_size)
+                continue;
+            const char* name = data + strtab->sh_offset + syms[i].st_name;
+            bool traced = symbol_selected(name);
+            if(traced != object_traced) {
+                uintptr_t start = base + syms[i].st_value;
+                size_t size = syms[i].st_size ? syms[i].st_size : 1;
+                interval_add(&symbol_intervals, start, start+size, traced);
+            }
+        }
+    }
+    munmap(data, file_size);
+}
+
+static int add_object_intervals(struct dl_phdr_info* info, size_t size, void* arg) {
+    // the executable comes with an empty name
+    char* path = realrealpath(info->dlpi_name[0] ? info->dlpi_name : "/proc/self/exe");
+    if(!path) return 0;
+
+    bool selected = true;
+    if(object_inclusion && !match_glob_list(object_inclusion, path))
+        selected = false;
+    if(object_exclusion && match_glob_list(object_exclusion, path))
+        selected = false;
+
+    // functions of a selected object are traced unless only
+    // some symbols are included, those are added below
+    bool traced = selected && !has_symbol_inclusion;
+
+    uintptr_t start = UINTPTR_MAX, end = 0;
+    for(int i = 0; i < info->dlpi_phnum; i++) {
+        if(info->dlpi_phdr[i].p_type != PT_LOAD) continue;
+        uintptr_t seg_start = info->dlpi_addr + info->dlpi_phdr[i].p_vaddr;
+        uintptr_t seg_end = seg_start + info->dlpi_phdr[i].p_memsz;
+        if(seg_start < start) start = seg_start;
+        if(seg_end > end) end = seg_end;
+    }
+    if(start < end) {
+        interval_add(&object_intervals, start, end, traced);
+        if(selected && (has_symbol_inclusion || has_symbol_exclusion))
+            add_symbol_intervals(path, info->dlpi_addr, traced);
+    }
+    free(path);
+    return 0;
+}
+
+static bool compile_regex(regex_t* re, const char* env) {
+    const char* pattern = getenv(env);
+    if(pattern == NULL || pattern[0] == 0)
+        return false;
+    if(regcomp(re, pattern, REG_EXTENDED|REG_NOSUB) != 0) {
+        RECORDER_LOGERR("[Recorder] invalid regex in %s: %s\n", env, pattern);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Objects loaded later, e.g., by dlopen(), are in no
+ * interval; they are traced only without inclusion filters.
+ */
+void function_profiler_init() {
+    const char* min_duration_str = getenv(RECORDER_USER_MIN_DURATION);
+    if(min_duration_str)
+        min_duration = atof(min_duration_str) / 1e6;
+
+    object_inclusion = parse_glob_list(getenv(RECORDER_USER_OBJECT_INCLUSION));
+    object_exclusion = parse_glob_list(getenv(RECORDER_USER_OBJECT_EXCLUSION));
+    has_symbol_inclusion = compile_regex(&symbol_inclusion, RECORDER_USER_SYMBOL_INCLUSION);
+    has_symbol_exclusion = compile_regex(&symbol_exclusion, RECORDER_USER_SYMBOL_EXCLUSION);
+    if(!object_inclusion && !object_exclusion && !has_symbol_inclusion && !has_symbol_exclusion)
+        return;
+
+    double t0 = recorder_wtime();
+    default_traced = !object_inclusion && !has_symbol_inclusion;
+    dl_iterate_phdr(add_object_intervals, NULL);
+    interval_sort(&object_intervals);
+    interval_sort(&symbol_intervals);
+    filters_enabled = true;
+    RECORDER_LOGDBG("[Recorder] user function filters: %d objects, %d symbols, %.6f s\n",
+                    object_intervals.count, symbol_intervals.count, recorder_wtime()-t0);
+}
+
+
+void __cyg_profile_func_enter (void *func,  void *caller)
+{
+    int depth = shadow_depth++;
+    if(depth >= SHADOW_STACK_SIZE) return;
+
+    shadow_stack[depth].func = func;
+    shadow_stack[depth].tstart = -1;
+    if(logger_initialized() && !logger_paused() && user_function_traced(func))
+        shadow_stack[depth].tstart = recorder_wtime();
+}
 
 
 void __cyg_profile_func_exit (void *func,  void *caller)
 {
-    if(!logger_initialized()) return;
-
-    Dl_info info;
-    if(!dladdr(func, &info)) return;
-    if(!info.dli_sname && !info.dli_fname) return;
-
-    func_hash_t *entry = NULL;
-    int key_len;
-    void* key = compose_func_hash_key(func, &key_len);
-    HASH_FIND(hh, func_table, key, key_len, entry);
-    recorder_free(key, key_len);
-
-    if(entry) {
-        Record *record = recorder_malloc(sizeof(Record));
-        record->func_id = RECORDER_USER_FUNCTION;
-        record->call_depth = 0;
-        record->tid = recorder_gettid();
-        record->tstart = entry->tstart_head->tstart;
-        record->tend = recorder_wtime();
-        record->arg_count = 2;
-        record->args = recorder_malloc(record->arg_count*sizeof(char*));
-        record->args[0] = strdup(info.dli_fname?info.dli_fname:"???");
-        record->args[1] = strdup(info.dli_sname?info.dli_sname:"???");
-
-        LL_DELETE(entry->tstart_head, entry->tstart_head);
-        write_record(record);
-
-        if(entry->tstart_head == NULL) {
-            HASH_DEL(func_table, entry);
-            recorder_free(entry->key, entry->key_len);
-            recorder_free(entry, sizeof(func_hash_t));
+    if(shadow_depth == 0) return;
+    int depth = --shadow_depth;
+    if(depth >= SHADOW_STACK_SIZE) return;
+
+    shadow_frame_t* frame = &shadow_stack[depth];
+    if(frame->tstart < 0 || frame->func != func || !logger_initialized())
+        return;
+
+    double tend = recorder_wtime();
+    if(tend - frame->tstart < min_duration)
+        return;
+
+    symbol_t* sym = lookup_symbol(func);
+    if(!sym->fname) return;
+
+    Record record;
+    memset(&record, 0, sizeof(Record));
+    record.func_id = sym->id;
+    record.call_depth = 0;
+    record.res = 0;
+    record.tid = recorder_gettid();
+    record.tstart = frame->tstart;
+    record.tend = tend;
+
+    // Out of ids, keep the names in the record. write_record()
+    // only reads the args, so they can point to the symbol table
+    char* args[2] = {sym->fname, sym->sname};
+    if(sym->id == RECORDER_USER_FUNCTION) {
+        record.arg_count = 2;
+        record.args = args;
+    }
+    write_record(&record);
+}
+
+
+/*
+ * "symbol\tobject\n" of each name, in the order of their ids
+ */
+static char* serialize_user_funcs(user_func_t* table, size_t* size) {
+    user_func_t* uf;
+    *size = 0;
+    for(uf = table; uf != NULL; uf = uf->hh.next)
+        *size += strlen(uf->name) + 1;
+
+    char* buf = recorder_malloc(*size + 1);
+    char* ptr = buf;
+    for(uf = table; uf != NULL; uf = uf->hh.next)
+        ptr += sprintf(ptr, "%s\n", uf->name);
+    return buf;
+}
+
+static void merge_user_funcs(user_func_t** table, int* count, const char* buf, size_t size) {
+    const char* end = buf + size;
+    while(buf < end) {
+        const char* eol = memchr(buf, '\n', end-buf);
+        if(!eol) break;
+        user_func_id(table, count, buf, eol-buf);
+        buf = eol + 1;
+    }
+}
+
+/*
+ * Names of all ranks, merged on a binomial tree like
+ * compress_csts() and broadcast from rank 0. Ids are
+ * given in the order rank 0 sees the names.
+ */
+static char* gather_user_funcs(RecorderLogger* logger, size_t* size) {
+    user_func_t* merged = NULL;
+    int merged_count = 0;
+    size_t buf_size;
+    char* buf = serialize_user_funcs(user_funcs, &buf_size);
+    merge_user_funcs(&merged, &merged_count, buf, buf_size);
+    recorder_free(buf, buf_size+1);
+
+    int mask = 1;
+    int phases = recorder_ceil(recorder_log2(logger->nprocs));
+    for(int k = 0; k < phases; k++, mask*=2) {
+        int other_rank = logger->rank ^ mask;
+        if(other_rank >= logger->nprocs) continue;
+
+        if(logger->rank < other_rank) {
+            recorder_recv(&buf_size, sizeof(buf_size), other_rank, mask, MPI_COMM_WORLD);
+            buf = recorder_malloc(buf_size);
+            recorder_recv(buf, buf_size, other_rank, mask, MPI_COMM_WORLD);
+            merge_user_funcs(&merged, &merged_count, buf, buf_size);
+            recorder_free(buf, buf_size);
+        } else {
+            buf = serialize_user_funcs(merged, &buf_size);
+            recorder_send(&buf_size, sizeof(buf_size), other_rank, mask, MPI_COMM_WORLD);
+            recorder_send(buf, buf_size, other_rank, mask, MPI_COMM_WORLD);
+            recorder_free(buf, buf_size+1);
+            break;
         }
+    }
 
-        free_record(record);
-    } else {
-        // Shouldn't be possible
-        printf("Not possible!\n");
+    if(logger->rank == 0)
+        buf = serialize_user_funcs(merged, size);
+    free_user_funcs(&merged);
+    if(logger->nprocs > 1) {
+        recorder_bcast(size, sizeof(*size), 0, MPI_COMM_WORLD);
+        if(logger->rank != 0)
+            buf = recorder_malloc(*size + 1);
+        recorder_bcast(buf, *size, 0, MPI_COMM_WORLD);
     }
+    return buf;
 }
 
+/*
+ * Key of a user function record without a global id: the
+ * same as for a record out of local ids (RECORDER_USER_FUNCTION
+ * with the object and symbol as args), so the reader can still
+ * name it. name is "symbol\tobject", the key had no args.
+ */
+static void user_func_key_with_names(CallSignature* cs, const char* name) {
+    const char* tab = strchr(name, '\t');
+    int sname_len = tab - name;
+    const char* fname = tab + 1;
+    int fname_len = strlen(fname);
+
+    Record r;
+    int args_start = cs_key_args_start();
+    int args_end = cs_key_args_end(cs);
+    int args_strlen = fname_len + sname_len + 2;
+    int key_len = cs->key_len - (args_end - args_start) + args_strlen;
+    char* key = recorder_malloc(key_len);
+    memcpy(key, cs->key, args_start);
+
+    // spaces separate the args, see compose_cs_key()
+    char* args = key + args_start;
+    for(int i = 0; i < fname_len; i++)
+        *args++ = (fname[i] == ' ') ? '_' : fname[i];
+    *args++ = ' ';
+    for(int i = 0; i < sname_len; i++)
+        *args++ = (name[i] == ' ') ? '_' : name[i];
+    *args++ = ' ';
+    memcpy(args, (char*)cs->key + args_end, cs->key_len - args_end);
+
+    uint16_t func_id = RECORDER_USER_FUNCTION;
+    r.arg_count = 2;
+    memcpy(key + sizeof(pthread_t), &func_id, sizeof(func_id));
+    memcpy(key + args_start - sizeof(int) - sizeof(r.arg_count), &r.arg_count, sizeof(r.arg_count));
+    memcpy(key + args_start - sizeof(int), &args_strlen, sizeof(int));
+
+    recorder_free(cs->key, cs->key_len);
+    cs->key = key;
+    cs->key_len = key_len;
+}
+
+/*
+ * Replace the local ids in the keys of the CST with the
+ * global ones. Must be called by all ranks, before the
+ * CST is saved. Rank 0 writes the names to recorder.sym,
+ * one line per id, starting from RECORDER_USER_FUNCTION_START.
+ */
+void function_profiler_finalize(RecorderLogger* logger) {
+    pthread_mutex_lock(&symbol_mutex);
+
+    size_t size;
+    char* buf = gather_user_funcs(logger, &size);
+
+    if(logger->rank == 0 && size > 0) {
+        char sym_filename[1024] = {0};
+        sprintf(sym_filename, "%s/recorder.sym", logger->traces_dir);
+        FILE* f = GOTCHA_REAL_CALL(fopen)(sym_filename, "w");
+        if(f) {
+            GOTCHA_REAL_CALL(fwrite)(buf, 1, size, f);
+            GOTCHA_REAL_CALL(fclose)(f);
+        }
+    }
+
+    user_func_t* global = NULL;
+    int global_count = 0;
+    merge_user_funcs(&global, &global_count, buf, size);
+    recorder_free(buf, size+1);
+
+    // local id - RECORDER_USER_FUNCTION_START -> global id,
+    // RECORDER_USER_FUNCTION if the merged names ran out of ids
+    uint16_t* id_map = malloc(sizeof(uint16_t) * (num_user_funcs+1));
+    const char** id_names = malloc(sizeof(char*) * (num_user_funcs+1));
+    int overflow = 0;
+    for(user_func_t* uf = user_funcs; uf != NULL; uf = uf->hh.next) {
+        user_func_t* g = NULL;
+        HASH_FIND_STR(global, uf->name, g);
+        id_map[uf->id - RECORDER_USER_FUNCTION_START] = g ? g->id : RECORDER_USER_FUNCTION;
+        id_names[uf->id - RECORDER_USER_FUNCTION_START] = uf->name;
+        overflow += (g == NULL);
+    }
+    free_user_funcs(&global);
+    if(overflow)
+        RECORDER_LOGERR("[Recorder] rank %d: %d user functions beyond the %d ids, "
+                        "their records keep the names as args\n",
+                        logger->rank, overflow, RECORDER_MAX_USER_FUNCS);
+
+    // Two local ids may swap, so the keys are changed
+    // first and the table is built anew, in the same order
+    int id_pos = sizeof(pthread_t);
+    bool changed = false;
+    for(int i = 0; i < cs_table_count(&logger->cst); i++) {
+        CallSignature* cs = logger->cst.entries[i];
+        uint16_t id;
+        memcpy(&id, cs->key+id_pos, sizeof(id));
+        if(id < RECORDER_USER_FUNCTION_START || id >= RECORDER_USER_FUNCTION_START+num_user_funcs)
+            continue;
+        uint16_t new_id = id_map[id - RECORDER_USER_FUNCTION_START];
+        if(new_id == id) continue;
+
+        if(new_id == RECORDER_USER_FUNCTION)
+            user_func_key_with_names(cs, id_names[id - RECORDER_USER_FUNCTION_START]);
+        else
+            memcpy(cs->key+id_pos, &new_id, sizeof(new_id));
+        cs->hash = cs_key_hash(cs->key, cs->key_len);
+        changed = true;
+    }
+    if(changed) {
+        CSTable cst;
+        cs_table_init(&cst);
+        for(int i = 0; i < cs_table_count(&logger->cst); i++)
+            cs_table_add(&cst, logger->cst.entries[i]);
+        cs_table_destroy(&logger->cst);
+        logger->cst = cst;
+    }
+    free(id_map);
+    free(id_names);
+
+    pthread_mutex_unlock(&symbol_mutex);
+}
@@ -1,3 +1,7 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include "recorder-gotcha.h"
 #include "recorder.h"
 
@@ -5,6 +9,14 @@ static bool posix_tracing = true;
 static bool mpi_tracing   = false;
 static bool mpiio_tracing = true;
 static bool hdf5_tracing  = true;
+static bool async_tracing = true;
+
+// Function ids that have at least one binding wrapped
+static bool func_traced[RECORDER_MAX_FUNCS];
+
+// Glob patterns of RECORDER_FUNCTION_INCLUSION/EXCLUSION
+static char** func_inclusion = NULL;
+static char** func_exclusion = NULL;
 
 struct gotcha_binding_t posix_wrap_actions [] = {
     GOTCHA_WRAP_ACTION(creat),
@@ -55,6 +67,36 @@ struct gotcha_binding_t posix_wrap_actions [] = {
     GOTCHA_WRAP_ACTION(__fxstat64),
 #endif
 #endif
+#if __GLIBC__ == 2 && __GLIBC_MINOR__ >= 33
+    GOTCHA_WRAP_ACTION(stat),
+    GOTCHA_WRAP_ACTION(stat64),
+    GOTCHA_WRAP_ACTION(lstat),
+    GOTCHA_WRAP_ACTION(lstat64),
+    GOTCHA_WRAP_ACTION(fstat),
+    GOTCHA_WRAP_ACTION(fstat64),
+    GOTCHA_WRAP_ACTION(fstatat),
+    GOTCHA_WRAP_ACTION(fstatat64),
+#endif
+#ifdef HAVE_STATX
+    GOTCHA_WRAP_ACTION(statx),
+#endif
+    GOTCHA_WRAP_ACTION(preadv),
+    GOTCHA_WRAP_ACTION(preadv64),
+    GOTCHA_WRAP_ACTION(pwritev),
+    GOTCHA_WRAP_ACTION(pwritev64),
+#ifdef HAVE_PREADV2
+    GOTCHA_WRAP_ACTION(preadv2),
+    GOTCHA_WRAP_ACTION(preadv64v2),
+    GOTCHA_WRAP_ACTION(pwritev2),
+    GOTCHA_WRAP_ACTION(pwritev64v2),
+#endif
+    GOTCHA_WRAP_ACTION(openat),
+    GOTCHA_WRAP_ACTION(openat64),
+#ifdef HAVE_COPY_FILE_RANGE
+    GOTCHA_WRAP_ACTION(copy_file_range),
+#endif
+    GOTCHA_WRAP_ACTION(posix_fadvise),
+    GOTCHA_WRAP_ACTION(posix_fadvise64),
     GOTCHA_WRAP_ACTION(getcwd),
     GOTCHA_WRAP_ACTION(mkdir),
     GOTCHA_WRAP_ACTION(rmdir),
@@ -255,32 +297,114 @@ struct gotcha_binding_t hdf5_wrap_actions [] = {
     GOTCHA_WRAP_ACTION(H5Pget_all_coll_metadata_ops)
 };
 
+struct gotcha_binding_t async_wrap_actions [] = {
+    GOTCHA_WRAP_ACTION(aio_read),
+    GOTCHA_WRAP_ACTION(aio_read64),
+    GOTCHA_WRAP_ACTION(aio_write),
+    GOTCHA_WRAP_ACTION(aio_write64),
+    GOTCHA_WRAP_ACTION(aio_suspend),
+    GOTCHA_WRAP_ACTION(aio_suspend64),
+    GOTCHA_WRAP_ACTION(aio_return),
+    GOTCHA_WRAP_ACTION(aio_return64),
+#ifdef HAVE_LIBURING
+    GOTCHA_WRAP_ACTION(io_uring_submit),
+    GOTCHA_WRAP_ACTION(io_uring_submit_and_wait),
+    GOTCHA_WRAP_ACTION(__io_uring_get_cqe),
+    GOTCHA_WRAP_ACTION(io_uring_wait_cqes),
+    GOTCHA_WRAP_ACTION(io_uring_wait_cqe_timeout),
+    GOTCHA_WRAP_ACTION(io_uring_peek_batch_cqe),
+#endif
+};
+
+/*
+ * The func_list name a binding records under, e.g.,
+ * stat64 as stat, preadv64v2 as preadv2
+ */
+static int binding_func_id(const char* symbol) {
+    size_t count = sizeof(func_list) / sizeof(char*);
+    char name[128];
+    snprintf(name, sizeof(name), "%s", symbol);
+    if(strcmp(name, "__io_uring_get_cqe") == 0)
+        snprintf(name, sizeof(name), "io_uring_wait_cqe");
+
+    for(int pass = 0; pass < 2; pass++) {
+        for(int i = 0; i < count; i++)
+            if(strcmp(func_list[i], name) == 0)
+                return i;
+        char* lfs = strstr(name, "64");
+        if(lfs == NULL)
+            break;
+        memmove(lfs, lfs+2, strlen(lfs+2)+1);
+    }
+    return -1;
+}
+
+#define NUM_ACTIONS(actions) (sizeof(actions)/sizeof(struct gotcha_binding_t))
+
+/*
+ * The bindings of all layers that are selected, wrapped
+ * by a single gotcha_wrap() call: every call makes GOTCHA
+ * walk all loaded objects again, so one batch instead of
+ * one per layer matters for startup time. GOTCHA keeps
+ * a pointer to the bindings, hence the static table.
+ */
+static struct gotcha_binding_t selected_actions[NUM_ACTIONS(posix_wrap_actions) +
+                                                NUM_ACTIONS(mpi_wrap_actions) +
+                                                NUM_ACTIONS(mpiio_wrap_actions) +
+                                                NUM_ACTIONS(hdf5_wrap_actions) +
+                                                NUM_ACTIONS(async_wrap_actions)];
+static int num_selected_actions = 0;
+
+/*
+ * Add the bindings of a layer whose func_list name is
+ * selected, others are not touched at all.
+ */
+static void select_actions(struct gotcha_binding_t* actions, int count, const char* layer) {
+    int num_selected = 0;
+    for(int i = 0; i < count; i++) {
+        int id = binding_func_id(actions[i].name);
+        const char* name = (id == -1) ? actions[i].name : func_list[id];
+        if(func_inclusion && !match_glob_list(func_inclusion, name))
+            continue;
+        if(func_exclusion && match_glob_list(func_exclusion, name))
+            continue;
+        selected_actions[num_selected_actions++] = actions[i];
+        num_selected++;
+        if(id != -1)
+            func_traced[id] = true;
+    }
+    RECORDER_LOGDBG("[Recorder] %s: %d of %d functions wrapped\n", layer, num_selected, count);
+}
+
 void gotcha_register_functions() {
     char* posix_tracing_env = getenv(RECORDER_POSIX_TRACING);
     char* mpi_tracing_env   = getenv(RECORDER_MPI_TRACING);
     char* mpiio_tracing_env = getenv(RECORDER_MPIIO_TRACING);
     char* hdf5_tracing_env  = getenv(RECORDER_HDF5_TRACING);
+    char* async_tracing_env = getenv(RECORDER_ASYNC_TRACING);
     if (posix_tracing_env) posix_tracing = atoi(posix_tracing_env);
     if (mpi_tracing_env) mpi_tracing = atoi(mpi_tracing_env);
     if (mpiio_tracing_env) mpiio_tracing = atoi(mpiio_tracing_env);
     if (hdf5_tracing_env) hdf5_tracing = atoi(hdf5_tracing_env);
+    if (async_tracing_env) async_tracing = atoi(async_tracing_env);
+
+    func_inclusion = parse_glob_list(getenv(RECORDER_FUNCTION_INCLUSION));
+    func_exclusion = parse_glob_list(getenv(RECORDER_FUNCTION_EXCLUSION));
 
+    num_selected_actions = 0;
     if (posix_tracing)
-        gotcha_wrap(posix_wrap_actions,
-                    sizeof(posix_wrap_actions)/sizeof(struct gotcha_binding_t),
-                    "recorder_posix_actions");
+        select_actions(posix_wrap_actions, NUM_ACTIONS(posix_wrap_actions), "posix");
     if (mpi_tracing)
-        gotcha_wrap(mpi_wrap_actions,
-                    sizeof(mpi_wrap_actions)/sizeof(struct gotcha_binding_t),
-                    "recorder_mpi_actions");
+        select_actions(mpi_wrap_actions, NUM_ACTIONS(mpi_wrap_actions), "mpi");
     if (mpiio_tracing)
-        gotcha_wrap(mpiio_wrap_actions,
-                    sizeof(mpiio_wrap_actions)/sizeof(struct gotcha_binding_t),
-                    "recorder_mpiio_actions");
+        select_actions(mpiio_wrap_actions, NUM_ACTIONS(mpiio_wrap_actions), "mpiio");
     if (hdf5_tracing)
-        gotcha_wrap(hdf5_wrap_actions,
-                    sizeof(hdf5_wrap_actions)/sizeof(struct gotcha_binding_t),
-                    "recorder_hdf5_actions");
+        select_actions(hdf5_wrap_actions, NUM_ACTIONS(hdf5_wrap_actions), "hdf5");
+    if (async_tracing)
+        select_actions(async_wrap_actions, NUM_ACTIONS(async_wrap_actions), "async");
+
+    if (num_selected_actions > 0)
+        gotcha_wrap(selected_actions, num_selected_actions, "recorder_actions");
 }
 
 bool gotcha_posix_tracing() {
@@ -295,6 +419,12 @@ bool gotcha_mpiio_tracing() {
 bool gotcha_hdf5_tracing() {
     return hdf5_tracing;
 }
+bool gotcha_async_tracing() {
+    return async_tracing;
+}
+bool gotcha_func_traced(int func_id) {
+    return func_id >= 0 && func_id < RECORDER_MAX_FUNCS && func_traced[func_id];
+}
 
 void gotcha_init() {
     gotcha_register_functions();
@@ -47,6 +47,7 @@
 #include <string.h>
 #include <limits.h>
 #include "mpi.h"
+#include "uthash.h"
 #include "recorder.h"
 #include "hdf5.h"
 
@@ -54,7 +55,172 @@
 #define SMALL_BUF_SIZE 128
 #define LARGE_BUF_SIZE 1024
 
-void get_datatype_name(int class_id, int type, char *string) {
+/*
+ * Dimension array of a dataspace (dims, start, stride, ...)
+ * as an integer vector "[a,b,...]"; H5S_UNLIMITED becomes -1.
+ * NULL arrays, e.g., the default stride of a hyperslab,
+ * and invalid ranks are stored as "NULL".
+ */
+static char* hsizearrtoa(const hsize_t* arr, int rank) {
+    if(!arr || rank <= 0 || rank > H5S_MAX_RANK)
+        return strdup("NULL");
+    size_t tmp[H5S_MAX_RANK];
+    for(int i = 0; i < rank; i++)
+        tmp[i] = (size_t) arr[i];
+    return arrtoa(tmp, rank);
+}
+
+void get_datatype_name(int class_id, hid_t type, char *string);
+
+/*
+ * Name of each hid seen so far: datatype name, dataset
+ * path or file name, and the rank of datasets. Looked up
+ * once per hid, and dropped in H5Tclose/H5Dclose/H5Fclose/
+ * H5Oclose as HDF5 may hand out the same hid again afterwards,
+ * so these are traced also while paused (see recorder.h).
+ */
+typedef struct HidNameHash_t {
+    hid_t key;
+    char* name;
+    int   rank;     // datasets only, -2 if not looked up yet
+    UT_hash_handle hh;
+} HidNameHash;
+
+static HidNameHash* hid_name_table = NULL;
+static pthread_mutex_t hid_name_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static HidNameHash* hid_name_add(hid_t id, char* name) {
+    HidNameHash* entry = malloc(sizeof(HidNameHash));
+    entry->key  = id;
+    entry->name = name;
+    entry->rank = -2;
+    HASH_ADD(hh, hid_name_table, key, sizeof(hid_t), entry);
+    return entry;
+}
+
+/*
+ * Caller holds hid_name_mutex
+ */
+static HidNameHash* hid_name_lookup(hid_t id) {
+    HidNameHash* entry = NULL;
+    HASH_FIND(hh, hid_name_table, &id, sizeof(hid_t), entry);
+    if(entry)
+        return entry;
+
+    char* name = NULL;
+    switch(H5Iget_type(id)) {
+        case H5I_DATATYPE: {
+            GOTCHA_SET_REAL_CALL(H5Tget_class, RECORDER_HDF5);
+            name = calloc(SMALL_BUF_SIZE, sizeof(char));
+            get_datatype_name(GOTCHA_REAL_CALL(H5Tget_class)(id), id, name);
+            break;
+        }
+        case H5I_DATASET: {
+            ssize_t len = H5Iget_name(id, NULL, 0);
+            if(len > 0) {
+                name = calloc(len+1, sizeof(char));
+                H5Iget_name(id, name, len+1);
+            }
+            break;
+        }
+        case H5I_FILE: {
+            ssize_t len = H5Fget_name(id, NULL, 0);
+            if(len > 0) {
+                char* tmp = calloc(len+1, sizeof(char));
+                H5Fget_name(id, tmp, len+1);
+                name = realrealpath(tmp);
+                free(tmp);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    // Not a named object, or an invalid id:
+    // look up again next time
+    if(!name)
+        return NULL;
+    return hid_name_add(id, name);
+}
+
+/*
+ * Name of an hid as an argument string,
+ * the hid itself if it has none
+ */
+static char* hid2name(hid_t id) {
+    pthread_mutex_lock(&hid_name_mutex);
+    HidNameHash* entry = hid_name_lookup(id);
+    char* name = entry ? strdup(entry->name) : itoa(id);
+    pthread_mutex_unlock(&hid_name_mutex);
+    return name;
+}
+
+/*
+ * Remember the name of a newly opened file,
+ * the path is already resolved by the caller
+ */
+static void hid_name_set(hid_t id, const char* name) {
+    if(id < 0 || !name)
+        return;
+    pthread_mutex_lock(&hid_name_mutex);
+    HidNameHash* entry = NULL;
+    HASH_FIND(hh, hid_name_table, &id, sizeof(hid_t), entry);
+    if(entry) {
+        free(entry->name);
+        entry->name = strdup(name);
+    } else {
+        hid_name_add(id, strdup(name));
+    }
+    pthread_mutex_unlock(&hid_name_mutex);
+}
+
+/*
+ * Called by the close wrappers, after the hid is closed,
+ * so the name can no longer be looked up; return the
+ * cached one (or the hid) and drop it.
+ */
+static char* hid_name_remove(hid_t id) {
+    char* name = NULL;
+    pthread_mutex_lock(&hid_name_mutex);
+    HidNameHash* entry = NULL;
+    HASH_FIND(hh, hid_name_table, &id, sizeof(hid_t), entry);
+    if(entry) {
+        HASH_DEL(hid_name_table, entry);
+        name = entry->name;
+        free(entry);
+    }
+    pthread_mutex_unlock(&hid_name_mutex);
+    return name ? name : itoa(id);
+}
+
+/*
+ * Rank of a dataset, without tracing the calls needed to get it
+ */
+static int dataset_rank(hid_t dset_id) {
+    pthread_mutex_lock(&hid_name_mutex);
+    HidNameHash* entry = hid_name_lookup(dset_id);
+    if(entry && entry->rank != -2) {
+        int rank = entry->rank;
+        pthread_mutex_unlock(&hid_name_mutex);
+        return rank;
+    }
+
+    GOTCHA_SET_REAL_CALL(H5Dget_space, RECORDER_HDF5);
+    GOTCHA_SET_REAL_CALL(H5Sclose, RECORDER_HDF5);
+    int rank = -1;
+    hid_t space_id = GOTCHA_REAL_CALL(H5Dget_space)(dset_id);
+    if(space_id >= 0) {
+        rank = H5Sget_simple_extent_ndims(space_id);
+        GOTCHA_REAL_CALL(H5Sclose)(space_id);
+    }
+    if(entry)
+        entry->rank = rank;
+    pthread_mutex_unlock(&hid_name_mutex);
+    return rank;
+}
+
+void get_datatype_name(int class_id, hid_t type, char *string) {
   char *tmp = (char *)malloc(sizeof(char) * SMALL_BUF_SIZE);
   switch (class_id) {
   case H5T_INTEGER:
@@ -111,7 +277,7 @@ void get_datatype_name(int class_id, int type, char *string) {
     } else if (H5Tequal(type, H5T_NATIVE_ULLONG) == 1) {
       sprintf(tmp, "H5T_NATIVE_ULLONG");
     } else {
-      sprintf(tmp, "%d", type);
+      sprintf(tmp, "%ld", (long) type);
     }
     break;
 
@@ -137,7 +303,7 @@ void get_datatype_name(int class_id, int type, char *string) {
       sprintf(tmp, "H5T_NATIVE_LDOUBLE");
 #endif
     } else {
-      sprintf(tmp, "%d", type);
+      sprintf(tmp, "%ld", (long) type);
     }
     break;
 
@@ -171,7 +337,7 @@ void get_datatype_name(int class_id, int type, char *string) {
               break;
    */
   default:
-    sprintf(tmp, "%d", type);
+    sprintf(tmp, "%ld", (long) type);
   }
 
   strcpy(string, tmp);
@@ -253,24 +419,26 @@ static inline char *comm2name(MPI_Comm comm) {
 hid_t WRAPPER_NAME(H5Fcreate)(const char *filename, unsigned flags, hid_t create_plist, hid_t access_plist) {
     RECORDER_INTERCEPTOR_PROLOGUE(hid_t, H5Fcreate, (filename, flags, create_plist, access_plist));
     char **args = assemble_args_list(4, realrealpath(filename), itoa(flags), itoa(create_plist), itoa(access_plist));
+    hid_name_set(res, args[0]);
     RECORDER_INTERCEPTOR_EPILOGUE(4, args);
 }
 
 hid_t WRAPPER_NAME(H5Fopen)(const char *filename, unsigned flags, hid_t access_plist) {
     RECORDER_INTERCEPTOR_PROLOGUE(hid_t, H5Fopen, (filename, flags, access_plist));
     char **args = assemble_args_list(3, realrealpath(filename), itoa(flags), itoa(access_plist));
+    hid_name_set(res, args[0]);
     RECORDER_INTERCEPTOR_EPILOGUE(3, args);
 }
 
 herr_t WRAPPER_NAME(H5Fclose)(hid_t file_id) {
-    RECORDER_INTERCEPTOR_PROLOGUE(herr_t, H5Fclose, (file_id));
-    char **args = assemble_args_list(1, itoa(file_id));
+    RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(herr_t, H5Fclose, (file_id));
+    char **args = assemble_args_list(1, hid_name_remove(file_id));
     RECORDER_INTERCEPTOR_EPILOGUE(1, args);
 }
 
 herr_t WRAPPER_NAME(H5Fflush)(hid_t object_id, H5F_scope_t scope) {
     RECORDER_INTERCEPTOR_PROLOGUE(herr_t, H5Fflush, (object_id, scope));
-    char **args = assemble_args_list(2, itoa(object_id), itoa(scope));
+    char **args = assemble_args_list(2, hid2name(object_id), itoa(scope));
     RECORDER_INTERCEPTOR_EPILOGUE(2, args);
 }
 
@@ -322,8 +490,8 @@ hid_t WRAPPER_NAME(H5Gopen2)(hid_t loc_id, const char *name, hid_t gapl_id) {
 
 // Dataset interface
 herr_t WRAPPER_NAME(H5Dclose)(hid_t dataset_id) {
-    RECORDER_INTERCEPTOR_PROLOGUE(herr_t, H5Dclose, (dataset_id));
-    char **args = assemble_args_list(1, itoa(dataset_id));
+    RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(herr_t, H5Dclose, (dataset_id));
+    char **args = assemble_args_list(1, hid_name_remove(dataset_id));
     RECORDER_INTERCEPTOR_EPILOGUE(1, args);
 }
 
@@ -371,19 +539,19 @@ hid_t WRAPPER_NAME(H5Dopen2)(hid_t loc_id, const char *name, hid_t dapl_id) {
 
 herr_t WRAPPER_NAME(H5Dread)(hid_t dataset_id, hid_t mem_type_id, hid_t mem_space_id, hid_t file_space_id, hid_t xfer_plist_id, void *buf) {
     RECORDER_INTERCEPTOR_PROLOGUE(hid_t, H5Dread, (dataset_id, mem_type_id, mem_space_id, file_space_id, xfer_plist_id, buf));
-    char **args = assemble_args_list(6, itoa(dataset_id), itoa(mem_type_id), itoa(mem_space_id), itoa(file_space_id), itoa(xfer_plist_id), ptoa(buf));
+    char **args = assemble_args_list(6, hid2name(dataset_id), hid2name(mem_type_id), itoa(mem_space_id), itoa(file_space_id), itoa(xfer_plist_id), ptoa(buf));
     RECORDER_INTERCEPTOR_EPILOGUE(6, args);
 }
 
 herr_t WRAPPER_NAME(H5Dwrite)(hid_t dataset_id, hid_t mem_type_id, hid_t mem_space_id, hid_t file_space_id, hid_t xfer_plist_id, const void *buf) {
     RECORDER_INTERCEPTOR_PROLOGUE(hid_t, H5Dwrite, (dataset_id, mem_type_id, mem_space_id, file_space_id, xfer_plist_id, buf));
-    char **args = assemble_args_list(6, itoa(dataset_id), itoa(mem_type_id), itoa(mem_space_id), itoa(file_space_id), itoa(xfer_plist_id), ptoa(buf));
+    char **args = assemble_args_list(6, hid2name(dataset_id), hid2name(mem_type_id), itoa(mem_space_id), itoa(file_space_id), itoa(xfer_plist_id), ptoa(buf));
     RECORDER_INTERCEPTOR_EPILOGUE(6, args);
 }
 
 herr_t WRAPPER_NAME(H5Dset_extent)(hid_t dset_id, const hsize_t size[]) {
     RECORDER_INTERCEPTOR_PROLOGUE(herr_t, H5Dset_extent, (dset_id, size));
-    char **args = assemble_args_list(2, itoa(dset_id), ptoa(size));
+    char **args = assemble_args_list(2, hid2name(dset_id), hsizearrtoa(size, dataset_rank(dset_id)));
     RECORDER_INTERCEPTOR_EPILOGUE(2, args);
 }
 
@@ -402,7 +570,7 @@ hid_t WRAPPER_NAME(H5Screate)(H5S_class_t type) {
 
 hid_t WRAPPER_NAME(H5Screate_simple)(int rank, const hsize_t *current_dims, const hsize_t *maximum_dims) {
     RECORDER_INTERCEPTOR_PROLOGUE(hid_t, H5Screate_simple, (rank, current_dims, maximum_dims));
-    char **args = assemble_args_list(3, itoa(rank), ptoa(current_dims), ptoa(maximum_dims));
+    char **args = assemble_args_list(3, itoa(rank), hsizearrtoa(current_dims, rank), hsizearrtoa(maximum_dims, rank));
     RECORDER_INTERCEPTOR_EPILOGUE(3, args);
 }
 
@@ -414,7 +582,8 @@ hssize_t WRAPPER_NAME(H5Sget_select_npoints)(hid_t space_id) {
 
 int WRAPPER_NAME(H5Sget_simple_extent_dims)(hid_t space_id, hsize_t *dims, hsize_t *maxdims) {
     RECORDER_INTERCEPTOR_PROLOGUE(int, H5Sget_simple_extent_dims, (space_id, dims, maxdims));
-    char **args = assemble_args_list(3, itoa(space_id), ptoa(dims), ptoa(maxdims));
+    // res is the rank, the arrays are only filled in on success
+    char **args = assemble_args_list(3, itoa(space_id), hsizearrtoa(dims, res), hsizearrtoa(maxdims, res));
     RECORDER_INTERCEPTOR_EPILOGUE(3, args);
 }
 
@@ -432,7 +601,9 @@ herr_t WRAPPER_NAME(H5Sselect_elements)(hid_t space_id, H5S_seloper_t op, size_t
 
 herr_t WRAPPER_NAME(H5Sselect_hyperslab)(hid_t space_id, H5S_seloper_t op, const hsize_t *start, const hsize_t *stride, const hsize_t *count, const hsize_t *block) {
     RECORDER_INTERCEPTOR_PROLOGUE(herr_t, H5Sselect_hyperslab, (space_id, op, start, stride, count, block));
-    char **args = assemble_args_list(6, itoa(space_id), itoa(op), ptoa(start), ptoa(stride), ptoa(count), ptoa(block));
+    int rank = H5Sget_simple_extent_ndims(space_id);
+    char **args = assemble_args_list(6, itoa(space_id), itoa(op), hsizearrtoa(start, rank), hsizearrtoa(stride, rank),
+                                     hsizearrtoa(count, rank), hsizearrtoa(block, rank));
     RECORDER_INTERCEPTOR_EPILOGUE(6, args);
 }
 
@@ -443,8 +614,8 @@ herr_t WRAPPER_NAME(H5Sselect_none)(hid_t space_id) {
 }
 
 herr_t WRAPPER_NAME(H5Tclose)(hid_t dtype_id) {
-    RECORDER_INTERCEPTOR_PROLOGUE(herr_t, H5Tclose, (dtype_id));
-    char **args = assemble_args_list(1, itoa(dtype_id));
+    RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(herr_t, H5Tclose, (dtype_id));
+    char **args = assemble_args_list(1, hid_name_remove(dtype_id));
     RECORDER_INTERCEPTOR_EPILOGUE(1, args);
 }
 
@@ -695,8 +866,8 @@ herr_t WRAPPER_NAME(H5Literate2)(hid_t group_id, H5_index_t index_type, H5_iter_
 }
 
 herr_t WRAPPER_NAME(H5Oclose)(hid_t object_id) {
-    RECORDER_INTERCEPTOR_PROLOGUE(herr_t, H5Oclose, (object_id));
-    char **args = assemble_args_list(1, itoa(object_id));
+    RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(herr_t, H5Oclose, (object_id));
+    char **args = assemble_args_list(1, hid_name_remove(object_id));
     RECORDER_INTERCEPTOR_EPILOGUE(1, args);
 }
 
@@ -45,12 +45,18 @@ void recorder_init() {
     signal(SIGTERM, signal_handler);
     */
 
+    // utils_init() first, it sets the debug level
+    // and reads the inclusion/exclusion files
+    double t0 = recorder_wtime();
+    utils_init();
+    double t1 = recorder_wtime();
     gotcha_init();
+    double t2 = recorder_wtime();
     logger_init();
-    utils_init();
 
     local_tstart = recorder_wtime();
-    RECORDER_LOGDBG("[Recorder] recorder initialized.\n");
+    RECORDER_LOGDBG("[Recorder] recorder initialized in %.6f s (config %.6f s, gotcha %.6f s, logger %.6f s).\n",
+                    local_tstart-t0, t1-t0, t2-t1, local_tstart-t2);
 }
 
 void update_mpi_info() {
@@ -68,7 +74,10 @@ void update_mpi_info() {
         GOTCHA_REAL_CALL(MPI_Comm_size)(MPI_COMM_WORLD, &nprocs);
     }
 
+    double t0 = recorder_wtime();
     logger_set_mpi_info(rank, nprocs);
+    if(rank == 0)
+        RECORDER_LOGDBG("[Recorder] traces directory set up in %.6f s.\n", recorder_wtime()-t0);
 }
 
 void recorder_finalize() {
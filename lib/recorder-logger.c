@@ -7,6 +7,8 @@
 #include <libgen.h>
 #include <alloca.h>
 #include "recorder.h"
+#include "recorder-function-profiler.h"
+#include "recorder-call-sites.h"
 #ifdef RECORDER_ENABLE_CUDA_TRACE
 #include "recorder-cuda-profiler.h"
 #endif
@@ -14,6 +16,9 @@
 pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
 static bool initialized = false;
 
+// Nesting depth of recorder_pause(), see recorder-control.h
+static int pause_depth = 0;
+
 static RecorderLogger logger;
 
 /**
@@ -31,6 +36,81 @@ struct RecordStack {
 };
 static struct RecordStack *g_record_stack = NULL;
 
+// Per-terminal history for predictive timestamp coding
+static TimestampPredictor ts_predictor;
+
+// Value streams, see recorder-value-streams.h
+static ValueStreamState vs_state;
+static int vs_schema_by_id[RECORDER_MAX_FUNCS];    // index into vs_schemas, -1 if none
+static int vs_return_by_id[RECORDER_MAX_FUNCS];    // index into vs_returns, -1 if none
+
+/**
+ * Threads numbered in the order of their first record.
+ * Without RECORDER_STORE_TID, intraprocess pattern recognition
+ * stores this number as the tid, so offsets are delta coded per
+ * thread and the reader can rebuild the same keys, while the
+ * signatures of single-threaded ranks still match across ranks.
+ */
+static __thread int thread_index = -1;
+static int num_threads = 0;
+
+static pthread_t logger_thread_index() {
+    if(thread_index == -1)
+        thread_index = __atomic_fetch_add(&num_threads, 1, __ATOMIC_RELAXED);
+    return (pthread_t) thread_index;
+}
+
+/**
+ * Per-thread cache of recently used call signatures
+ *
+ * Tight loops (e.g., write(fd, 4096) or polling MPI_Test)
+ * keep producing the same few signatures. Records are compared
+ * against them first, so a hit skips composing and hashing the
+ * key as well as the CST lookup.
+ * CST entries are never freed while tracing, so the cached
+ * pointers stay valid and their keys do not change.
+ */
+#define RECENT_CS_CACHE_SIZE 4
+struct RecentSignature {
+    uint16_t func_id;
+    CallSignature* entry;
+};
+static __thread struct RecentSignature recent_cs[RECENT_CS_CACHE_SIZE];
+static __thread int recent_cs_next = 0;
+
+static CallSignature* recent_cs_find(Record* record) {
+    for(int i = 0; i < RECENT_CS_CACHE_SIZE; i++) {
+        struct RecentSignature* rc = &recent_cs[i];
+        if(rc->entry && rc->func_id == record->func_id &&
+           cs_key_matches_record(rc->entry, record))
+            return rc->entry;
+    }
+    return NULL;
+}
+
+static void recent_cs_add(CallSignature* entry, uint16_t func_id) {
+    struct RecentSignature* rc = &recent_cs[recent_cs_next];
+    rc->func_id = func_id;
+    rc->entry   = entry;
+    recent_cs_next = (recent_cs_next + 1) % RECENT_CS_CACHE_SIZE;
+}
+
+/**
+ * Runs of the same terminal are accumulated here and
+ * passed to append_terminal() once with the total exp,
+ * instead of going through the twins-removal rule for
+ * every single call. Protected by g_mutex.
+ */
+static int pending_terminal = -1;
+static int pending_exp = 0;
+
+static void flush_pending_terminal() {
+    if(pending_exp > 0)
+        append_terminal(&logger.cfg, pending_terminal, pending_exp);
+    pending_terminal = -1;
+    pending_exp = 0;
+}
+
 
 bool logger_intraprocess_pattern_recognition() {
     return logger.intraprocess_pattern_recognition;
@@ -40,6 +120,10 @@ bool logger_interprocess_pattern_recognition() {
     return logger.interprocess_pattern_recognition;
 }
 
+bool logger_relative_peers() {
+    return logger.relative_peers;
+}
+
 
 void free_record(Record *record) {
     if(record == NULL)
@@ -53,11 +137,6 @@ void free_record(Record *record) {
         recorder_free(record->args, sizeof(char*)*record->arg_count);
     }
 
-    // we don't the return type so we use the system free()
-    if(record->res)
-        free(record->res);
-
-    record->res = NULL;
     record->args = NULL;
     recorder_free(record, sizeof(Record));
 }
@@ -69,41 +148,92 @@ void write_record(Record *record) {
     // TODO: this is a ugly fix for ignoring them, as
     // they still occupy the space in the key.
     if(!logger.store_tid)
-        record->tid   = 0;
+        record->tid   = logger.intraprocess_pattern_recognition ? logger_thread_index() : 0;
     if(!logger.store_call_depth)
         record->call_depth = 0;
 
-    int key_len;
-    char* key = compose_cs_key(record, &key_len);
+    // Return value is coded against the requested count,
+    // so before value streams take it out of the arguments
+    uint32_t ret_words[3];
+    int ret_n = 0;
+    bool builtin = record->func_id < RECORDER_MAX_FUNCS;    // not a user function
+    if(logger.return_values && builtin && vs_return_by_id[record->func_id] != -1)
+        ret_n = vs_encode_return(ret_words, vs_return_by_id[record->func_id], record->res,
+                                 record->args, record->arg_count);
+
+    // Offsets are delta encoded against the previous record of
+    // the same thread/function/file, and values against the previous
+    // record of the same function, so the encoding has to happen
+    // in the order records are stored, i.e., under the lock.
+
+    bool ordered = logger.intraprocess_pattern_recognition || logger.value_streams;
+    if(ordered) {
+        pthread_mutex_lock(&g_mutex);
+        if(logger.intraprocess_pattern_recognition)
+            iopr_intraprocess(record);
+        int schema = builtin ? vs_schema_by_id[record->func_id] : -1;
+        if(logger.value_streams && schema != -1) {
+            logger.vs_index += vs_encode_args(logger.vs+logger.vs_index, &vs_state, schema,
+                                              record->func_id, record->args, record->arg_count);
+        }
+    }
 
-    pthread_mutex_lock(&g_mutex);
+    // key is only composed on a miss, in a per-thread
+    // scratch buffer, and copied to the heap for new signatures
+    int key_len;
+    uint64_t hash;
+    char* key = NULL;
+    CallSignature *entry = recent_cs_find(record);
+    if(!entry)
+        key = compose_cs_key(record, &key_len, &hash);
+
+    if(!ordered)
+        pthread_mutex_lock(&g_mutex);
+
+    // value stream: [value fields][return value] of each record
+    memcpy(logger.vs+logger.vs_index, ret_words, ret_n*sizeof(uint32_t));
+    logger.vs_index += ret_n;
+    if(logger.vs_index + VS_MAX_RECORD_WORDS > logger.vs_max_elements) {
+        logger.vs_max_elements *= 2;
+        logger.vs = realloc(logger.vs, logger.vs_max_elements*sizeof(uint32_t));
+    }
 
-    CallSignature *entry = NULL;
-    HASH_FIND(hh, logger.cst, key, key_len, entry);
-    if(entry) {                         // Found
-        entry->count++;
-        recorder_free(key, key_len);
-    } else {                            // Not exist, add to hash table
-        entry = (CallSignature*) recorder_malloc(sizeof(CallSignature));
-        entry->key = key;
-        entry->key_len = key_len;
-        entry->rank = logger.rank;
-        entry->terminal_id = logger.current_cfg_terminal++;
-        entry->count = 1;
-        HASH_ADD_KEYPTR(hh, logger.cst, entry->key, entry->key_len, entry);
+    if(!entry) {
+        entry = cs_table_find(&logger.cst, key, key_len, hash);
+        if(!entry) {                    // Not exist, add to hash table
+            entry = (CallSignature*) recorder_malloc(sizeof(CallSignature));
+            entry->key = recorder_malloc(key_len);
+            memcpy(entry->key, key, key_len);
+            entry->key_len = key_len;
+            entry->rank = logger.rank;
+            entry->terminal_id = logger.current_cfg_terminal++;
+            entry->count = 0;
+            entry->hash = hash;
+            cs_table_add(&logger.cst, entry);
+        }
+        recent_cs_add(entry, record->func_id);
     }
+    entry->count++;
 
-    append_terminal(&logger.cfg, entry->terminal_id, 1);
+    if(entry->terminal_id != pending_terminal) {
+        flush_pending_terminal();
+        pending_terminal = entry->terminal_id;
+    }
+    pending_exp++;
 
     // store timestamps, only write out at finalize time
-    uint32_t delta_tstart = (record->tstart-logger.prev_tstart) / logger.ts_resolution;
-    uint32_t delta_tend   = (record->tend-logger.prev_tstart)   / logger.ts_resolution;
+    // long gaps are escaped to 64-bit deltas, see recorder-timestamps.h
+    if(logger.ts_prediction)
+        logger.ts_index += ts_encode_record_predicted(logger.ts+logger.ts_index, &ts_predictor, entry->terminal_id,
+                                                      record->tstart, record->tend,
+                                                      logger.prev_tstart, logger.ts_resolution);
+    else
+        logger.ts_index += ts_encode_record(logger.ts+logger.ts_index, record->tstart, record->tend,
+                                            logger.prev_tstart, logger.ts_resolution);
     logger.prev_tstart = record->tstart;
-    logger.ts[logger.ts_index++] = delta_tstart;
-    logger.ts[logger.ts_index++] = delta_tend;
 
-    // ts buffer is full, double it
-    if(logger.ts_index == logger.ts_max_elements) {
+    // ts buffer may not hold the next record, double it
+    if(logger.ts_index + RECORDER_TS_MAX_RECORD_WORDS > logger.ts_max_elements) {
         logger.ts_max_elements *= 2;
         size_t ts_buf_size = logger.ts_max_elements*sizeof(uint32_t);
         void* ptr = (uint32_t*) recorder_malloc(ts_buf_size);
@@ -117,6 +247,18 @@ void write_record(Record *record) {
 }
 
 void logger_record_enter(Record* record) {
+    // Dropped at exit. Only the _TRACKED wrappers and records
+    // they add (e.g., MPI_File_request_complete) get here while
+    // paused, to keep their tables current (see recorder.h).
+    if(__atomic_load_n(&pause_depth, __ATOMIC_RELAXED) > 0) {
+        record->call_depth = 0;
+        record->stack_id = 0;
+        record->record_stack = NULL;
+        return;
+    }
+
+    record->stack_id = logger.call_sites ? call_sites_capture(__builtin_frame_address(0)) : 0;
+
     struct RecordStack *rs;
     HASH_FIND(hh, g_record_stack, &record->tid, sizeof(pthread_t), rs);
     if(!rs) {
@@ -135,6 +277,10 @@ void logger_record_enter(Record* record) {
 
 void logger_record_exit(Record* record) {
     struct RecordStack *rs = record->record_stack;
+    if(rs == NULL) {
+        free_record(record);
+        return;
+    }
     rs->call_depth--;
 
     // In most cases, rs->call_depth is 0 and
@@ -154,6 +300,26 @@ bool logger_initialized() {
     return initialized;
 }
 
+void logger_pause() {
+    __atomic_add_fetch(&pause_depth, 1, __ATOMIC_RELAXED);
+}
+
+void logger_resume() {
+    int depth = __atomic_load_n(&pause_depth, __ATOMIC_RELAXED);
+    while(depth > 0 && !__atomic_compare_exchange_n(&pause_depth, &depth, depth-1, false,
+                                                   __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+bool logger_paused() {
+    return __atomic_load_n(&pause_depth, __ATOMIC_RELAXED) > 0;
+}
+
+// Initialized and not paused, i.e., calls are recorded
+bool logger_tracing() {
+    return initialized && __atomic_load_n(&pause_depth, __ATOMIC_RELAXED) == 0;
+}
+
 // Traces dir: recorder-YYYYMMDD/HHmmSS.ff-hostname-username-appname-pid
 void create_traces_dir() {
     if(logger.rank != 0) return;
@@ -244,6 +410,8 @@ void logger_init() {
 
     double global_tstart = recorder_wtime();
 
+    function_profiler_init();
+
     // Initialize CUDA profiler
     #ifdef RECORDER_ENABLE_CUDA_TRACE
     cuda_profiler_init();
@@ -255,8 +423,10 @@ void logger_init() {
     logger.num_records = 0;
     logger.start_ts = global_tstart;
     logger.prev_tstart = logger.start_ts;
-    logger.cst = NULL;
+    cs_table_init(&logger.cst);
     sequitur_init(&logger.cfg);
+    pending_terminal = -1;
+    pending_exp = 0;
     logger.current_cfg_terminal = 0;
     logger.directory_created = false;
     logger.store_tid   = false;
@@ -264,9 +434,14 @@ void logger_init() {
     logger.interprocess_compression = true;
     logger.intraprocess_pattern_recognition = false;
     logger.interprocess_pattern_recognition = false;
+    logger.relative_peers = false;
+    logger.value_streams = false;
+    logger.return_values = true;
+    logger.call_sites = 0;
     logger.ts_index = 0;
     logger.ts_resolution = 1e-7;            // 100ns
     logger.ts_compression = true;
+    logger.ts_prediction = false;
     logger.ts_max_elements = 1*1024*1024;   // enough for half million records
 
     size_t ts_buf_size = logger.ts_max_elements*sizeof(uint32_t);
@@ -275,6 +450,10 @@ void logger_init() {
     const char* ts_compression_str = getenv(RECORDER_TIME_COMPRESSION);
     if(ts_compression_str)
         logger.ts_compression = atoi(ts_compression_str);
+    const char* ts_prediction_str = getenv(RECORDER_TIME_PREDICTION);
+    if(ts_prediction_str)
+        logger.ts_prediction = atoi(ts_prediction_str);
+    ts_predictor_init(&ts_predictor);
 
     const char* time_resolution_str = getenv(RECORDER_TIME_RESOLUTION);
     if(time_resolution_str)
@@ -295,6 +474,34 @@ void logger_init() {
     const char* intraprocess_pattern_recognition_env = getenv(RECORDER_INTRAPROCESS_PATTERN_RECOGNITION);
     if(intraprocess_pattern_recognition_env)
         logger.intraprocess_pattern_recognition = atoi(intraprocess_pattern_recognition_env);
+    const char* relative_peers_env = getenv(RECORDER_RELATIVE_PEERS);
+    if(relative_peers_env)
+        logger.relative_peers = atoi(relative_peers_env);
+    const char* value_streams_env = getenv(RECORDER_VALUE_STREAMS);
+    if(value_streams_env)
+        logger.value_streams = atoi(value_streams_env);
+    const char* return_values_env = getenv(RECORDER_STORE_RETURN_VALUES);
+    if(return_values_env)
+        logger.return_values = atoi(return_values_env);
+    const char* call_sites_env = getenv(RECORDER_CALL_SITES);
+    if(call_sites_env)
+        logger.call_sites = atoi(call_sites_env);
+    if(logger.call_sites < 0)
+        logger.call_sites = 0;
+    if(logger.call_sites > CALL_SITES_MAX_DEPTH)
+        logger.call_sites = CALL_SITES_MAX_DEPTH;
+    call_sites_init(logger.call_sites);
+
+    vs_state_init(&vs_state);
+    for(int i = 0; i < RECORDER_MAX_FUNCS; i++)
+        vs_schema_by_id[i] = vs_return_by_id[i] = -1;
+    for(int i = 0; i < VS_NUM_SCHEMAS; i++)
+        vs_schema_by_id[get_function_id_by_name(vs_schemas[i].func)] = i;
+    for(int i = 0; i < VS_NUM_RETURNS; i++)
+        vs_return_by_id[get_function_id_by_name(vs_returns[i].func)] = i;
+    logger.vs_index = 0;
+    logger.vs_max_elements = 64*1024;
+    logger.vs = malloc(logger.vs_max_elements*sizeof(uint32_t));
 
     // For non-mpi programs, ignore interprocess configurations.
     const char* non_mpi_env = getenv(RECORDER_WITH_NON_MPI);
@@ -333,10 +540,20 @@ void save_global_metadata() {
         .start_ts            = logger.start_ts,
         .ts_buffer_elements  = logger.ts_max_elements,
         .ts_compression      = logger.ts_compression,
+        .ts_prediction       = logger.ts_prediction,
         .interprocess_compression = logger.interprocess_compression,
         .interprocess_pattern_recognition = logger.interprocess_pattern_recognition,
         .intraprocess_pattern_recognition = logger.intraprocess_pattern_recognition,
+        .relative_peers      = logger.relative_peers,
+        .value_streams       = logger.value_streams,
+        .return_values       = logger.return_values,
+        .call_sites          = logger.call_sites,
     };
+    // functions not wrapped have no records at all,
+    // tell them apart from those never called
+    for(int i = 0; i < RECORDER_MAX_FUNCS; i++)
+        if(gotcha_func_traced(i))
+            metadata.traced_funcs[i/8] |= 1 << (i%8);
     GOTCHA_REAL_CALL(fwrite)(&metadata, sizeof(RecorderMetadata), 1, metafh);
 
     for(int i = 0; i < sizeof(func_list)/sizeof(char*); i++) {
@@ -368,6 +585,11 @@ void logger_finalize() {
     cuda_profiler_exit();
     #endif
 
+    pthread_mutex_lock(&g_mutex);
+    flush_pending_terminal();
+    iopr_intraprocess_finalize();
+    pthread_mutex_unlock(&g_mutex);
+
 
     // Write out timestamps
     // and merge per-process ts files into a single one
@@ -375,6 +597,8 @@ void logger_finalize() {
         ts_write_out(&logger);
     GOTCHA_REAL_CALL(fflush)(logger.ts_file);
     recorder_free(logger.ts, sizeof(uint32_t)*logger.ts_max_elements);
+    ts_predictor_free(&ts_predictor);
+    free(logger.vs);
     ts_merge_files(&logger);
     GOTCHA_REAL_CALL(fclose)(logger.ts_file);
     char perprocess_ts_filename[1024];
@@ -384,9 +608,15 @@ void logger_finalize() {
 
     // interprocess I/O pattern recognition
     if (logger.interprocess_pattern_recognition) {
+        iopr_escape_args(&logger);
         iopr_interprocess(&logger);
+        iopr_filename_templates(&logger);
     }
 
+    // global ids of user functions
+    function_profiler_finalize(&logger);
+    call_sites_finalize(&logger);
+
     // interprocess cst and cfg compression
     cleanup_record_stack();
     if(logger.interprocess_compression) {
@@ -400,7 +630,7 @@ void logger_finalize() {
         save_cst_local(&logger);
         save_cfg_local(&logger);
     }
-    cleanup_cst(logger.cst);
+    cleanup_cst(&logger.cst);
     sequitur_cleanup(&logger.cfg);
 
     if(logger.rank == 0) {
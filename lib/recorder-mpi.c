@@ -32,9 +32,24 @@
 
 #define RECORDER_MPI_IMP(func) imp_##func
 
+/*
+ * Number of communicators and files created so far on a
+ * communicator. Both are created collectively over it, in
+ * the same order on all members, so all members agree.
+ */
+typedef struct MPICommSeq_t {
+    int comms;
+    int files;
+} MPICommSeq;
+
 typedef struct MPICommHash_t {
     void *key;      // MPI_Comm as key
     char* id;
+    int   rank;     // my rank in this communicator
+    int   ndims;    // > 0 if created by MPI_Cart_create
+    int*  dims;
+    int*  periods;
+    MPICommSeq seq;
     UT_hash_handle hh;
 } MPICommHash;
 
@@ -45,32 +60,82 @@ typedef struct MPIFileHash_t {
     UT_hash_handle hh;
 } MPIFileHash;
 
+/*
+ * Outstanding nonblocking MPI-IO request
+ */
+typedef struct MPIRequestHash_t {
+    size_t key;         // request handle
+    char*  fid;
+    const char* func;   // the call that posted it
+    off64_t bytes;      // requested
+    UT_hash_handle hh;
+} MPIRequestHash;
+
 static MPICommHash *mpi_comm_table = NULL;
 static MPIFileHash *mpi_file_table = NULL;
-static int mpi_file_id = 0;
-static int mpi_comm_id = 0;
+static MPIRequestHash *mpi_request_table = NULL;
+static MPICommSeq world_seq, self_seq, unknown_seq;
 
 // placeholder for C wrappers
 static MPI_Fint* ierr = NULL;
 
 
+char* comm2name(MPI_Comm *comm);
+
+static MPICommSeq* comm2seq(MPI_Comm *comm) {
+    if(*comm == MPI_COMM_WORLD)
+        return &world_seq;
+    if(*comm == MPI_COMM_SELF)
+        return &self_seq;
+    MPICommHash *entry = NULL;
+    HASH_FIND(hh, mpi_comm_table, comm, sizeof(MPI_Comm), entry);
+    // Created by calls we do not intercept, members
+    // may disagree on this one
+    return entry ? &entry->seq : &unknown_seq;
+}
+
+/*
+ * Id of a communicator or file created collectively over
+ * the parent communicator: "<r>-<n>", where r is the world
+ * rank of rank 0 of the new communicator (or of the parent,
+ * for files), and n is a hash of the parent's id, the kind
+ * ('c' or 'f') and the sequence number on the parent.
+ *
+ * Every member derives the same id on its own; siblings
+ * (e.g., the communicators of one MPI_Comm_split) differ
+ * in r. Before, rank 0 picked the id and broadcast it.
+ */
+static char* derive_id(MPI_Comm comm, MPI_Comm *parent, char kind, int seq) {
+    MPI_Group group, world_group;
+    int zero = 0, root = 0;
+    PMPI_Comm_group(comm, &group);
+    PMPI_Comm_group(MPI_COMM_WORLD, &world_group);
+    PMPI_Group_translate_ranks(group, 1, &zero, world_group, &root);
+    PMPI_Group_free(&group);
+    PMPI_Group_free(&world_group);
+
+    char* parent_id = comm2name(parent);
+    char key[64];
+    int key_len = snprintf(key, sizeof(key), "%s:%c%d", parent_id, kind, seq);
+    free(parent_id);
+    unsigned n = (unsigned) (cs_hash64(key, key_len) & 0x7FFFFFFF);
+
+    char* id = calloc(32, sizeof(char));
+    sprintf(id, "%d-%u", root, n);
+    return id;
+}
+
 void add_mpi_file(MPI_Comm comm, MPI_File *file, CONST char* filename) {
+    // counted even if the open failed, to stay in step
+    int seq = comm2seq(&comm)->files++;
     if(file == NULL)
         return;
 
-    int rank, world_rank;
-    PMPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
-    PMPI_Comm_rank(comm, &rank);
-
     MPIFileHash *entry = malloc(sizeof(MPIFileHash));
     entry->key = malloc(sizeof(MPI_File));
     memcpy(entry->key, file, sizeof(MPI_File));
 
-    char* id = calloc(32, sizeof(char));
-    if(rank == 0)
-        sprintf(id, "%d-%d", world_rank, mpi_file_id++);
-    recorder_bcast(id, 32, 0, comm);
-    entry->id = id;
+    entry->id = derive_id(comm, &comm, 'f', seq);
     char* tmp_filename = realrealpath(filename);
     entry->accept = accept_filename(tmp_filename);
     free(tmp_filename);
@@ -105,30 +170,110 @@ char* file2id(MPI_File *file) {
 
 
 // Return the relative rank in the new communicator
-int add_mpi_comm(MPI_Comm *newcomm) {
+int add_mpi_comm(MPI_Comm *parent, MPI_Comm *newcomm) {
+    // all members of the parent count, including those
+    // that got MPI_COMM_NULL (e.g., MPI_UNDEFINED color)
+    int seq = comm2seq(parent)->comms++;
     if(newcomm == NULL || *newcomm == MPI_COMM_NULL)
         return - 1;
-    int new_rank, world_rank;
+    int new_rank;
     PMPI_Comm_rank(*newcomm, &new_rank);
-    PMPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
 
     MPICommHash *entry = malloc(sizeof(MPICommHash));
     entry->key = malloc(sizeof(MPI_Comm));
     memcpy(entry->key, newcomm, sizeof(MPI_Comm));
 
-    // Rank 0 of the new communicator decides an unique id
-    // and broadcast it to all others, then everyone stores it
-    // in the hash table.
-    char *id = calloc(32, sizeof(char));
-    if(new_rank == 0)
-        sprintf(id, "%d-%d", world_rank, mpi_comm_id++);
-    recorder_bcast(id, 32, 0, *newcomm);
-    entry->id = id;
+    entry->id = derive_id(*newcomm, parent, 'c', seq);
+    entry->rank = new_rank;
+    entry->seq.comms = 0;
+    entry->seq.files = 0;
+    entry->ndims = 0;
+    entry->dims = NULL;
+    entry->periods = NULL;
 
     HASH_ADD_KEYPTR(hh, mpi_comm_table, entry->key, sizeof(MPI_Comm), entry);
     return new_rank;
 }
 
+/*
+ * Remember the topology of a cartesian communicator,
+ * so peers can be stored as cartesian displacements
+ */
+void add_mpi_cart(MPI_Comm *comm_cart, int ndims, CONST int dims[], CONST int periods[]) {
+    if(comm_cart == NULL || *comm_cart == MPI_COMM_NULL || ndims <= 0)
+        return;
+    MPICommHash *entry = NULL;
+    HASH_FIND(hh, mpi_comm_table, comm_cart, sizeof(MPI_Comm), entry);
+    if(!entry)
+        return;
+    entry->ndims = ndims;
+    entry->dims = malloc(sizeof(int) * ndims);
+    entry->periods = malloc(sizeof(int) * ndims);
+    memcpy(entry->dims, dims, sizeof(int) * ndims);
+    memcpy(entry->periods, periods, sizeof(int) * ndims);
+}
+
+static char* intarrtoa(CONST int arr[], int count) {
+    size_t tmp[count];
+    for(int i = 0; i < count; i++)
+        tmp[i] = (size_t) arr[i];
+    return arrtoa(tmp, count);
+}
+
+/*
+ * Peer (source or destination) of a point-to-point call.
+ *
+ * With RECORDER_RELATIVE_PEERS, the peer is stored relative to
+ * the caller so that e.g. halo exchanges look the same on all
+ * ranks: "@[dx,dy,...]" for cartesian communicators, where
+ * periodic dimensions take the shortest displacement, and
+ * "@+d" otherwise. Special values (MPI_ANY_SOURCE,
+ * MPI_PROC_NULL) are kept as is. The reader resolves them.
+ */
+char* peer2str(int peer, MPI_Comm comm) {
+    if(!logger_relative_peers() || peer < 0)
+        return itoa(peer);
+
+    int rank = 0, ndims = 0;
+    int *dims = NULL, *periods = NULL;
+    if(comm == MPI_COMM_WORLD) {
+        PMPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    } else if(comm != MPI_COMM_SELF) {
+        MPICommHash *entry = NULL;
+        HASH_FIND(hh, mpi_comm_table, &comm, sizeof(MPI_Comm), entry);
+        if(!entry)
+            return itoa(peer);
+        rank = entry->rank;
+        ndims = entry->ndims;
+        dims = entry->dims;
+        periods = entry->periods;
+    }
+
+    char* str = calloc(16 + 16*ndims, sizeof(char));
+    if(ndims == 0) {
+        sprintf(str, "@%+d", peer - rank);
+        return str;
+    }
+
+    // ranks are laid out in row-major order
+    int pos = sprintf(str, "@[");
+    int stride = 1;
+    int disp[ndims];
+    for(int i = ndims-1; i >= 0; i--) {
+        int d = (peer / stride) % dims[i] - (rank / stride) % dims[i];
+        if(periods[i]) {
+            d = ((d % dims[i]) + dims[i]) % dims[i];
+            if(d > dims[i] / 2)
+                d -= dims[i];
+        }
+        disp[i] = d;
+        stride *= dims[i];
+    }
+    for(int i = 0; i < ndims; i++)
+        pos += sprintf(str+pos, i == ndims-1 ? "%d]" : "%d,", disp[i]);
+    return str;
+}
+
 char* comm2name(MPI_Comm *comm) {
     if(comm == NULL || *comm == MPI_COMM_NULL)
         return strdup("MPI_COMM_NULL");
@@ -160,6 +305,233 @@ static inline char *type2name(MPI_Datatype type) {
     return tmp;
 }
 
+/*
+ * Size in bytes of an access of count elements of type
+ */
+static inline char* bytes2str(int count, MPI_Datatype type) {
+    int size = 0;
+    if(type != MPI_DATATYPE_NULL)
+        PMPI_Type_size(type, &size);
+    return itoa((off64_t)count * size);
+}
+
+/*
+ * File views
+ *
+ * The filetype of MPI_File_set_view() is flattened into the
+ * (offset, length) byte runs of one extent. Together with
+ * the displacement and etype size, this lets the reader map
+ * the offsets of later accesses (in etypes, relative to the
+ * view) to byte ranges of the file.
+ *
+ * Flattening walks the type constructors with
+ * MPI_Type_get_envelope/get_contents. The result is cached
+ * as an attribute of the datatype, so it is computed once
+ * per datatype and dropped by MPI when the type is freed.
+ */
+#define MAX_VIEW_RUNS 64
+
+typedef struct TypeRuns_t {
+    int n;
+    MPI_Aint off[MAX_VIEW_RUNS];
+    MPI_Aint len[MAX_VIEW_RUNS];
+} TypeRuns;
+
+static int view_keyval = MPI_KEYVAL_INVALID;
+
+static int delete_view_attr(MPI_Datatype type, int keyval, void* attr, void* extra) {
+    free(attr);
+    return MPI_SUCCESS;
+}
+
+// Append a run, merging it with the previous one if adjacent
+static inline int add_run(TypeRuns* runs, MPI_Aint off, MPI_Aint len) {
+    if(len == 0)
+        return 1;
+    if(runs->n > 0 && runs->off[runs->n-1] + runs->len[runs->n-1] == off) {
+        runs->len[runs->n-1] += len;
+        return 1;
+    }
+    if(runs->n == MAX_VIEW_RUNS)
+        return 0;
+    runs->off[runs->n] = off;
+    runs->len[runs->n] = len;
+    runs->n++;
+    return 1;
+}
+
+static int flatten_type(MPI_Datatype type, MPI_Aint base, TypeRuns* runs);
+
+// blocklen consecutive copies of child at base
+static int add_block(MPI_Datatype child, MPI_Aint base, int blocklen, TypeRuns* runs) {
+    MPI_Aint lb, extent;
+    PMPI_Type_get_extent(child, &lb, &extent);
+    // dense children make one run per block
+    TypeRuns child_runs = {0};
+    if(!flatten_type(child, 0, &child_runs))
+        return 0;
+    if(child_runs.n == 1 && child_runs.off[0] == 0 && child_runs.len[0] == extent)
+        return add_run(runs, base, extent * blocklen);
+    for(int j = 0; j < blocklen; j++)
+        for(int r = 0; r < child_runs.n; r++)
+            if(!add_run(runs, base + j*extent + child_runs.off[r], child_runs.len[r]))
+                return 0;
+    return 1;
+}
+
+/*
+ * Runs of the subarray starting at dimension d,
+ * C order (the last dimension is contiguous)
+ */
+static int add_subarray(MPI_Datatype child, MPI_Aint base, int d, int ndims,
+                        int* sizes, int* subsizes, int* starts, MPI_Aint* strides, TypeRuns* runs) {
+    if(d == ndims-1)
+        return add_block(child, base + starts[d]*strides[d], subsizes[d], runs);
+    for(int i = 0; i < subsizes[d]; i++)
+        if(!add_subarray(child, base + (starts[d]+i)*strides[d], d+1, ndims,
+                         sizes, subsizes, starts, strides, runs))
+            return 0;
+    return 1;
+}
+
+/*
+ * Append the runs of type, displaced by base.
+ * Return 0 if the type has more than MAX_VIEW_RUNS runs
+ * or a constructor not handled here (e.g., darray).
+ */
+static int flatten_type(MPI_Datatype type, MPI_Aint base, TypeRuns* runs) {
+    int ni, na, nd, combiner;
+    PMPI_Type_get_envelope(type, &ni, &na, &nd, &combiner);
+    if(combiner == MPI_COMBINER_NAMED) {
+        int size;
+        PMPI_Type_size(type, &size);
+        return add_run(runs, base, size);
+    }
+
+    int* ints = malloc(sizeof(int) * (ni+1));
+    MPI_Aint* addrs = malloc(sizeof(MPI_Aint) * (na+1));
+    MPI_Datatype* types = malloc(sizeof(MPI_Datatype) * (nd+1));
+    PMPI_Type_get_contents(type, ni, na, nd, ints, addrs, types);
+
+    int ok = 1;
+    MPI_Aint lb, extent = 0;
+    if(nd > 0)
+        PMPI_Type_get_extent(types[0], &lb, &extent);
+
+    switch(combiner) {
+        case MPI_COMBINER_DUP:
+        case MPI_COMBINER_RESIZED:      // the new extent is used by whoever tiles it
+            ok = flatten_type(types[0], base, runs);
+            break;
+        case MPI_COMBINER_CONTIGUOUS:
+            ok = add_block(types[0], base, ints[0], runs);
+            break;
+        case MPI_COMBINER_VECTOR:
+            for(int i = 0; ok && i < ints[0]; i++)
+                ok = add_block(types[0], base + i*ints[2]*extent, ints[1], runs);
+            break;
+        case MPI_COMBINER_HVECTOR:
+            for(int i = 0; ok && i < ints[0]; i++)
+                ok = add_block(types[0], base + i*addrs[0], ints[1], runs);
+            break;
+        case MPI_COMBINER_INDEXED:
+            for(int i = 0; ok && i < ints[0]; i++)
+                ok = add_block(types[0], base + ints[1+ints[0]+i]*extent, ints[1+i], runs);
+            break;
+        case MPI_COMBINER_HINDEXED:
+            for(int i = 0; ok && i < ints[0]; i++)
+                ok = add_block(types[0], base + addrs[i], ints[1+i], runs);
+            break;
+        case MPI_COMBINER_INDEXED_BLOCK:
+            for(int i = 0; ok && i < ints[0]; i++)
+                ok = add_block(types[0], base + ints[2+i]*extent, ints[1], runs);
+            break;
+        case MPI_COMBINER_STRUCT:
+            for(int i = 0; ok && i < ints[0]; i++)
+                ok = add_block(types[i], base + addrs[i], ints[1+i], runs);
+            break;
+        case MPI_COMBINER_SUBARRAY: {
+            int ndims = ints[0];
+            int *sizes = ints+1, *subsizes = ints+1+ndims, *starts = ints+1+2*ndims;
+            int order = ints[1+3*ndims];
+            MPI_Aint strides[ndims];
+            // element stride of each dimension, in C order
+            int rev = (order == MPI_ORDER_FORTRAN);
+            int tmp_sizes[ndims], tmp_subsizes[ndims], tmp_starts[ndims];
+            for(int i = 0; i < ndims; i++) {
+                int k = rev ? ndims-1-i : i;
+                tmp_sizes[i] = sizes[k];
+                tmp_subsizes[i] = subsizes[k];
+                tmp_starts[i] = starts[k];
+            }
+            MPI_Aint stride = extent;
+            for(int i = ndims-1; i >= 0; i--) {
+                strides[i] = stride;
+                stride *= tmp_sizes[i];
+            }
+            ok = add_subarray(types[0], base, 0, ndims, tmp_sizes, tmp_subsizes, tmp_starts, strides, runs);
+            break;
+        }
+        default:
+            ok = 0;
+    }
+
+    // get_contents returns copies of derived types
+    for(int i = 0; i < nd; i++) {
+        int ni2, na2, nd2, combiner2;
+        PMPI_Type_get_envelope(types[i], &ni2, &na2, &nd2, &combiner2);
+        if(combiner2 != MPI_COMBINER_NAMED)
+            PMPI_Type_free(&types[i]);
+    }
+    free(ints);
+    free(addrs);
+    free(types);
+    return ok;
+}
+
+/*
+ * "[esize,extent,o1,l1,o2,l2,...]", where esize is the size of
+ * the etype, extent that of the filetype, and oi/li the runs
+ * of the filetype. The runs are left out if the filetype
+ * could not be flattened.
+ */
+static char* view2str(MPI_Datatype etype, MPI_Datatype filetype) {
+    int esize = 0;
+    MPI_Aint lb, extent = 0;
+    PMPI_Type_size(etype, &esize);
+    PMPI_Type_get_extent(filetype, &lb, &extent);
+
+    int ni, na, nd, combiner;
+    PMPI_Type_get_envelope(filetype, &ni, &na, &nd, &combiner);
+
+    TypeRuns* runs = NULL;
+    int flag = 0;
+    if(combiner != MPI_COMBINER_NAMED) {
+        if(view_keyval == MPI_KEYVAL_INVALID)
+            PMPI_Type_create_keyval(MPI_TYPE_NULL_COPY_FN, delete_view_attr, &view_keyval, NULL);
+        PMPI_Type_get_attr(filetype, view_keyval, &runs, &flag);
+    }
+    if(!flag) {
+        runs = calloc(1, sizeof(TypeRuns));
+        if(!flatten_type(filetype, 0, runs))
+            runs->n = 0;
+        if(combiner != MPI_COMBINER_NAMED)
+            PMPI_Type_set_attr(filetype, view_keyval, runs);
+    }
+
+    size_t tmp[2 + 2*MAX_VIEW_RUNS];
+    tmp[0] = esize;
+    tmp[1] = extent;
+    for(int i = 0; i < runs->n; i++) {
+        tmp[2+2*i] = runs->off[i];
+        tmp[3+2*i] = runs->len[i];
+    }
+    char* str = arrtoa(tmp, 2 + 2*runs->n);
+    if(combiner == MPI_COMBINER_NAMED)
+        free(runs);
+    return str;
+}
+
 static inline char* status2str(MPI_Status *status) {
     char *tmp = calloc(128, sizeof(char));
     if(status == MPI_STATUS_IGNORE)
@@ -192,6 +564,96 @@ static inline char* whence2name(int whence) {
  *      Irecv(ang_source) + MPI_Wait(MPI_STATUS_IGNORE);
  */
 
+/**
+ * Nonblocking MPI-IO
+ *
+ * MPI_File_iread*, MPI_File_iwrite* only post a request, the
+ * I/O is done by the time the MPI_Wait/MPI_Test* call that
+ * completes it returns. Posted requests are kept in
+ * mpi_request_table, and for each one that completes we add
+ * a MPI_File_request_complete record right after the record
+ * of the Wait/Test call:
+ *
+ *      args: file id, request, posting call, bytes
+ *
+ * Both of its timestamps are the end of the Wait/Test call.
+ * The reader moves tstart back to the start of the posting
+ * call (matched by request), so the record covers the whole
+ * life of the request, and the overlap with other calls can
+ * be seen.
+ */
+static void add_io_request(size_t request, MPI_File *fh, const char* func,
+                           int count, MPI_Datatype datatype) {
+    MPIRequestHash *entry = NULL;
+    HASH_FIND(hh, mpi_request_table, &request, sizeof(size_t), entry);
+    if(entry) {
+        // should not happen, the handle was freed without us noticing
+        HASH_DEL(mpi_request_table, entry);
+        free(entry->fid);
+        free(entry);
+    }
+
+    int size = 0;
+    if(datatype != MPI_DATATYPE_NULL)
+        PMPI_Type_size(datatype, &size);
+
+    entry = malloc(sizeof(MPIRequestHash));
+    entry->key = request;
+    entry->fid = file2id(fh);
+    entry->func = func;
+    entry->bytes = (off64_t)count * size;
+    HASH_ADD(hh, mpi_request_table, key, sizeof(size_t), entry);
+}
+
+/*
+ * request is the handle before the call, as MPI
+ * sets it to MPI_REQUEST_NULL once completed.
+ * Nothing to do for requests not from MPI-IO.
+ */
+static void complete_io_request(Record *wait, size_t request, MPI_Status *status) {
+    MPIRequestHash *entry = NULL;
+    HASH_FIND(hh, mpi_request_table, &request, sizeof(size_t), entry);
+    if(!entry)
+        return;
+    HASH_DEL(mpi_request_table, entry);
+
+    // the actual count if MPI tells us
+    off64_t bytes = entry->bytes;
+    int count;
+    if(status != MPI_STATUS_IGNORE && status != MPI_STATUSES_IGNORE &&
+       PMPI_Get_count(status, MPI_BYTE, &count) == MPI_SUCCESS && count != MPI_UNDEFINED)
+        bytes = count;
+
+    Record *record = recorder_malloc(sizeof(Record));
+    record->func_id = get_function_id_by_name("MPI_File_request_complete");
+    record->tid = wait->tid;
+    logger_record_enter(record);
+    // same level as the Wait/Test call, not inside it
+    record->call_depth = wait->call_depth;
+    record->stack_id = wait->stack_id;
+    record->tstart = wait->tend;
+    record->tend = wait->tend;
+    record->res = 0;
+    record->arg_count = 4;
+    record->args = assemble_args_list(4, entry->fid, itoa(request), strdup(entry->func), itoa(bytes));
+    logger_record_exit(record);
+
+    free(entry);
+}
+
+/*
+ * Requests completed by MPI_Waitsome/Testsome/Waitany/Testany
+ */
+static void complete_io_requests(Record *wait, size_t requests[], int outcount,
+                                 int indices[], MPI_Status statuses[]) {
+    if(outcount == MPI_UNDEFINED)
+        return;
+    for(int i = 0; i < outcount; i++) {
+        MPI_Status *status = (statuses == MPI_STATUSES_IGNORE) ? MPI_STATUS_IGNORE : &statuses[i];
+        complete_io_request(wait, requests[indices[i]], status);
+    }
+}
+
 
 
 
@@ -351,7 +813,7 @@ int RECORDER_MPI_IMP(MPI_Type_commit) (MPI_Datatype *datatype, MPI_Fint* ierr) {
 }
 
 int RECORDER_MPI_IMP(MPI_File_open) (MPI_Comm comm, CONST char *filename, int amode, MPI_Info info, MPI_File *fh, MPI_Fint* ierr) {
-    RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_open, (comm, filename, amode, info, fh), ierr);
+    RECORDER_INTERCEPTOR_PROLOGUE_F_TRACKED(int, MPI_File_open, (comm, filename, amode, info, fh), ierr);
     add_mpi_file(comm, fh, filename);
     // TODO incorporate FILTER_MPIIO_CALL here
     char **args = assemble_args_list(5, comm2name(&comm), realrealpath(filename), itoa(amode), ptoa(&info), file2id(fh));
@@ -370,7 +832,7 @@ int RECORDER_MPI_IMP(MPI_File_close) (MPI_File *fh, MPI_Fint* ierr) {
     }
     // TODO incorporate FILTER_MPIIO_CALL here
 
-    RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_close, (fh), ierr);
+    RECORDER_INTERCEPTOR_PROLOGUE_F_TRACKED(int, MPI_File_close, (fh), ierr);
     char **args = assemble_args_list(1, fid);
     RECORDER_INTERCEPTOR_EPILOGUE(1, args);
 }
@@ -392,191 +854,189 @@ int RECORDER_MPI_IMP(MPI_File_set_size) (MPI_File fh, MPI_Offset size, MPI_Fint*
 int RECORDER_MPI_IMP(MPI_File_set_view) (MPI_File fh, MPI_Offset disp, MPI_Datatype etype, MPI_Datatype filetype, CONST char *datarep, MPI_Info info, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_set_view, (fh, disp, etype, filetype, datarep, info), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_set_view, (fh, disp, etype, filetype, datarep, info), ierr);
-    off64_t stored_offset = (off64_t) disp;
-    if (logger_intraprocess_pattern_recognition())
-        stored_offset = iopr_intraprocess("MPI_File_set_view", (off64_t)disp);
-    char **args = assemble_args_list(6, file2id(&fh), itoa(stored_offset), type2name(etype), type2name(filetype), ptoa(datarep), ptoa(&info));
-    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
+    char **args = assemble_args_list(7, file2id(&fh), itoa(disp), type2name(etype), type2name(filetype), ptoa(datarep), ptoa(&info),
+                                     view2str(etype, filetype));
+    RECORDER_INTERCEPTOR_EPILOGUE(7, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_read) (MPI_File fh, void *buf, int count, MPI_Datatype datatype, MPI_Status *status, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_read, (fh, buf, count, datatype, status), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_read, (fh, buf, count, datatype, status), ierr);
-    char **args = assemble_args_list(5, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), status2str(status));
-    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
+    char **args = assemble_args_list(6, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), status2str(status), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_read_at) (MPI_File fh, MPI_Offset offset, void *buf, int count, MPI_Datatype datatype, MPI_Status *status, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_read_at, (fh, offset, buf, count, datatype, status), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_read_at, (fh, offset, buf, count, datatype, status), ierr);
-    off64_t stored_offset = (off64_t) offset;
-    if (logger_intraprocess_pattern_recognition())
-        stored_offset = iopr_intraprocess("MPI_File_read_at", (off64_t)offset);
-    char **args = assemble_args_list(6, file2id(&fh), itoa(stored_offset), ptoa(buf), itoa(count), type2name(datatype), status2str(status));
-    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
+    char **args = assemble_args_list(7, file2id(&fh), itoa(offset), ptoa(buf), itoa(count), type2name(datatype), status2str(status), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(7, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_read_at_all) (MPI_File fh, MPI_Offset offset, void *buf, int count, MPI_Datatype datatype, MPI_Status *status, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_read_at_all, (fh, offset, buf, count, datatype, status), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_read_at_all, (fh, offset, buf, count, datatype, status), ierr);
-    off64_t stored_offset = (off64_t) offset;
-    if (logger_intraprocess_pattern_recognition())
-        stored_offset = iopr_intraprocess("MPI_File_read_at_all", (off64_t)offset);
-    char **args = assemble_args_list(6, file2id(&fh), itoa(stored_offset), ptoa(buf), itoa(count), type2name(datatype), status2str(status));
-    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
+    char **args = assemble_args_list(7, file2id(&fh), itoa(offset), ptoa(buf), itoa(count), type2name(datatype), status2str(status), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(7, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_read_all) (MPI_File fh, void *buf, int count, MPI_Datatype datatype, MPI_Status *status, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_read_all, (fh, buf, count, datatype, status), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_read_all, (fh, buf, count, datatype, status), ierr);
-    char **args = assemble_args_list(5, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), status2str(status));
-    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
+    char **args = assemble_args_list(6, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), status2str(status), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_read_shared) (MPI_File fh, void *buf, int count, MPI_Datatype datatype, MPI_Status *status, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_read_shared, (fh, buf, count, datatype, status), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_read_shared, (fh, buf, count, datatype, status), ierr);
-    char **args = assemble_args_list(5, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), status2str(status));
-    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
+    char **args = assemble_args_list(6, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), status2str(status), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_read_ordered) (MPI_File fh, void *buf, int count, MPI_Datatype datatype, MPI_Status *status, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_read_ordered, (fh, buf, count, datatype, status), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_read_ordered, (fh, buf, count, datatype, status), ierr);
-    char **args = assemble_args_list(5, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), status2str(status));
-    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
+    char **args = assemble_args_list(6, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), status2str(status), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_read_at_all_begin) (MPI_File fh, MPI_Offset offset, void *buf, int count, MPI_Datatype datatype, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_read_at_all_begin, (fh, offset, buf, count, datatype), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_read_at_all_begin, (fh, offset, buf, count, datatype), ierr);
-    char **args = assemble_args_list(5, file2id(&fh), itoa(offset), ptoa(buf), itoa(count), type2name(datatype));
-    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
+    char **args = assemble_args_list(6, file2id(&fh), itoa(offset), ptoa(buf), itoa(count), type2name(datatype), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_read_all_begin) (MPI_File fh, void *buf, int count, MPI_Datatype datatype, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_read_all_begin, (fh, buf, count, datatype), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_read_all_begin, (fh, buf, count, datatype), ierr);
-    char **args = assemble_args_list(4, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype));
-    RECORDER_INTERCEPTOR_EPILOGUE(4, args);
+    char **args = assemble_args_list(5, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_read_ordered_begin) (MPI_File fh, void *buf, int count, MPI_Datatype datatype, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_read_ordered_begin, (fh, buf, count, datatype), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_read_ordered_begin, (fh, buf, count, datatype), ierr);
-    char **args = assemble_args_list(4, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype));
-    RECORDER_INTERCEPTOR_EPILOGUE(4, args);
+    char **args = assemble_args_list(5, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_iread_at) (MPI_File fh, MPI_Offset offset, void *buf, int count, MPI_Datatype datatype, __D_MPI_REQUEST *request, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_iread_at, (fh, offset, buf, count, datatype, request), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_iread_at, (fh, offset, buf, count, datatype, request), ierr);
-    char **args = assemble_args_list(6, file2id(&fh), itoa(offset), ptoa(buf), itoa(count), type2name(datatype), ptoa(request));
-    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
+    if(res == MPI_SUCCESS)
+        add_io_request((size_t) *request, &fh, "MPI_File_iread_at", count, datatype);
+    char **args = assemble_args_list(7, file2id(&fh), itoa(offset), ptoa(buf), itoa(count), type2name(datatype), itoa((size_t) *request), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(7, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_iread) (MPI_File fh, void *buf, int count, MPI_Datatype datatype, __D_MPI_REQUEST *request, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_iread, (fh, buf, count, datatype, request), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_iread, (fh, buf, count, datatype, request), ierr);
-    char **args = assemble_args_list(5, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), ptoa(request));
-    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
+    if(res == MPI_SUCCESS)
+        add_io_request((size_t) *request, &fh, "MPI_File_iread", count, datatype);
+    char **args = assemble_args_list(6, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), itoa((size_t) *request), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_iread_shared) (MPI_File fh, void *buf, int count, MPI_Datatype datatype, __D_MPI_REQUEST *request, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_iread_shared, (fh, buf, count, datatype, request), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_iread_shared, (fh, buf, count, datatype, request), ierr);
-    char **args = assemble_args_list(5, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), ptoa(request));
-    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
+    if(res == MPI_SUCCESS)
+        add_io_request((size_t) *request, &fh, "MPI_File_iread_shared", count, datatype);
+    char **args = assemble_args_list(6, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), itoa((size_t) *request), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_write) (MPI_File fh, CONST void *buf, int count, MPI_Datatype datatype, MPI_Status *status, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_write, (fh, buf, count, datatype, status), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_write, (fh, buf, count, datatype, status), ierr);
-    char **args = assemble_args_list(5, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), status2str(status));
-    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
+    char **args = assemble_args_list(6, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), status2str(status), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_write_at) (MPI_File fh, MPI_Offset offset, CONST void *buf, int count, MPI_Datatype datatype, MPI_Status *status, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_write_at, (fh, offset, buf, count, datatype, status), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_write_at, (fh, offset, buf, count, datatype, status), ierr);
-    off64_t stored_offset = (off64_t) offset;
-    if (logger_intraprocess_pattern_recognition())
-        stored_offset = iopr_intraprocess("MPI_File_write_at", (off64_t)offset);
-    char **args = assemble_args_list(6, file2id(&fh), itoa(stored_offset), ptoa(buf), itoa(count), type2name(datatype), status2str(status));
-    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
+    char **args = assemble_args_list(7, file2id(&fh), itoa(offset), ptoa(buf), itoa(count), type2name(datatype), status2str(status), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(7, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_write_at_all) (MPI_File fh, MPI_Offset offset, CONST void *buf, int count, MPI_Datatype datatype, MPI_Status *status, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_write_at_all, (fh, offset, buf, count, datatype, status), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_write_at_all, (fh, offset, buf, count, datatype, status), ierr);
-    off64_t stored_offset = (off64_t) offset;
-    if (logger_intraprocess_pattern_recognition())
-        stored_offset = iopr_intraprocess("MPI_File_write_at_all", (off64_t)offset);
-    char **args = assemble_args_list(6, file2id(&fh), itoa(stored_offset), ptoa(buf), itoa(count), type2name(datatype), status2str(status));
-    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
+    char **args = assemble_args_list(7, file2id(&fh), itoa(offset), ptoa(buf), itoa(count), type2name(datatype), status2str(status), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(7, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_write_all) (MPI_File fh, CONST void *buf, int count, MPI_Datatype datatype, MPI_Status *status, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_write_all, (fh, buf, count, datatype, status), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_write_all, (fh, buf, count, datatype, status), ierr);
-    char **args = assemble_args_list(5, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), status2str(status));
-    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
+    char **args = assemble_args_list(6, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), status2str(status), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_write_shared) (MPI_File fh, CONST void *buf, int count, MPI_Datatype datatype, MPI_Status *status, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_write_shared, (fh, buf, count, datatype, status), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_write_shared, (fh, buf, count, datatype, status), ierr);
-    char **args = assemble_args_list(5, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), status2str(status));
-    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
+    char **args = assemble_args_list(6, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), status2str(status), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_write_ordered) (MPI_File fh, CONST void *buf, int count, MPI_Datatype datatype, MPI_Status *status, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_write_ordered, (fh, buf, count, datatype, status), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_write_ordered, (fh, buf, count, datatype, status), ierr);
-    char **args = assemble_args_list(5, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), status2str(status));
-    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
+    char **args = assemble_args_list(6, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), status2str(status), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_write_at_all_begin) (MPI_File fh, MPI_Offset offset, CONST void *buf, int count, MPI_Datatype datatype, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_write_at_all_begin, (fh, offset, buf, count, datatype), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_write_at_all_begin, (fh, offset, buf, count, datatype), ierr);
-    char **args = assemble_args_list(5, file2id(&fh), itoa(offset), ptoa(buf), itoa(count), type2name(datatype));
-    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
+    char **args = assemble_args_list(6, file2id(&fh), itoa(offset), ptoa(buf), itoa(count), type2name(datatype), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_write_all_begin) (MPI_File fh, CONST void *buf, int count, MPI_Datatype datatype, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_write_all_begin, (fh, buf, count, datatype), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_write_all_begin, (fh, buf, count, datatype), ierr);
-    char **args = assemble_args_list(4, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype));
-    RECORDER_INTERCEPTOR_EPILOGUE(4, args);
+    char **args = assemble_args_list(5, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_write_ordered_begin) (MPI_File fh, CONST void *buf, int count, MPI_Datatype datatype, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_write_ordered_begin, (fh, buf, count, datatype), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_write_ordered_begin, (fh, buf, count, datatype), ierr);
-    char **args = assemble_args_list(4, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype));
-    RECORDER_INTERCEPTOR_EPILOGUE(4, args);
+    char **args = assemble_args_list(5, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_iwrite_at) (MPI_File fh, MPI_Offset offset, CONST void *buf, int count, MPI_Datatype datatype, __D_MPI_REQUEST *request, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_iwrite_at, (fh, offset, buf, count, datatype, request), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_iwrite_at, (fh, offset, buf, count, datatype, request), ierr);
-    char **args = assemble_args_list(6, file2id(&fh), itoa(offset), ptoa(buf), itoa(count), type2name(datatype), ptoa(request));
-    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
+    if(res == MPI_SUCCESS)
+        add_io_request((size_t) *request, &fh, "MPI_File_iwrite_at", count, datatype);
+    char **args = assemble_args_list(7, file2id(&fh), itoa(offset), ptoa(buf), itoa(count), type2name(datatype), itoa((size_t) *request), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(7, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_iwrite) (MPI_File fh, CONST void *buf, int count, MPI_Datatype datatype, __D_MPI_REQUEST *request, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_iwrite, (fh, buf, count, datatype, request), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_iwrite, (fh, buf, count, datatype, request), ierr);
-    char **args = assemble_args_list(5, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), ptoa(request));
-    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
+    if(res == MPI_SUCCESS)
+        add_io_request((size_t) *request, &fh, "MPI_File_iwrite", count, datatype);
+    char **args = assemble_args_list(6, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), itoa((size_t) *request), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_iwrite_shared) (MPI_File fh, CONST void *buf, int count, MPI_Datatype datatype, __D_MPI_REQUEST *request, MPI_Fint* ierr) {
     FILTER_MPIIO_CALL(MPI_File_iwrite_shared, (fh, buf, count, datatype, request), &fh);
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_File_iwrite_shared, (fh, buf, count, datatype, request), ierr);
-    char **args = assemble_args_list(5, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), ptoa(request));
-    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
+    if(res == MPI_SUCCESS)
+        add_io_request((size_t) *request, &fh, "MPI_File_iwrite_shared", count, datatype);
+    char **args = assemble_args_list(6, file2id(&fh), ptoa(buf), itoa(count), type2name(datatype), itoa((size_t) *request), bytes2str(count, datatype));
+    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
 }
 
 int RECORDER_MPI_IMP(MPI_File_seek) (MPI_File fh, MPI_Offset offset, int whence, MPI_Fint* ierr) {
@@ -614,9 +1074,10 @@ int RECORDER_MPI_IMP(MPI_Cart_rank) (MPI_Comm comm, CONST int coords[], int *ran
     RECORDER_INTERCEPTOR_EPILOGUE(3, args);
 }
 int RECORDER_MPI_IMP(MPI_Cart_create) (MPI_Comm comm_old, int ndims, CONST int dims[], CONST int periods[], int reorder, MPI_Comm *comm_cart, MPI_Fint* ierr) {
-    RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_Cart_create, (comm_old, ndims, dims, periods, reorder, comm_cart), ierr);
-    int newrank = add_mpi_comm(comm_cart);
-    char **args = assemble_args_list(7, comm2name(&comm_old), itoa(ndims), ptoa(dims), ptoa(periods), itoa(reorder), comm2name(comm_cart), itoa(newrank));
+    RECORDER_INTERCEPTOR_PROLOGUE_F_TRACKED(int, MPI_Cart_create, (comm_old, ndims, dims, periods, reorder, comm_cart), ierr);
+    int newrank = add_mpi_comm(&comm_old, comm_cart);
+    add_mpi_cart(comm_cart, ndims, dims, periods);
+    char **args = assemble_args_list(7, comm2name(&comm_old), itoa(ndims), intarrtoa(dims, ndims), intarrtoa(periods, ndims), itoa(reorder), comm2name(comm_cart), itoa(newrank));
     RECORDER_INTERCEPTOR_EPILOGUE(7, args);
 }
 int RECORDER_MPI_IMP(MPI_Cart_get) (MPI_Comm comm, int maxdims, int dims[], int periods[], int coords[], MPI_Fint* ierr) {
@@ -632,38 +1093,39 @@ int RECORDER_MPI_IMP(MPI_Cart_shift) (MPI_Comm comm, int direction, int disp, in
 int RECORDER_MPI_IMP(MPI_Wait) (MPI_Request *request, MPI_Status *status, MPI_Fint* ierr) {
     size_t r = *request;
     MPI_Status *status_p = (status==MPI_STATUS_IGNORE) ? alloca(sizeof(MPI_Status)) : status;
-    RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_Wait, (request, status_p), ierr);
+    RECORDER_INTERCEPTOR_PROLOGUE_F_TRACKED(int, MPI_Wait, (request, status_p), ierr);
     char** args = assemble_args_list(2, itoa(r), status2str(status_p));
+    complete_io_request(record, r, status_p);
     RECORDER_INTERCEPTOR_EPILOGUE(2, args);
 }
 
 int RECORDER_MPI_IMP(MPI_Send) (CONST void *buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm, MPI_Fint* ierr) {
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_Send, (buf, count, datatype, dest, tag, comm), ierr);
-    char **args = assemble_args_list(6, ptoa(buf), itoa(count), type2name(datatype), itoa(dest), itoa(tag), comm2name(&comm));
+    char **args = assemble_args_list(6, ptoa(buf), itoa(count), type2name(datatype), peer2str(dest, comm), itoa(tag), comm2name(&comm));
     RECORDER_INTERCEPTOR_EPILOGUE(6, args);
 }
 int RECORDER_MPI_IMP(MPI_Recv) (void *buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm, MPI_Status *status, MPI_Fint* ierr) {
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_Recv, (buf, count, datatype, source, tag, comm, status), ierr);
-    char **args = assemble_args_list(7, ptoa(buf), itoa(count), type2name(datatype), itoa(source), itoa(tag), comm2name(&comm), status2str(status));
+    char **args = assemble_args_list(7, ptoa(buf), itoa(count), type2name(datatype), peer2str(source, comm), itoa(tag), comm2name(&comm), status2str(status));
     RECORDER_INTERCEPTOR_EPILOGUE(7, args);
 }
 int RECORDER_MPI_IMP(MPI_Sendrecv) (CONST void *sendbuf, int sendcount, MPI_Datatype sendtype, int dest, int sendtag, void *recvbuf, int recvcount, MPI_Datatype recvtype, int source, int recvtag, MPI_Comm comm, MPI_Status *status, MPI_Fint* ierr) {
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_Sendrecv, (sendbuf, sendcount, sendtype, dest, sendtag, recvbuf, recvcount, recvtype, source, recvtag, comm, status), ierr);
-    char **args = assemble_args_list(12, ptoa(sendbuf), itoa(sendcount), type2name(sendtype), itoa(dest), itoa(sendtag), ptoa(recvbuf), itoa(recvcount), type2name(recvtype),
-                                        itoa(source), itoa(recvtag), comm2name(&comm), status2str(status));
+    char **args = assemble_args_list(12, ptoa(sendbuf), itoa(sendcount), type2name(sendtype), peer2str(dest, comm), itoa(sendtag), ptoa(recvbuf), itoa(recvcount), type2name(recvtype),
+                                        peer2str(source, comm), itoa(recvtag), comm2name(&comm), status2str(status));
     RECORDER_INTERCEPTOR_EPILOGUE(12, args);
 }
 
 int RECORDER_MPI_IMP(MPI_Isend) (CONST void *buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm, MPI_Request *request, MPI_Fint* ierr) {
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_Isend, (buf, count, datatype, dest, tag, comm, request), ierr);
     size_t r = *request;
-    char **args = assemble_args_list(7, ptoa(buf), itoa(count), type2name(datatype), itoa(dest), itoa(tag), comm2name(&comm), itoa(r));
+    char **args = assemble_args_list(7, ptoa(buf), itoa(count), type2name(datatype), peer2str(dest, comm), itoa(tag), comm2name(&comm), itoa(r));
     RECORDER_INTERCEPTOR_EPILOGUE(7, args);
 }
 int RECORDER_MPI_IMP(MPI_Irecv) (void *buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm, MPI_Request *request, MPI_Fint* ierr) {
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_Irecv, (buf, count, datatype, source, tag, comm, request), ierr);
     size_t r = *request;
-    char **args = assemble_args_list(7, ptoa(buf), itoa(count), type2name(datatype), itoa(source), itoa(tag), comm2name(&comm), itoa(r));
+    char **args = assemble_args_list(7, ptoa(buf), itoa(count), type2name(datatype), peer2str(source, comm), itoa(tag), comm2name(&comm), itoa(r));
     RECORDER_INTERCEPTOR_EPILOGUE(7, args);
 }
 
@@ -675,8 +1137,10 @@ int RECORDER_MPI_IMP(MPI_Waitall) (int count, MPI_Request requests[], MPI_Status
         arr[i] = requests[i];
     char* requests_str = arrtoa(arr, count);
 
-    RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_Waitall, (count, requests, statuses), ierr);
+    RECORDER_INTERCEPTOR_PROLOGUE_F_TRACKED(int, MPI_Waitall, (count, requests, statuses), ierr);
     char **args = assemble_args_list(3, itoa(count), requests_str, ptoa(statuses));
+    for(i = 0; i < count; i++)
+        complete_io_request(record, arr[i], (statuses == MPI_STATUSES_IGNORE) ? MPI_STATUS_IGNORE : &statuses[i]);
     RECORDER_INTERCEPTOR_EPILOGUE(3, args);
 }
 int RECORDER_MPI_IMP(MPI_Waitsome) (int incount, MPI_Request requests[], int *outcount, int indices[], MPI_Status statuses[], MPI_Fint* ierr) {
@@ -686,12 +1150,13 @@ int RECORDER_MPI_IMP(MPI_Waitsome) (int incount, MPI_Request requests[], int *ou
         arr[i] = (size_t) requests[i];
     char* requests_str = arrtoa(arr, incount);
 
-    RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_Waitsome, (incount, requests, outcount, indices, statuses), ierr);
+    RECORDER_INTERCEPTOR_PROLOGUE_F_TRACKED(int, MPI_Waitsome, (incount, requests, outcount, indices, statuses), ierr);
     size_t arr2[*outcount];
     for(i = 0; i < *outcount; i++)
         arr2[i] = (size_t) indices[i];
     char* indices_str = arrtoa(arr2, *outcount);
     char **args = assemble_args_list(5, itoa(incount), requests_str, itoa(*outcount), indices_str, ptoa(statuses));
+    complete_io_requests(record, arr, *outcount, indices, statuses);
     RECORDER_INTERCEPTOR_EPILOGUE(5, args);
 }
 int RECORDER_MPI_IMP(MPI_Waitany) (int count, MPI_Request requests[], int *indx, MPI_Status *status, MPI_Fint* ierr) {
@@ -701,35 +1166,37 @@ int RECORDER_MPI_IMP(MPI_Waitany) (int count, MPI_Request requests[], int *indx,
         arr[i] = (size_t) requests[i];
     char* requests_str = arrtoa(arr, count);
 
-    RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_Waitany, (count, requests, indx, status), ierr);
+    RECORDER_INTERCEPTOR_PROLOGUE_F_TRACKED(int, MPI_Waitany, (count, requests, indx, status), ierr);
     char **args = assemble_args_list(4, itoa(count), requests_str, itoa(*indx), status2str(status));
+    if(*indx != MPI_UNDEFINED)
+        complete_io_requests(record, arr, 1, indx, status);
     RECORDER_INTERCEPTOR_EPILOGUE(4, args);
 }
 
 int RECORDER_MPI_IMP(MPI_Ssend) (CONST void *buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm, MPI_Fint* ierr) {
     RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_Ssend, (buf, count, datatype, dest, tag, comm), ierr);
-    char **args = assemble_args_list(6, ptoa(buf), itoa(count), type2name(datatype), itoa(dest), itoa(tag), comm2name(&comm));
+    char **args = assemble_args_list(6, ptoa(buf), itoa(count), type2name(datatype), peer2str(dest, comm), itoa(tag), comm2name(&comm));
     RECORDER_INTERCEPTOR_EPILOGUE(6, args);
 }
 
 
 int RECORDER_MPI_IMP(MPI_Comm_split) (MPI_Comm comm, int color, int key, MPI_Comm *newcomm, MPI_Fint* ierr) {
-    RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_Comm_split, (comm, color, key, newcomm), ierr);
-    int newrank = add_mpi_comm(newcomm);
+    RECORDER_INTERCEPTOR_PROLOGUE_F_TRACKED(int, MPI_Comm_split, (comm, color, key, newcomm), ierr);
+    int newrank = add_mpi_comm(&comm, newcomm);
     char **args = assemble_args_list(5, comm2name(&comm), itoa(color), itoa(key), comm2name(newcomm), itoa(newrank));
     RECORDER_INTERCEPTOR_EPILOGUE(5, args);
 }
 
 int RECORDER_MPI_IMP(MPI_Comm_create) (MPI_Comm comm, MPI_Group group, MPI_Comm *newcomm, MPI_Fint* ierr) {
-    RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_Comm_create, (comm, group, newcomm), ierr);
-    int newrank = add_mpi_comm(newcomm);
+    RECORDER_INTERCEPTOR_PROLOGUE_F_TRACKED(int, MPI_Comm_create, (comm, group, newcomm), ierr);
+    int newrank = add_mpi_comm(&comm, newcomm);
     char **args = assemble_args_list(4, comm2name(&comm), itoa(group), comm2name(newcomm), itoa(newrank));
     RECORDER_INTERCEPTOR_EPILOGUE(4, args);
 }
 
 int RECORDER_MPI_IMP(MPI_Comm_dup) (MPI_Comm comm, MPI_Comm *newcomm, MPI_Fint* ierr) {
-    RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_Comm_dup, (comm, newcomm), ierr);
-    int newrank = add_mpi_comm(newcomm);
+    RECORDER_INTERCEPTOR_PROLOGUE_F_TRACKED(int, MPI_Comm_dup, (comm, newcomm), ierr);
+    int newrank = add_mpi_comm(&comm, newcomm);
     char **args = assemble_args_list(3, comm2name(&comm), comm2name(newcomm), itoa(newrank));
     RECORDER_INTERCEPTOR_EPILOGUE(3, args);
 }
@@ -741,8 +1208,10 @@ int RECORDER_MPI_IMP(MPI_Comm_dup) (MPI_Comm comm, MPI_Comm *newcomm, MPI_Fint*
 int RECORDER_MPI_IMP(MPI_Test) (MPI_Request *request, int *flag, MPI_Status *status, MPI_Fint* ierr) {
     size_t r = *request;
     MPI_Status *status_p = (status==MPI_STATUS_IGNORE) ? alloca(sizeof(MPI_Status)) : status;
-    RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_Test, (request, flag, status_p), ierr);
+    RECORDER_INTERCEPTOR_PROLOGUE_F_TRACKED(int, MPI_Test, (request, flag, status_p), ierr);
     char **args = assemble_args_list(3, itoa(r), itoa(*flag), status2str(status_p));
+    if(*flag)
+        complete_io_request(record, r, status_p);
     RECORDER_INTERCEPTOR_EPILOGUE(3, args);
 }
 int RECORDER_MPI_IMP(MPI_Testall) (int count, MPI_Request requests[], int *flag, MPI_Status statuses[], MPI_Fint* ierr) {
@@ -752,8 +1221,10 @@ int RECORDER_MPI_IMP(MPI_Testall) (int count, MPI_Request requests[], int *flag,
         arr[i] = requests[i];
     char* requests_str = arrtoa(arr, count);
 
-    RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_Testall, (count, requests, flag, statuses), ierr);
+    RECORDER_INTERCEPTOR_PROLOGUE_F_TRACKED(int, MPI_Testall, (count, requests, flag, statuses), ierr);
     char **args = assemble_args_list(4, itoa(count), requests_str, itoa(*flag), ptoa(statuses));
+    for(i = 0; *flag && i < count; i++)
+        complete_io_request(record, arr[i], (statuses == MPI_STATUSES_IGNORE) ? MPI_STATUS_IGNORE : &statuses[i]);
     RECORDER_INTERCEPTOR_EPILOGUE(4, args);
 }
 int RECORDER_MPI_IMP(MPI_Testsome) (int incount, MPI_Request requests[], int *outcount, int indices[], MPI_Status statuses[], MPI_Fint* ierr) {
@@ -763,12 +1234,13 @@ int RECORDER_MPI_IMP(MPI_Testsome) (int incount, MPI_Request requests[], int *ou
         arr[i] = (size_t) requests[i];
     char* requests_str = arrtoa(arr, incount);
 
-    RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_Testsome, (incount, requests, outcount, indices, statuses), ierr);
+    RECORDER_INTERCEPTOR_PROLOGUE_F_TRACKED(int, MPI_Testsome, (incount, requests, outcount, indices, statuses), ierr);
     size_t arr2[*outcount];
     for(i = 0; i < *outcount; i++)
         arr2[i] = (size_t) indices[i];
     char* indices_str = arrtoa(arr2, *outcount);
     char **args = assemble_args_list(5, itoa(incount), requests_str, itoa(*outcount), indices_str, ptoa(statuses));
+    complete_io_requests(record, arr, *outcount, indices, statuses);
     RECORDER_INTERCEPTOR_EPILOGUE(5, args);
 }
 int RECORDER_MPI_IMP(MPI_Testany) (int count, MPI_Request requests[], int *indx, int *flag, MPI_Status *status, MPI_Fint* ierr) {
@@ -778,8 +1250,10 @@ int RECORDER_MPI_IMP(MPI_Testany) (int count, MPI_Request requests[], int *indx,
         arr[i] = (size_t) requests[i];
     char* requests_str = arrtoa(arr, count);
 
-    RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_Testany, (count, requests, indx, flag, status), ierr);
+    RECORDER_INTERCEPTOR_PROLOGUE_F_TRACKED(int, MPI_Testany, (count, requests, indx, flag, status), ierr);
     char **args = assemble_args_list(5, itoa(count), requests_str, itoa(*indx), itoa(*flag), status2str(status));
+    if(*flag && *indx != MPI_UNDEFINED)
+        complete_io_requests(record, arr, 1, indx, status);
     RECORDER_INTERCEPTOR_EPILOGUE(5, args);
 }
 
@@ -817,24 +1291,26 @@ int RECORDER_MPI_IMP(MPI_Comm_free) (MPI_Comm *comm, MPI_Fint* ierr) {
         HASH_DEL(mpi_comm_table, entry);
         free(entry->key);
         free(entry->id);
+        free(entry->dims);
+        free(entry->periods);
         free(entry);
     }
 
-    RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_Comm_free, (comm), ierr);
+    RECORDER_INTERCEPTOR_PROLOGUE_F_TRACKED(int, MPI_Comm_free, (comm), ierr);
     char **args = assemble_args_list(1, comm_name);
     RECORDER_INTERCEPTOR_EPILOGUE(1, args);
 }
 
 int RECORDER_MPI_IMP(MPI_Cart_sub) (MPI_Comm comm, CONST int remain_dims[], MPI_Comm *newcomm, MPI_Fint* ierr) {
-    RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_Cart_sub, (comm, remain_dims, newcomm), ierr);
-    int newrank = add_mpi_comm(newcomm);
+    RECORDER_INTERCEPTOR_PROLOGUE_F_TRACKED(int, MPI_Cart_sub, (comm, remain_dims, newcomm), ierr);
+    int newrank = add_mpi_comm(&comm, newcomm);
     char **args = assemble_args_list(4, comm2name(&comm), ptoa(remain_dims), comm2name(newcomm), itoa(newrank));
     RECORDER_INTERCEPTOR_EPILOGUE(4, args);
 }
 
 int RECORDER_MPI_IMP(MPI_Comm_split_type) (MPI_Comm comm, int split_type, int key, MPI_Info info, MPI_Comm *newcomm, MPI_Fint* ierr) {
-    RECORDER_INTERCEPTOR_PROLOGUE_F(int, MPI_Comm_split_type, (comm, split_type, key, info, newcomm), ierr);
-    int newrank = add_mpi_comm(newcomm);
+    RECORDER_INTERCEPTOR_PROLOGUE_F_TRACKED(int, MPI_Comm_split_type, (comm, split_type, key, info, newcomm), ierr);
+    int newrank = add_mpi_comm(&comm, newcomm);
     char **args = assemble_args_list(6, comm2name(&comm), itoa(split_type), itoa(key), ptoa(&info), comm2name(newcomm), itoa(newrank));
     RECORDER_INTERCEPTOR_EPILOGUE(6, args);
 }
@@ -8,198 +8,640 @@
 #include "recorder.h"
 #include "recorder-pattern-recognition.h"
 
-struct offset_cs_entry {
-    int offset_key_start;
-    int offset_key_end;
-    CallSignature* cs;
-};
+static offset_map_t* offset_map;
+
+/*
+ * iopr_offset_funcs index of each function id,
+ * -1 if it carries no offset
+ */
+static int offset_func_by_id[RECORDER_MAX_FUNCS];
+static bool offset_func_by_id_initialized = false;
+
+
+/*
+ * Delta encode the offset argument in place.
+ * Called by write_record() with the logger lock held,
+ * so records are encoded in the order they are stored.
+ */
+void iopr_intraprocess(Record* record) {
+    if(!offset_func_by_id_initialized) {
+        for(int i = 0; i < RECORDER_MAX_FUNCS; i++)
+            offset_func_by_id[i] = -1;
+        for(int f = 0; f < IOPR_NUM_OFFSET_FUNCS; f++)
+            offset_func_by_id[get_function_id_by_name(iopr_offset_funcs[f].func)] = f;
+        offset_func_by_id_initialized = true;
+    }
 
-static offset_map_t* func2offset_map;
+    if(record->func_id >= RECORDER_MAX_FUNCS)
+        return;
+    int f = offset_func_by_id[record->func_id];
+    if(f == -1)
+        return;
 
+    int file_idx   = iopr_offset_funcs[f].file_arg_idx;
+    int offset_idx = iopr_offset_funcs[f].offset_arg_idx;
+    if(record->arg_count <= offset_idx || record->arg_count <= file_idx)
+        return;
+    if(!record->args[file_idx] || !record->args[offset_idx])
+        return;
 
-off64_t iopr_intraprocess(const char *func, off64_t offset) {
-    offset_map_t* entry = NULL;
-    HASH_FIND_STR(func2offset_map, func, entry);
-    if (!entry) {
-        entry = (offset_map_t*) malloc(sizeof(offset_map_t));
-        entry->func = strdup(func);
-        entry->offset = offset;
-        HASH_ADD_STR(func2offset_map, func, entry);
-        return offset;
-    } else {
-        off64_t delta = offset - entry->offset;
-        entry->offset = offset;
-        return delta;
+    char* arg = iopr_delta_code(&offset_map, record->tid, record->func_id,
+                                record->args[file_idx], record->args[offset_idx], 0);
+    if(arg) {
+        free(record->args[offset_idx]);
+        record->args[offset_idx] = arg;
     }
 }
 
-int count_function(RecorderLogger *logger, unsigned char filter_func_id) {
-    int func_count = 0;
-
-    CallSignature *entry, *tmp;
-    HASH_ITER(hh, logger->cst, entry, tmp) {
-        void* ptr = entry->key+sizeof(pthread_t);
-        unsigned char func_id;
-        memcpy(&func_id, ptr, sizeof(func_id));
-        if(func_id == filter_func_id)
-            func_count++;
-    }
-
-    return func_count;
+void iopr_intraprocess_finalize() {
+    iopr_free_offset_map(&offset_map);
 }
 
-void iopr_interprocess_by_func(RecorderLogger *logger, char* func_name, int offset_arg_idx) {
+/*
+ * Fixed-size part exchanged by every rank, followed by
+ * the offsets of all its offset-bearing signatures, each
+ * as an (offset, file) pair, see IOPR_OFFSET/IOPR_FILE.
+ */
+#define IOPR_HEADER_WORLD_RANK  0
+#define IOPR_HEADER_NODE_ID     1
+#define IOPR_HEADER_COUNTS      2
+#define IOPR_HEADER_LEN         (IOPR_HEADER_COUNTS + IOPR_NUM_OFFSET_FUNCS)
 
-    unsigned char filter_func_id = get_function_id_by_name(func_name);
-    int func_count = count_function(logger, filter_func_id);
+#define IOPR_MIN_GROUP_SIZE     3
 
-    struct offset_cs_entry *offset_cs_entries = malloc(sizeof(struct offset_cs_entry) * func_count);
-    long int *offsets = malloc(sizeof(long int) * func_count);
+#define IOPR_OFFSET(offsets, k) ((offsets)[2*(k)])
+#define IOPR_FILE(offsets, k)   ((offsets)[2*(k)+1])
 
-    int args_start = cs_key_args_start();
+/*
+ * One offset, or one element of an offset vector
+ */
+struct offset_cs_entry {
+    int offset_key_start;       // first char of the offset (element)
+    int offset_key_end;         // the ' ', ',' or ']' after it
+    long int offset;
+    long int file;              // hash of the file argument
+    CallSignature* cs;
+};
 
-    int idx = 0;
-    CallSignature* entry;
-    CallSignature* tmp;
-    HASH_ITER(hh, logger->cst, entry, tmp) {
-        void* ptr = entry->key+sizeof(pthread_t);
+/*
+ * Locate argument arg_idx in the key and parse it as an integer
+ * or an integer vector "[a,b,...]", one entry per element.
+ * Return the number of entries, 0 if it is neither, e.g.,
+ * "???" or already a pattern.
+ */
+static int parse_offset_arg(CallSignature* cs, int args_start, int arg_idx,
+                            struct offset_cs_entry* out) {
+    char* key = (char*) cs->key;
+    int arg = 0, start = args_start;
+    int args_end = cs_key_args_end(cs);
+    for(int i = args_start; i < args_end; i++) {
+        if(key[i] != ' ')
+            continue;
+        if(arg == arg_idx) {
+            char offset_str[24*IOPR_MAX_DIMS] = {0};
+            if(i == start || i - start >= (int)sizeof(offset_str))
+                return 0;
+            memcpy(offset_str, key+start, i-start);
+            int64_t vals[IOPR_MAX_DIMS];
+            int is_vector;
+            int count = iopr_parse_offsets(offset_str, vals, &is_vector);
+            int pos = start + is_vector;
+            for(int e = 0; e < count; e++) {
+                int end = pos;
+                while(end < i && key[end] != ',' && key[end] != ']')
+                    end++;
+                out[e].offset_key_start = pos;
+                out[e].offset_key_end   = end;
+                out[e].offset = vals[e];
+                out[e].cs = cs;
+                pos = end + 1;
+            }
+            return count;
+        }
+        arg++;
+        start = i + 1;
+    }
+    return 0;
+}
 
-        unsigned char func_id;
-        memcpy(&func_id, ptr, sizeof(unsigned char));
+/*
+ * Hash of argument arg_idx in the key, -1 if there is none.
+ * An MPI-IO file id is the same on all ranks of the
+ * communicator that opened the file.
+ */
+static long int key_arg_hash(CallSignature* cs, int args_start, int arg_idx) {
+    char* key = (char*) cs->key;
+    int arg = 0, start = args_start;
+    int args_end = cs_key_args_end(cs);
+    for(int i = args_start; i < args_end; i++) {
+        if(key[i] != ' ')
+            continue;
+        if(arg == arg_idx)
+            return (long int) (cs_hash64(key+start, i-start) & 0x7FFFFFFFFFFFFFFF);
+        arg++;
+        start = i + 1;
+    }
+    return -1;
+}
 
-        if(func_id == filter_func_id) {
+/*
+ * Replace key[start, end) of a signature with str.
+ * The key is rehashed, its position in the CST is kept.
+ */
+static void rewrite_key_range(RecorderLogger* logger, CallSignature* cs,
+                              int start, int end, const char* str, int len) {
+    int args_start = cs_key_args_start();
 
-            char* key = (char*) entry->key;
+    int old_keylen = cs->key_len;
+    int new_keylen = old_keylen - (end-start) + len;
+    int new_arg_strlen = cs_key_args_end(cs) - args_start - (end-start) + len;
 
-            int arg_idx = 0;
-            int start = args_start, end = args_start;
+    char* newkey = recorder_malloc(new_keylen);
+    char* oldkey = cs->key;
 
-            for(int i = args_start; i < entry->key_len; i++) {
-                if(key[i] == ' ') {
-                    if(arg_idx == offset_arg_idx) {
-                        end = i;
-                        break;
-                    } else {
-                        arg_idx++;
-                        start = i;
-                    }
-                }
-            }
+    memcpy(newkey, oldkey, start);
+    memcpy(newkey+args_start-sizeof(int), &new_arg_strlen, sizeof(int));
+    memcpy(newkey+start, str, len);
+    memcpy(newkey+start+len, oldkey+end, old_keylen-end);
 
-            assert(end > start);
-            char offset_str[64] = {0};
-            memcpy(offset_str, key+start+1, end-start-1);
-            long int offset = atol(offset_str);
+    cs_table_rekey(&logger->cst, cs, newkey, new_keylen);
+    recorder_free(oldkey, old_keylen);
+}
 
-            offsets[idx] = offset;
-            offset_cs_entries[idx].offset_key_start = start;
-            offset_cs_entries[idx].offset_key_end   = end;
-            offset_cs_entries[idx].cs = entry;
+/*
+ * "%r" or "%0Wr" for the rank itself, "%{a*r+b}"
+ * or "%0W{a*r+b}" otherwise. The reader expands it.
+ */
+static int format_rank_template(char* buf, long int a, long int b, int width) {
+    int len = sprintf(buf, "%%");
+    if(width)
+        len += sprintf(buf+len, "0%d", width);
+    if(a == 1 && b == 0)
+        len += sprintf(buf+len, "r");
+    else
+        len += sprintf(buf+len, "{%ld*r+%ld}", a, b);
+    return len;
+}
 
-            idx++;
+/*
+ * Rank patterns are marked with '%' (see format_rank_template()),
+ * so a literal '%' in an argument, e.g., "%p" or a path, is
+ * escaped as "%%" first. The reader unescapes it.
+ */
+void iopr_escape_args(RecorderLogger* logger) {
+    int args_start = cs_key_args_start();
+    for(int i = 0; i < cs_table_count(&logger->cst); i++) {
+        CallSignature* cs = logger->cst.entries[i];
+        // backwards, so the positions below k stay valid
+        for(int k = cs_key_args_end(cs)-1; k >= args_start; k--) {
+            if(((char*)cs->key)[k] == '%')
+                rewrite_key_range(logger, cs, k, k+1, "%%", 2);
         }
     }
+}
+
+/*
+ * Replace the offset (element) with "%{a*r+b}",
+ * where r is the world rank. The reader expands it back.
+ */
+static void rewrite_offset_arg(RecorderLogger* logger, struct offset_cs_entry* e,
+                               long int a, long int b) {
+    char pattern[64];
+    int pattern_len = format_rank_template(pattern, a, b, 0);
+    rewrite_key_range(logger, e->cs, e->offset_key_start, e->offset_key_end, pattern, pattern_len);
+}
+
+/*
+ * Check if the offsets at index k of all members follow
+ * offset = a * world_rank + b. Members are given by index
+ * into the gathered headers/offsets.
+ */
+static int fit_affine(long int** member_headers, long int** member_offsets,
+                      int* members, int num_members, int k, long int* a, long int* b) {
+    if(num_members < IOPR_MIN_GROUP_SIZE)
+        return 0;
+
+    long int r0 = member_headers[members[0]][IOPR_HEADER_WORLD_RANK];
+    long int r1 = member_headers[members[1]][IOPR_HEADER_WORLD_RANK];
+    long int o0 = IOPR_OFFSET(member_offsets[members[0]], k);
+    long int o1 = IOPR_OFFSET(member_offsets[members[1]], k);
+    *a = (o1 - o0) / (r1 - r0);
+    *b = o0 - (*a) * r0;
+
+    for(int m = 0; m < num_members; m++) {
+        long int r = member_headers[members[m]][IOPR_HEADER_WORLD_RANK];
+        if(IOPR_OFFSET(member_offsets[members[m]], k) != (*a)*r + (*b))
+            return 0;
+    }
+    return 1;
+}
+
+static long int get_node_id() {
+    char hostname[256] = {0};
+    gethostname(hostname, sizeof(hostname)-1);
+    return (long int) (cs_hash64(hostname, strlen(hostname)) & 0x7FFFFFFFFFFFFFFF);
+}
+
+/*
+ * Interprocess offset pattern recognition
+ *
+ * 1. Collect the offsets of all offset-bearing signatures,
+ *    ordered by function and then by CST insertion order.
+ *    Each element of an offset vector (e.g., the start of
+ *    a hyperslab) counts as one offset.
+ * 2. Ranks with the same number of signatures per function
+ *    are put in one communicator (a single MPI_Comm_split).
+ * 3. One Allgather of a fixed-size header (world rank, node,
+ *    counts) and one Allgatherv of all offsets, along with
+ *    a hash of the file of each.
+ * 4. For each signature, check offset = a * rank + b over all
+ *    ranks with the same counts; if not, over those of them
+ *    with the same file, i.e., for MPI-IO, the sub-communicator
+ *    that opened it; if not, over those on the same node.
+ *    Matching signatures are rewritten.
+ *
+ * The number of collectives does not depend on the number
+ * of functions recognized.
+ */
+void iopr_interprocess(RecorderLogger *logger) {
+
+    // Non-MPI programs
+    // no need for interprocess pattern recognition
+    int mpi_initialized;
+    PMPI_Initialized(&mpi_initialized);
+    if (!mpi_initialized)
+        return;
 
     GOTCHA_SET_REAL_CALL(MPI_Comm_split, RECORDER_MPI);
     GOTCHA_SET_REAL_CALL(MPI_Comm_size,  RECORDER_MPI);
-    GOTCHA_SET_REAL_CALL(MPI_Comm_rank,  RECORDER_MPI);
     GOTCHA_SET_REAL_CALL(MPI_Comm_free,  RECORDER_MPI);
     GOTCHA_SET_REAL_CALL(MPI_Allgather,  RECORDER_MPI);
+    GOTCHA_SET_REAL_CALL(MPI_Allgatherv, RECORDER_MPI);
+
+    int args_start = cs_key_args_start();
+    uint16_t func_ids[IOPR_NUM_OFFSET_FUNCS];
+    for(int f = 0; f < IOPR_NUM_OFFSET_FUNCS; f++)
+        func_ids[f] = get_function_id_by_name(iopr_offset_funcs[f].func);
+
+    // 1. Collect offsets, grouped by function
+    long int header[IOPR_HEADER_LEN] = {0};
+    header[IOPR_HEADER_WORLD_RANK] = logger->rank;
+    header[IOPR_HEADER_NODE_ID]    = get_node_id();
+
+    int num_entries = cs_table_count(&logger->cst);
+    int num_parsed = 0, max_parsed = num_entries + IOPR_MAX_DIMS;
+    int* entry_func = malloc(sizeof(int) * max_parsed);
+    struct offset_cs_entry* parsed = malloc(sizeof(struct offset_cs_entry) * max_parsed);
+    for(int i = 0; i < num_entries; i++) {
+        CallSignature* cs = logger->cst.entries[i];
+        uint16_t func_id;
+        memcpy(&func_id, cs->key+sizeof(pthread_t), sizeof(func_id));
+        for(int f = 0; f < IOPR_NUM_OFFSET_FUNCS; f++) {
+            if(func_id != func_ids[f])
+                continue;
+            if(num_parsed + IOPR_MAX_DIMS > max_parsed) {
+                max_parsed *= 2;
+                entry_func = realloc(entry_func, sizeof(int) * max_parsed);
+                parsed = realloc(parsed, sizeof(struct offset_cs_entry) * max_parsed);
+            }
+            int n = parse_offset_arg(cs, args_start, iopr_offset_funcs[f].offset_arg_idx, &parsed[num_parsed]);
+            long int file = n ? key_arg_hash(cs, args_start, iopr_offset_funcs[f].file_arg_idx) : -1;
+            for(int e = 0; e < n; e++) {
+                parsed[num_parsed].file = file;
+                entry_func[num_parsed++] = f;
+            }
+            header[IOPR_HEADER_COUNTS+f] += n;
+            break;
+        }
+    }
+
+    int total = 0;
+    int func_start[IOPR_NUM_OFFSET_FUNCS];
+    for(int f = 0; f < IOPR_NUM_OFFSET_FUNCS; f++) {
+        func_start[f] = total;
+        total += header[IOPR_HEADER_COUNTS+f];
+    }
+
+    struct offset_cs_entry* offset_cs_entries = malloc(sizeof(struct offset_cs_entry) * (total+1));
+    long int* offsets = malloc(sizeof(long int) * 2 * (total+1));
+    int fill[IOPR_NUM_OFFSET_FUNCS];
+    memcpy(fill, func_start, sizeof(fill));
+    for(int i = 0; i < num_parsed; i++) {
+        int k = fill[entry_func[i]]++;
+        offset_cs_entries[k] = parsed[i];
+        IOPR_OFFSET(offsets, k) = parsed[i].offset;
+        IOPR_FILE(offsets, k)   = parsed[i].file;
+    }
+    free(entry_func);
+    free(parsed);
+
+    // 2. One communicator for ranks with the same counts
+    unsigned color = 2166136261U;
+    for(int f = 0; f < IOPR_NUM_OFFSET_FUNCS; f++)
+        color = (color ^ (unsigned)header[IOPR_HEADER_COUNTS+f]) * 16777619U;
+    color = color & 0x7FFFFFFF;
 
     MPI_Comm comm;
-    int comm_size, comm_rank;
-    GOTCHA_REAL_CALL(MPI_Comm_split)(MPI_COMM_WORLD, func_count, logger->rank, &comm);
+    int comm_size;
+    GOTCHA_REAL_CALL(MPI_Comm_split)(MPI_COMM_WORLD, (int)color, logger->rank, &comm);
     GOTCHA_REAL_CALL(MPI_Comm_size)(comm, &comm_size);
-    GOTCHA_REAL_CALL(MPI_Comm_rank)(comm, &comm_rank);
-
-    if(comm_rank == 0)
-        RECORDER_LOGDBG("%s count: %d, comm size: %d\n", func_name, func_count, comm_size);
-
-    if(comm_size > 2) {
-        long int *all_offsets = calloc(comm_size*(func_count), sizeof(long int));
-        GOTCHA_REAL_CALL(MPI_Allgather)(offsets, func_count, MPI_LONG,
-                                            all_offsets, func_count, MPI_LONG, comm);
-
-        // Fory every offset of the same I/O call
-        // check if it is the form of offset = a * rank + b;
-        for(int i = 0; i < func_count; i++) {
-
-            long int o1 = all_offsets[i];
-            long int o2 = all_offsets[i+func_count];
-            long int a = o2 - o1;
-            long int b = o1;
-            int same_pattern = 1;
-            for(int r = 0; r < comm_size; r++) {
-                long int o = all_offsets[i+func_count*r];
-                if(o != a*r+b) {
-                    same_pattern = 0;
-                    break;
-                }
-            }
 
-            // Everyone has the same pattern of offset
-            // Then modify the call signature to store
-            // the pattern instead of the actuall offset
-            // TODO we should store a and b, but now we
-            // store a only
-            if(same_pattern) {
-                HASH_DEL(logger->cst, offset_cs_entries[i].cs);
+    // 3. Exchange headers and offsets
+    long int* all_headers = malloc(sizeof(long int) * IOPR_HEADER_LEN * comm_size);
+    GOTCHA_REAL_CALL(MPI_Allgather)(header, IOPR_HEADER_LEN, MPI_LONG,
+                                    all_headers, IOPR_HEADER_LEN, MPI_LONG, comm);
+
+    int* recvcounts = malloc(sizeof(int) * comm_size);
+    int* displs = malloc(sizeof(int) * comm_size);
+    int all_total = 0;
+    for(int m = 0; m < comm_size; m++) {
+        int n = 0;
+        for(int f = 0; f < IOPR_NUM_OFFSET_FUNCS; f++)
+            n += all_headers[m*IOPR_HEADER_LEN+IOPR_HEADER_COUNTS+f];
+        recvcounts[m] = 2*n;
+        displs[m] = all_total;
+        all_total += 2*n;
+    }
+    long int* all_offsets = malloc(sizeof(long int) * (all_total+1));
+    GOTCHA_REAL_CALL(MPI_Allgatherv)(offsets, 2*total, MPI_LONG,
+                                     all_offsets, recvcounts, displs, MPI_LONG, comm);
+
+    // 4. Members: ranks with exactly the same counts as mine
+    // (color is a hash, so this also filters out collisions)
+    long int** member_headers = malloc(sizeof(long int*) * comm_size);
+    long int** member_offsets = malloc(sizeof(long int*) * comm_size);
+    int* group = malloc(sizeof(int) * comm_size);
+    int* node  = malloc(sizeof(int) * comm_size);
+    int* file  = malloc(sizeof(int) * comm_size);
+    int group_size = 0, node_size = 0;
+    for(int m = 0; m < comm_size; m++) {
+        member_headers[m] = all_headers + m*IOPR_HEADER_LEN;
+        member_offsets[m] = all_offsets + displs[m];
+        if(memcmp(member_headers[m]+IOPR_HEADER_COUNTS, header+IOPR_HEADER_COUNTS,
+                  sizeof(long int)*IOPR_NUM_OFFSET_FUNCS) != 0)
+            continue;
+        group[group_size++] = m;
+        if(member_headers[m][IOPR_HEADER_NODE_ID] == header[IOPR_HEADER_NODE_ID])
+            node[node_size++] = m;
+    }
 
-                int start = offset_cs_entries[i].offset_key_start;
-                int end   = offset_cs_entries[i].offset_key_end;
+    // Backwards, so rewriting an element of a vector does not
+    // move the elements before it in the same key
+    int recognized = 0;
+    for(int k = total-1; k >= 0; k--) {
+        long int a, b;
+        int fit = fit_affine(member_headers, member_offsets, group, group_size, k, &a, &b);
+        if(!fit) {
+            int file_size = 0;
+            for(int g = 0; g < group_size; g++)
+                if(IOPR_FILE(member_offsets[group[g]], k) == IOPR_FILE(offsets, k))
+                    file[file_size++] = group[g];
+            if(file_size < group_size)
+                fit = fit_affine(member_headers, member_offsets, file, file_size, k, &a, &b);
+        }
+        if(!fit)
+            fit = fit_affine(member_headers, member_offsets, node, node_size, k, &a, &b);
+        if(fit) {
+            rewrite_offset_arg(logger, &offset_cs_entries[k], a, b);
+            recognized++;
+        }
+    }
 
-                char* tmp = calloc(64, 1);
-                sprintf(tmp, "%ld*r+%ld", a, b);
+    if(logger->rank == 0)
+        RECORDER_LOGDBG("[Recorder] interprocess pattern recognition: %d of %d offsets, group size: %d\n",
+                        recognized, total, group_size);
 
-                if(comm_rank == 0)
-                    RECORDER_LOGDBG("pattern recognized %d: offset = %ld*rank+%ld\n", offset_cs_entries[i].cs->terminal_id, a, b);
+    GOTCHA_REAL_CALL(MPI_Comm_free)(&comm);
+    free(member_headers);
+    free(member_offsets);
+    free(group);
+    free(node);
+    free(file);
+    free(recvcounts);
+    free(displs);
+    free(all_headers);
+    free(all_offsets);
+    free(offsets);
+    free(offset_cs_entries);
+}
 
-                int old_keylen = offset_cs_entries[i].cs->key_len;
-                int new_keylen = old_keylen - (end-start-1) + strlen(tmp);
-                int new_arg_strlen = new_keylen - args_start;
 
-                void* newkey = malloc(new_keylen);
-                void* oldkey = offset_cs_entries[i].cs->key;
+/*
+ * Filename templating
+ *
+ * A path argument with an embedded integer, e.g., "ckpt.12.dat",
+ * is split into a skeleton ("ckpt.#.dat") and a value (12).
+ * Paths of file-per-process workloads share the skeleton across
+ * ranks and the value is affine in the rank. Such paths are
+ * rewritten as a template, e.g., "ckpt.%r.dat", so all ranks
+ * end up with the same signature.
+ */
+#define IOPR_MAX_RUNS_PER_ARG   4
+#define IOPR_MAX_RUN_DIGITS     18
+
+struct path_candidate {
+    CallSignature* cs;
+    int arg_start, arg_end;     // the argument in cs->key
+    int run_start, run_end;     // the integer inside the argument
+    int width;                  // zero-padded width, 0 if not padded
+    uint64_t skeleton;          // hash of the argument without the integer
+    long int value;
+};
 
-                memcpy(newkey, oldkey, start+1);
-                memcpy(newkey+args_start-sizeof(int), &new_arg_strlen, sizeof(int));
-                memcpy(newkey+start+1, tmp, strlen(tmp));
-                memcpy(newkey+start+1+strlen(tmp), oldkey+end, old_keylen-end);
+// exchanged between ranks
+struct path_skeleton {
+    uint64_t skeleton;
+    long int value;
+};
 
-                offset_cs_entries[i].cs->key = newkey;
-                offset_cs_entries[i].cs->key_len = new_keylen;
-                HASH_ADD_KEYPTR(hh, logger->cst, offset_cs_entries[i].cs->key, offset_cs_entries[i].cs->key_len, offset_cs_entries[i].cs);
+static int is_path_arg(const char* arg, int len) {
+    if(len >= 2 && arg[0] == '0' && arg[1] == 'x')     // pointer
+        return 0;
+    int has_sep = 0;
+    for(int i = 0; i < len; i++) {
+        if(arg[i] == '/' || arg[i] == '.')
+            has_sep = 1;
+    }
+    return has_sep;
+}
 
+static uint64_t skeleton_hash(const char* key, int arg_start, int run_start, int run_end, int arg_end) {
+    int len = (run_start-arg_start) + 1 + (arg_end-run_end);
+    char* buf = malloc(len);
+    memcpy(buf, key+arg_start, run_start-arg_start);
+    buf[run_start-arg_start] = 0;
+    memcpy(buf+run_start-arg_start+1, key+run_end, arg_end-run_end);
+    uint64_t h = cs_hash64(buf, len);
+    free(buf);
+    return h;
+}
 
-                free(oldkey);
-                free(tmp);
-            }
+/*
+ * Append the candidates of one argument, at most
+ * IOPR_MAX_RUNS_PER_ARG integers from the end.
+ */
+static int collect_path_candidates(CallSignature* cs, int arg_start, int arg_end,
+                                   struct path_candidate** cands, int* num, int* cap) {
+    char* key = (char*) cs->key;
+    if(!is_path_arg(key+arg_start, arg_end-arg_start))
+        return 0;
+
+    int runs = 0;
+    int i = arg_end;
+    while(i > arg_start && runs < IOPR_MAX_RUNS_PER_ARG) {
+        if(key[i-1] < '0' || key[i-1] > '9') {
+            i--;
+            continue;
         }
-        free(all_offsets);
+        int run_end = i;
+        while(i > arg_start && key[i-1] >= '0' && key[i-1] <= '9')
+            i--;
+        int run_start = i;
+        int digits = run_end - run_start;
+        if(digits > IOPR_MAX_RUN_DIGITS)
+            continue;
+
+        if(*num == *cap) {
+            *cap *= 2;
+            *cands = realloc(*cands, sizeof(struct path_candidate) * (*cap));
+        }
+        struct path_candidate* c = &(*cands)[(*num)++];
+        char digits_str[IOPR_MAX_RUN_DIGITS+1] = {0};
+        memcpy(digits_str, key+run_start, digits);
+        c->cs = cs;
+        c->arg_start = arg_start;
+        c->arg_end   = arg_end;
+        c->run_start = run_start;
+        c->run_end   = run_end;
+        c->width     = (digits > 1 && key[run_start] == '0') ? digits : 0;
+        c->value     = strtol(digits_str, NULL, 10);
+        c->skeleton  = skeleton_hash(key, arg_start, run_start, run_end, arg_end);
+        runs++;
     }
+    return runs;
+}
 
-    GOTCHA_REAL_CALL(MPI_Comm_free)(&comm);
-    free(offsets);
-    free(offset_cs_entries);
+static int compare_skeletons(const void* a, const void* b) {
+    const struct path_skeleton* x = a;
+    const struct path_skeleton* y = b;
+    if(x->skeleton != y->skeleton)
+        return x->skeleton < y->skeleton ? -1 : 1;
+    if(x->value != y->value)
+        return x->value < y->value ? -1 : 1;
+    return 0;
 }
 
-void iopr_interprocess(RecorderLogger *logger) {
+/*
+ * Value of a skeleton in the (sorted) list of another rank.
+ * Return 0 if it is missing or ambiguous.
+ */
+static int find_skeleton(struct path_skeleton* list, int n, uint64_t skeleton, long int* value) {
+    int lo = 0, hi = n;
+    while(lo < hi) {
+        int mid = (lo + hi) / 2;
+        if(list[mid].skeleton < skeleton)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if(lo == n || list[lo].skeleton != skeleton)
+        return 0;
+    if(lo+1 < n && list[lo+1].skeleton == skeleton && list[lo+1].value != list[lo].value)
+        return 0;
+    *value = list[lo].value;
+    return 1;
+}
 
-    // Non-MPI programs
-    // no need for interprocess pattern recognition
+/*
+ * Only two small lists are exchanged: rank 0's list is
+ * broadcast, and rank 1 sends its list to rank 0. Each rank
+ * then fits value = a * rank + b against its partner (rank 0,
+ * or rank 1 for rank 0) and templates its own paths. Templating
+ * is decided locally, so it is lossless even where the fit does
+ * not hold on other ranks.
+ */
+void iopr_filename_templates(RecorderLogger* logger) {
     int mpi_initialized;
     PMPI_Initialized(&mpi_initialized);
-    if (!mpi_initialized)
+    if (!mpi_initialized || logger->nprocs < 2)
         return;
 
-    iopr_interprocess_by_func(logger, "lseek", 1);
-    iopr_interprocess_by_func(logger, "lseek64", 1);
-    iopr_interprocess_by_func(logger, "pread", 3);
-    iopr_interprocess_by_func(logger, "pread64", 3);
-    iopr_interprocess_by_func(logger, "pwrite", 3);
-    iopr_interprocess_by_func(logger, "pwrite64", 3);
-    iopr_interprocess_by_func(logger, "MPI_File_read_at", 1);
-    iopr_interprocess_by_func(logger, "MPI_File_read_at_all", 1);
-    iopr_interprocess_by_func(logger, "MPI_File_write_at", 1);
-    iopr_interprocess_by_func(logger, "MPI_File_write_at_all", 1);
+    int args_start = cs_key_args_start();
+    int num = 0, cap = 64;
+    struct path_candidate* cands = malloc(sizeof(struct path_candidate) * cap);
+
+    for(int i = 0; i < cs_table_count(&logger->cst); i++) {
+        CallSignature* cs = logger->cst.entries[i];
+        char* key = (char*) cs->key;
+        int start = args_start;
+        int args_end = cs_key_args_end(cs);
+        for(int k = args_start; k < args_end; k++) {
+            if(key[k] != ' ')
+                continue;
+            collect_path_candidates(cs, start, k, &cands, &num, &cap);
+            start = k + 1;
+        }
+    }
+
+    struct path_skeleton* mine = malloc(sizeof(struct path_skeleton) * (num+1));
+    for(int i = 0; i < num; i++) {
+        mine[i].skeleton = cands[i].skeleton;
+        mine[i].value    = cands[i].value;
+    }
+    qsort(mine, num, sizeof(struct path_skeleton), compare_skeletons);
+
+    // Partner: rank 0 for everyone else, rank 1 for rank 0
+    int partner = (logger->rank == 0) ? 1 : 0;
+    int partner_num = num;
+    struct path_skeleton* partner_list = NULL;
+
+    recorder_bcast(&partner_num, sizeof(int), 0, MPI_COMM_WORLD);
+    if(logger->rank == 0) {
+        recorder_recv(&partner_num, sizeof(int), 1, 0, MPI_COMM_WORLD);
+        partner_list = malloc(sizeof(struct path_skeleton) * (partner_num+1));
+        recorder_recv(partner_list, sizeof(struct path_skeleton)*partner_num, 1, 0, MPI_COMM_WORLD);
+        recorder_bcast(mine, sizeof(struct path_skeleton)*num, 0, MPI_COMM_WORLD);
+    } else {
+        if(logger->rank == 1) {
+            recorder_send(&num, sizeof(int), 0, 0, MPI_COMM_WORLD);
+            recorder_send(mine, sizeof(struct path_skeleton)*num, 0, 0, MPI_COMM_WORLD);
+        }
+        partner_list = malloc(sizeof(struct path_skeleton) * (partner_num+1));
+        recorder_bcast(partner_list, sizeof(struct path_skeleton)*partner_num, 0, MPI_COMM_WORLD);
+    }
+
+    // Candidates are in key order, go backwards so the
+    // positions of the remaining ones stay valid after
+    // a rewrite. At most one integer per argument.
+    int templated = 0;
+    CallSignature* last_cs = NULL;
+    int last_arg_start = -1;
+    for(int i = num-1; i >= 0; i--) {
+        struct path_candidate* c = &cands[i];
+        if(c->cs == last_cs && c->arg_start == last_arg_start)
+            continue;
+
+        long int partner_value;
+        if(!find_skeleton(partner_list, partner_num, c->skeleton, &partner_value))
+            continue;
+        long int diff = c->value - partner_value;
+        long int a = diff / (logger->rank - partner);
+        long int b = c->value - a * logger->rank;
+        if(a == 0 || a * (logger->rank - partner) != diff)
+            continue;
+
+        char tmpl[64];
+        int tmpl_len = format_rank_template(tmpl, a, b, c->width);
+        rewrite_key_range(logger, c->cs, c->run_start, c->run_end, tmpl, tmpl_len);
+        last_cs = c->cs;
+        last_arg_start = c->arg_start;
+        templated++;
+    }
+
+    if(logger->rank == 0)
+        RECORDER_LOGDBG("[Recorder] filename templating: %d of %d path candidates\n", templated, num);
+
+    free(partner_list);
+    free(mine);
+    free(cands);
 }
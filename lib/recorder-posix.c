@@ -66,9 +66,9 @@ static inline char* stream2name(FILE* stream) {
 #define ARG_TYPE_STREAM     1
 #define ARG_TYPE_PATH       2
 
-#define GET_CHECK_FILENAME(func, func_args, f_arg, f_arg_type)      \
+#define GET_CHECK_FILENAME_IF(cond, func, func_args, f_arg, f_arg_type) \
     char* _fname = NULL;                                            \
-    if(logger_initialized()) {                                      \
+    if(cond) {                                                      \
         if(f_arg_type == ARG_TYPE_PATH)                             \
             _fname = realrealpath((char*) f_arg);                   \
         if(f_arg_type == ARG_TYPE_STREAM)                           \
@@ -83,6 +83,54 @@ static inline char* stream2name(FILE* stream) {
     }                                                               \
     assert(accept_filename(_fname) == 1);
 
+/*
+ * Paused calls are not recorded (see recorder.h), except for
+ * the _TRACKED ones, which keep the fd and stream maps current.
+ */
+#define GET_CHECK_FILENAME(func, func_args, f_arg, f_arg_type)      \
+    GET_CHECK_FILENAME_IF(logger_tracing(), func, func_args, f_arg, f_arg_type)
+
+#define GET_CHECK_TRACKED_FILENAME(func, func_args, f_arg, f_arg_type) \
+    GET_CHECK_FILENAME_IF(logger_initialized(), func, func_args, f_arg, f_arg_type)
+
+/**
+ * Absolute path of the (dirfd, path) pair of the *at() calls.
+ * An empty path (AT_EMPTY_PATH) refers to dirfd itself.
+ * NULL if path is relative to a directory we do not know.
+ */
+static inline char* at2name(int dirfd, const char* path) {
+    if(path == NULL || path[0] == 0)
+        return fd2name(dirfd);
+    if(path[0] == '/' || dirfd == AT_FDCWD)
+        return realrealpath(path);
+
+    char* dir = fd2name(dirfd);
+    if(dir == NULL)
+        return NULL;
+    char* joined = malloc(strlen(dir) + strlen(path) + 2);
+    sprintf(joined, "%s/%s", dir, path);
+    char* name = realrealpath(joined);
+    free(joined);
+    free(dir);
+    return name;
+}
+
+#define GET_CHECK_AT_FILENAME_IF(cond, func, func_args, dirfd, path) \
+    char* _fname = NULL;                                            \
+    if(cond)                                                        \
+        _fname = at2name(dirfd, path);                              \
+    if(_fname== NULL || !accept_filename(_fname)) {                 \
+        if(_fname) free(_fname);                                    \
+        GOTCHA_SET_REAL_CALL(func, RECORDER_POSIX);                 \
+        return GOTCHA_REAL_CALL(func) func_args;                    \
+    }
+
+#define GET_CHECK_AT_FILENAME(func, func_args, dirfd, path)         \
+    GET_CHECK_AT_FILENAME_IF(logger_tracing(), func, func_args, dirfd, path)
+
+#define GET_CHECK_TRACKED_AT_FILENAME(func, func_args, dirfd, path) \
+    GET_CHECK_AT_FILENAME_IF(logger_initialized(), func, func_args, dirfd, path)
+
 
 /**
  * Caller need to guarantee that the filename
@@ -134,18 +182,18 @@ static inline void remove_from_map(void* arg, int arg_type) {
  *********************************************************************************/
 
 int WRAPPER_NAME(close)(int fd) {
-    GET_CHECK_FILENAME(close, (fd), &fd, ARG_TYPE_FD);
-    RECORDER_INTERCEPTOR_PROLOGUE(int, close, (fd));
+    GET_CHECK_TRACKED_FILENAME(close, (fd), &fd, ARG_TYPE_FD);
+    RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(int, close, (fd));
     remove_from_map(&fd, ARG_TYPE_FD);
     char** args = assemble_args_list(1, _fname);
     RECORDER_INTERCEPTOR_EPILOGUE(1, args);
 }
 
 int WRAPPER_NAME(fclose)(FILE *stream) {
-    GET_CHECK_FILENAME(fclose, (stream), stream, ARG_TYPE_STREAM);
+    GET_CHECK_TRACKED_FILENAME(fclose, (stream), stream, ARG_TYPE_STREAM);
     char** args = assemble_args_list(1, _fname);
     remove_from_map(stream, ARG_TYPE_STREAM);
-    RECORDER_INTERCEPTOR_PROLOGUE(int, fclose, (stream));
+    RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(int, fclose, (stream));
     RECORDER_INTERCEPTOR_EPILOGUE(1, args);
 }
 
@@ -184,16 +232,16 @@ int WRAPPER_NAME(msync)(void *addr, size_t length, int flags) {
 }
 
 int WRAPPER_NAME(creat)(const char *path, mode_t mode) {
-    GET_CHECK_FILENAME(creat, (path, mode), path, ARG_TYPE_PATH);
-    RECORDER_INTERCEPTOR_PROLOGUE(int, creat, (path, mode));
+    GET_CHECK_TRACKED_FILENAME(creat, (path, mode), path, ARG_TYPE_PATH);
+    RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(int, creat, (path, mode));
     add_to_map(_fname, &res, ARG_TYPE_FD);
     char** args = assemble_args_list(2, _fname, itoa(mode));
     RECORDER_INTERCEPTOR_EPILOGUE(2, args);
 }
 
 int WRAPPER_NAME(creat64)(const char *path, mode_t mode) {
-    GET_CHECK_FILENAME(creat64, (path, mode), path, ARG_TYPE_PATH);
-    RECORDER_INTERCEPTOR_PROLOGUE(int, creat64, (path, mode));
+    GET_CHECK_TRACKED_FILENAME(creat64, (path, mode), path, ARG_TYPE_PATH);
+    RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(int, creat64, (path, mode));
     add_to_map(_fname, &res, ARG_TYPE_FD);
     char** args = assemble_args_list(2, _fname, itoa(mode));
     RECORDER_INTERCEPTOR_EPILOGUE(2, args);
@@ -205,15 +253,15 @@ int WRAPPER_NAME(open64)(const char *path, int flags, ...) {
         va_start(arg, flags);
         int mode = va_arg(arg, int);
         va_end(arg);
-        GET_CHECK_FILENAME(open64, (path, flags, mode), path, ARG_TYPE_PATH);
-        RECORDER_INTERCEPTOR_PROLOGUE(int, open64, (path, flags, mode));
+        GET_CHECK_TRACKED_FILENAME(open64, (path, flags, mode), path, ARG_TYPE_PATH);
+        RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(int, open64, (path, flags, mode));
         add_to_map(_fname, &res, ARG_TYPE_FD);
         char** args = assemble_args_list(3, _fname, itoa(flags), itoa(mode));
         RECORDER_INTERCEPTOR_EPILOGUE(3, args);
 
     } else {
-        GET_CHECK_FILENAME(open64, (path, flags), path, ARG_TYPE_PATH);
-        RECORDER_INTERCEPTOR_PROLOGUE(int, open64, (path, flags));
+        GET_CHECK_TRACKED_FILENAME(open64, (path, flags), path, ARG_TYPE_PATH);
+        RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(int, open64, (path, flags));
         add_to_map(_fname, &res, ARG_TYPE_FD);
         char** args = assemble_args_list(2, _fname, itoa(flags));
         RECORDER_INTERCEPTOR_EPILOGUE(2, args);
@@ -226,14 +274,57 @@ int WRAPPER_NAME(open)(const char *path, int flags, ...) {
         va_start(arg, flags);
         int mode = va_arg(arg, int);
         va_end(arg);
-        GET_CHECK_FILENAME(open, (path, flags, mode), path, ARG_TYPE_PATH);
-        RECORDER_INTERCEPTOR_PROLOGUE(int, open, (path, flags, mode));
+        GET_CHECK_TRACKED_FILENAME(open, (path, flags, mode), path, ARG_TYPE_PATH);
+        RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(int, open, (path, flags, mode));
         add_to_map(_fname, &res, ARG_TYPE_FD);
         char** args = assemble_args_list(3, _fname, itoa(flags), itoa(mode));
         RECORDER_INTERCEPTOR_EPILOGUE(3, args);
     } else {
-        GET_CHECK_FILENAME(open, (path, flags), path, ARG_TYPE_PATH);
-        RECORDER_INTERCEPTOR_PROLOGUE(int, open, (path, flags));
+        GET_CHECK_TRACKED_FILENAME(open, (path, flags), path, ARG_TYPE_PATH);
+        RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(int, open, (path, flags));
+        add_to_map(_fname, &res, ARG_TYPE_FD);
+        char** args = assemble_args_list(2, _fname, itoa(flags));
+        RECORDER_INTERCEPTOR_EPILOGUE(2, args);
+    }
+}
+
+/*
+ * Recorded like open(), with the path resolved against dirfd
+ */
+int WRAPPER_NAME(openat)(int dirfd, const char *path, int flags, ...) {
+    if (flags & O_CREAT) {
+        va_list arg;
+        va_start(arg, flags);
+        int mode = va_arg(arg, int);
+        va_end(arg);
+        GET_CHECK_TRACKED_AT_FILENAME(openat, (dirfd, path, flags, mode), dirfd, path);
+        RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(int, openat, (dirfd, path, flags, mode));
+        add_to_map(_fname, &res, ARG_TYPE_FD);
+        char** args = assemble_args_list(3, _fname, itoa(flags), itoa(mode));
+        RECORDER_INTERCEPTOR_EPILOGUE(3, args);
+    } else {
+        GET_CHECK_TRACKED_AT_FILENAME(openat, (dirfd, path, flags), dirfd, path);
+        RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(int, openat, (dirfd, path, flags));
+        add_to_map(_fname, &res, ARG_TYPE_FD);
+        char** args = assemble_args_list(2, _fname, itoa(flags));
+        RECORDER_INTERCEPTOR_EPILOGUE(2, args);
+    }
+}
+
+int WRAPPER_NAME(openat64)(int dirfd, const char *path, int flags, ...) {
+    if (flags & O_CREAT) {
+        va_list arg;
+        va_start(arg, flags);
+        int mode = va_arg(arg, int);
+        va_end(arg);
+        GET_CHECK_TRACKED_AT_FILENAME(openat64, (dirfd, path, flags, mode), dirfd, path);
+        RECORDER_INTERCEPTOR_PROLOGUE_AS_TRACKED(int, openat64, "openat", (dirfd, path, flags, mode));
+        add_to_map(_fname, &res, ARG_TYPE_FD);
+        char** args = assemble_args_list(3, _fname, itoa(flags), itoa(mode));
+        RECORDER_INTERCEPTOR_EPILOGUE(3, args);
+    } else {
+        GET_CHECK_TRACKED_AT_FILENAME(openat64, (dirfd, path, flags), dirfd, path);
+        RECORDER_INTERCEPTOR_PROLOGUE_AS_TRACKED(int, openat64, "openat", (dirfd, path, flags));
         add_to_map(_fname, &res, ARG_TYPE_FD);
         char** args = assemble_args_list(2, _fname, itoa(flags));
         RECORDER_INTERCEPTOR_EPILOGUE(2, args);
@@ -241,16 +332,16 @@ int WRAPPER_NAME(open)(const char *path, int flags, ...) {
 }
 
 FILE* WRAPPER_NAME(fopen64)(const char *path, const char *mode) {
-    GET_CHECK_FILENAME(fopen64, (path, mode), path, ARG_TYPE_PATH);
-    RECORDER_INTERCEPTOR_PROLOGUE(FILE*, fopen64, (path, mode));
+    GET_CHECK_TRACKED_FILENAME(fopen64, (path, mode), path, ARG_TYPE_PATH);
+    RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(FILE*, fopen64, (path, mode));
     add_to_map(_fname, res, ARG_TYPE_STREAM);
     char** args = assemble_args_list(2, _fname, strdup(mode));
     RECORDER_INTERCEPTOR_EPILOGUE(2, args);
 }
 
 FILE* WRAPPER_NAME(fopen)(const char *path, const char *mode) {
-    GET_CHECK_FILENAME(fopen, (path, mode), path, ARG_TYPE_PATH);
-    RECORDER_INTERCEPTOR_PROLOGUE(FILE*, fopen, (path, mode))
+    GET_CHECK_TRACKED_FILENAME(fopen, (path, mode), path, ARG_TYPE_PATH);
+    RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(FILE*, fopen, (path, mode))
     add_to_map(_fname, res, ARG_TYPE_STREAM);
     char** args = assemble_args_list(2, realrealpath(path), strdup(mode));
     RECORDER_INTERCEPTOR_EPILOGUE(2, args);
@@ -327,12 +418,86 @@ int WRAPPER_NAME(__fxstat64)(int vers, int fd, struct stat64 *buf) {
 }
 #endif
 
+/*
+ * As of glibc-2.33, stat(), lstat(), fstat() and fstatat() are
+ * regular functions of libc, so we hook them directly.
+ *
+ * The LFS variants (stat64, preadv64, openat64, ...) take the
+ * same arguments, only with wider types, so they are recorded
+ * as the base function. Which one a call resolves to depends
+ * on _FILE_OFFSET_BITS, so one name keeps the signatures of
+ * the same I/O comparable across builds.
+ */
+#if __GLIBC__ == 2 && __GLIBC_MINOR__ >= 33
+int WRAPPER_NAME(stat)(const char *path, struct stat *buf) {
+    GET_CHECK_FILENAME(stat, (path, buf), path, ARG_TYPE_PATH);
+    RECORDER_INTERCEPTOR_PROLOGUE(int, stat, (path, buf));
+    char** args = assemble_args_list(2, _fname, ptoa(buf));
+    RECORDER_INTERCEPTOR_EPILOGUE(2, args);
+}
+
+int WRAPPER_NAME(stat64)(const char *path, struct stat64 *buf) {
+    GET_CHECK_FILENAME(stat64, (path, buf), path, ARG_TYPE_PATH);
+    RECORDER_INTERCEPTOR_PROLOGUE_AS(int, stat64, "stat", (path, buf));
+    char** args = assemble_args_list(2, _fname, ptoa(buf));
+    RECORDER_INTERCEPTOR_EPILOGUE(2, args);
+}
+
+int WRAPPER_NAME(lstat)(const char *path, struct stat *buf) {
+    GET_CHECK_FILENAME(lstat, (path, buf), path, ARG_TYPE_PATH);
+    RECORDER_INTERCEPTOR_PROLOGUE(int, lstat, (path, buf));
+    char** args = assemble_args_list(2, _fname, ptoa(buf));
+    RECORDER_INTERCEPTOR_EPILOGUE(2, args);
+}
+
+int WRAPPER_NAME(lstat64)(const char *path, struct stat64 *buf) {
+    GET_CHECK_FILENAME(lstat64, (path, buf), path, ARG_TYPE_PATH);
+    RECORDER_INTERCEPTOR_PROLOGUE_AS(int, lstat64, "lstat", (path, buf));
+    char** args = assemble_args_list(2, _fname, ptoa(buf));
+    RECORDER_INTERCEPTOR_EPILOGUE(2, args);
+}
+
+int WRAPPER_NAME(fstat)(int fd, struct stat *buf) {
+    GET_CHECK_FILENAME(fstat, (fd, buf), &fd, ARG_TYPE_FD);
+    RECORDER_INTERCEPTOR_PROLOGUE(int, fstat, (fd, buf));
+    char** args = assemble_args_list(2, _fname, ptoa(buf));
+    RECORDER_INTERCEPTOR_EPILOGUE(2, args);
+}
+
+int WRAPPER_NAME(fstat64)(int fd, struct stat64 *buf) {
+    GET_CHECK_FILENAME(fstat64, (fd, buf), &fd, ARG_TYPE_FD);
+    RECORDER_INTERCEPTOR_PROLOGUE_AS(int, fstat64, "fstat", (fd, buf));
+    char** args = assemble_args_list(2, _fname, ptoa(buf));
+    RECORDER_INTERCEPTOR_EPILOGUE(2, args);
+}
+
+int WRAPPER_NAME(fstatat)(int dirfd, const char *path, struct stat *buf, int flag) {
+    GET_CHECK_AT_FILENAME(fstatat, (dirfd, path, buf, flag), dirfd, path);
+    RECORDER_INTERCEPTOR_PROLOGUE(int, fstatat, (dirfd, path, buf, flag));
+    char** args = assemble_args_list(3, _fname, ptoa(buf), itoa(flag));
+    RECORDER_INTERCEPTOR_EPILOGUE(3, args);
+}
+
+int WRAPPER_NAME(fstatat64)(int dirfd, const char *path, struct stat64 *buf, int flag) {
+    GET_CHECK_AT_FILENAME(fstatat64, (dirfd, path, buf, flag), dirfd, path);
+    RECORDER_INTERCEPTOR_PROLOGUE_AS(int, fstatat64, "fstatat", (dirfd, path, buf, flag));
+    char** args = assemble_args_list(3, _fname, ptoa(buf), itoa(flag));
+    RECORDER_INTERCEPTOR_EPILOGUE(3, args);
+}
+#endif
+
+#ifdef HAVE_STATX
+int WRAPPER_NAME(statx)(int dirfd, const char *path, int flags, unsigned int mask, struct statx *buf) {
+    GET_CHECK_AT_FILENAME(statx, (dirfd, path, flags, mask, buf), dirfd, path);
+    RECORDER_INTERCEPTOR_PROLOGUE(int, statx, (dirfd, path, flags, mask, buf));
+    char** args = assemble_args_list(4, _fname, itoa(flags), itoa(mask), ptoa(buf));
+    RECORDER_INTERCEPTOR_EPILOGUE(4, args);
+}
+#endif
+
 ssize_t WRAPPER_NAME(pread64)(int fd, void *buf, size_t count, off64_t offset) {
     GET_CHECK_FILENAME(pread64, (fd, buf, count, offset), &fd, ARG_TYPE_FD);
     RECORDER_INTERCEPTOR_PROLOGUE(ssize_t, pread64, (fd, buf, count, offset));
-    off64_t stored_offset = offset;
-    if (logger_intraprocess_pattern_recognition())
-        stored_offset = iopr_intraprocess("pread64", (off64_t)offset);
     char** args = assemble_args_list(4, _fname, ptoa(buf), itoa(count), itoa(offset));
     RECORDER_INTERCEPTOR_EPILOGUE(4, args);
 }
@@ -340,9 +505,6 @@ ssize_t WRAPPER_NAME(pread64)(int fd, void *buf, size_t count, off64_t offset) {
 ssize_t WRAPPER_NAME(pread)(int fd, void *buf, size_t count, off_t offset) {
     GET_CHECK_FILENAME(pread, (fd, buf, count, offset), &fd, ARG_TYPE_FD);
     RECORDER_INTERCEPTOR_PROLOGUE(ssize_t, pread, (fd, buf, count, offset));
-    off64_t stored_offset = (off64_t) offset;
-    if (logger_intraprocess_pattern_recognition())
-        stored_offset = iopr_intraprocess("pread", (off64_t)offset);
     char** args = assemble_args_list(4, _fname, ptoa(buf), itoa(count), itoa(offset));
     RECORDER_INTERCEPTOR_EPILOGUE(4, args);
 }
@@ -350,19 +512,13 @@ ssize_t WRAPPER_NAME(pread)(int fd, void *buf, size_t count, off_t offset) {
 ssize_t WRAPPER_NAME(pwrite64)(int fd, const void *buf, size_t count, off64_t offset) {
     GET_CHECK_FILENAME(pwrite64, (fd, buf, count, offset), &fd, ARG_TYPE_FD);
     RECORDER_INTERCEPTOR_PROLOGUE(ssize_t, pwrite64, (fd, buf, count, offset));
-    off64_t stored_offset = (off64_t) offset;
-    if (logger_intraprocess_pattern_recognition())
-        stored_offset = iopr_intraprocess("pwrite64", (off64_t)offset);
-    char** args = assemble_args_list(4, _fname, ptoa(buf), itoa(count), itoa(stored_offset));
+    char** args = assemble_args_list(4, _fname, ptoa(buf), itoa(count), itoa(offset));
     RECORDER_INTERCEPTOR_EPILOGUE(4, args);
 }
 ssize_t WRAPPER_NAME(pwrite)(int fd, const void *buf, size_t count, off_t offset) {
     GET_CHECK_FILENAME(pwrite, (fd, buf, count, offset), &fd, ARG_TYPE_FD);
     RECORDER_INTERCEPTOR_PROLOGUE(ssize_t, pwrite, (fd, buf, count, offset));
-    off64_t stored_offset = (off64_t) offset;
-    if (logger_intraprocess_pattern_recognition())
-        stored_offset = iopr_intraprocess("pwrite", (off64_t)offset);
-    char** args = assemble_args_list(4, _fname, ptoa(buf), itoa(count), itoa(stored_offset));
+    char** args = assemble_args_list(4, _fname, ptoa(buf), itoa(count), itoa(offset));
     RECORDER_INTERCEPTOR_EPILOGUE(4, args);
 }
 
@@ -390,6 +546,116 @@ ssize_t WRAPPER_NAME(writev)(int fd, const struct iovec *iov, int iovcnt) {
     RECORDER_INTERCEPTOR_EPILOGUE(3, args);
 }
 
+static inline off64_t iov_total(const struct iovec *iov, int iovcnt) {
+    off64_t total = 0;
+    for(int i = 0; i < iovcnt; i++)
+        total += iov[i].iov_len;
+    return total;
+}
+
+/*
+ * Same arguments as readv/writev, followed by the offset
+ * (and flags for preadv2/pwritev2)
+ */
+ssize_t WRAPPER_NAME(preadv)(int fd, const struct iovec *iov, int iovcnt, off_t offset) {
+    GET_CHECK_FILENAME(preadv, (fd, iov, iovcnt, offset), &fd, ARG_TYPE_FD);
+    off64_t total = iov_total(iov, iovcnt);
+    RECORDER_INTERCEPTOR_PROLOGUE(ssize_t, preadv, (fd, iov, iovcnt, offset));
+    char** args = assemble_args_list(4, _fname, itoa(total), itoa(iovcnt), itoa(offset));
+    RECORDER_INTERCEPTOR_EPILOGUE(4, args);
+}
+
+ssize_t WRAPPER_NAME(preadv64)(int fd, const struct iovec *iov, int iovcnt, off64_t offset) {
+    GET_CHECK_FILENAME(preadv64, (fd, iov, iovcnt, offset), &fd, ARG_TYPE_FD);
+    off64_t total = iov_total(iov, iovcnt);
+    RECORDER_INTERCEPTOR_PROLOGUE_AS(ssize_t, preadv64, "preadv", (fd, iov, iovcnt, offset));
+    char** args = assemble_args_list(4, _fname, itoa(total), itoa(iovcnt), itoa(offset));
+    RECORDER_INTERCEPTOR_EPILOGUE(4, args);
+}
+
+ssize_t WRAPPER_NAME(pwritev)(int fd, const struct iovec *iov, int iovcnt, off_t offset) {
+    GET_CHECK_FILENAME(pwritev, (fd, iov, iovcnt, offset), &fd, ARG_TYPE_FD);
+    off64_t total = iov_total(iov, iovcnt);
+    RECORDER_INTERCEPTOR_PROLOGUE(ssize_t, pwritev, (fd, iov, iovcnt, offset));
+    char** args = assemble_args_list(4, _fname, itoa(total), itoa(iovcnt), itoa(offset));
+    RECORDER_INTERCEPTOR_EPILOGUE(4, args);
+}
+
+ssize_t WRAPPER_NAME(pwritev64)(int fd, const struct iovec *iov, int iovcnt, off64_t offset) {
+    GET_CHECK_FILENAME(pwritev64, (fd, iov, iovcnt, offset), &fd, ARG_TYPE_FD);
+    off64_t total = iov_total(iov, iovcnt);
+    RECORDER_INTERCEPTOR_PROLOGUE_AS(ssize_t, pwritev64, "pwritev", (fd, iov, iovcnt, offset));
+    char** args = assemble_args_list(4, _fname, itoa(total), itoa(iovcnt), itoa(offset));
+    RECORDER_INTERCEPTOR_EPILOGUE(4, args);
+}
+
+#ifdef HAVE_PREADV2
+ssize_t WRAPPER_NAME(preadv2)(int fd, const struct iovec *iov, int iovcnt, off_t offset, int flags) {
+    GET_CHECK_FILENAME(preadv2, (fd, iov, iovcnt, offset, flags), &fd, ARG_TYPE_FD);
+    off64_t total = iov_total(iov, iovcnt);
+    RECORDER_INTERCEPTOR_PROLOGUE(ssize_t, preadv2, (fd, iov, iovcnt, offset, flags));
+    char** args = assemble_args_list(5, _fname, itoa(total), itoa(iovcnt), itoa(offset), itoa(flags));
+    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
+}
+
+ssize_t WRAPPER_NAME(preadv64v2)(int fd, const struct iovec *iov, int iovcnt, off64_t offset, int flags) {
+    GET_CHECK_FILENAME(preadv64v2, (fd, iov, iovcnt, offset, flags), &fd, ARG_TYPE_FD);
+    off64_t total = iov_total(iov, iovcnt);
+    RECORDER_INTERCEPTOR_PROLOGUE_AS(ssize_t, preadv64v2, "preadv2", (fd, iov, iovcnt, offset, flags));
+    char** args = assemble_args_list(5, _fname, itoa(total), itoa(iovcnt), itoa(offset), itoa(flags));
+    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
+}
+
+ssize_t WRAPPER_NAME(pwritev2)(int fd, const struct iovec *iov, int iovcnt, off_t offset, int flags) {
+    GET_CHECK_FILENAME(pwritev2, (fd, iov, iovcnt, offset, flags), &fd, ARG_TYPE_FD);
+    off64_t total = iov_total(iov, iovcnt);
+    RECORDER_INTERCEPTOR_PROLOGUE(ssize_t, pwritev2, (fd, iov, iovcnt, offset, flags));
+    char** args = assemble_args_list(5, _fname, itoa(total), itoa(iovcnt), itoa(offset), itoa(flags));
+    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
+}
+
+ssize_t WRAPPER_NAME(pwritev64v2)(int fd, const struct iovec *iov, int iovcnt, off64_t offset, int flags) {
+    GET_CHECK_FILENAME(pwritev64v2, (fd, iov, iovcnt, offset, flags), &fd, ARG_TYPE_FD);
+    off64_t total = iov_total(iov, iovcnt);
+    RECORDER_INTERCEPTOR_PROLOGUE_AS(ssize_t, pwritev64v2, "pwritev2", (fd, iov, iovcnt, offset, flags));
+    char** args = assemble_args_list(5, _fname, itoa(total), itoa(iovcnt), itoa(offset), itoa(flags));
+    RECORDER_INTERCEPTOR_EPILOGUE(5, args);
+}
+#endif
+
+#ifdef HAVE_COPY_FILE_RANGE
+/*
+ * Offsets are "NULL" if the file offset of the fd is used.
+ * fd_out is kept as is if we do not know its file.
+ */
+ssize_t WRAPPER_NAME(copy_file_range)(int fd_in, off64_t *off_in, int fd_out, off64_t *off_out, size_t len, unsigned int flags) {
+    GET_CHECK_FILENAME(copy_file_range, (fd_in, off_in, fd_out, off_out, len, flags), &fd_in, ARG_TYPE_FD);
+    // both are advanced by the call
+    char* off_in_str  = off_in  ? itoa(*off_in)  : strdup("NULL");
+    char* off_out_str = off_out ? itoa(*off_out) : strdup("NULL");
+    char* out_fname = fd2name(fd_out);
+    if(out_fname == NULL)
+        out_fname = itoa(fd_out);
+    RECORDER_INTERCEPTOR_PROLOGUE(ssize_t, copy_file_range, (fd_in, off_in, fd_out, off_out, len, flags));
+    char** args = assemble_args_list(6, _fname, off_in_str, out_fname, off_out_str, itoa(len), itoa(flags));
+    RECORDER_INTERCEPTOR_EPILOGUE(6, args);
+}
+#endif
+
+int WRAPPER_NAME(posix_fadvise)(int fd, off_t offset, off_t len, int advice) {
+    GET_CHECK_FILENAME(posix_fadvise, (fd, offset, len, advice), &fd, ARG_TYPE_FD);
+    RECORDER_INTERCEPTOR_PROLOGUE(int, posix_fadvise, (fd, offset, len, advice));
+    char** args = assemble_args_list(4, _fname, itoa(offset), itoa(len), itoa(advice));
+    RECORDER_INTERCEPTOR_EPILOGUE(4, args);
+}
+
+int WRAPPER_NAME(posix_fadvise64)(int fd, off64_t offset, off64_t len, int advice) {
+    GET_CHECK_FILENAME(posix_fadvise64, (fd, offset, len, advice), &fd, ARG_TYPE_FD);
+    RECORDER_INTERCEPTOR_PROLOGUE_AS(int, posix_fadvise64, "posix_fadvise", (fd, offset, len, advice));
+    char** args = assemble_args_list(4, _fname, itoa(offset), itoa(len), itoa(advice));
+    RECORDER_INTERCEPTOR_EPILOGUE(4, args);
+}
+
 size_t WRAPPER_NAME(fread)(void *ptr, size_t size, size_t nmemb, FILE *stream) {
     GET_CHECK_FILENAME(fread, (ptr, size, nmemb, stream), stream, ARG_TYPE_STREAM);
     RECORDER_INTERCEPTOR_PROLOGUE(size_t, fread, (ptr, size, nmemb, stream));
@@ -453,20 +719,14 @@ long WRAPPER_NAME(ftell)(FILE *stream) {
 off64_t WRAPPER_NAME(lseek64)(int fd, off64_t offset, int whence) {
     GET_CHECK_FILENAME(lseek64, (fd, offset, whence), &fd, ARG_TYPE_FD);
     RECORDER_INTERCEPTOR_PROLOGUE(off64_t, lseek64, (fd, offset, whence));
-    off64_t stored_offset = (off64_t) offset;
-    if (logger_intraprocess_pattern_recognition())
-        stored_offset = iopr_intraprocess("lseek64", (off64_t)offset);
-    char** args = assemble_args_list(3, _fname, itoa(stored_offset), itoa(whence));
+    char** args = assemble_args_list(3, _fname, itoa(offset), itoa(whence));
     RECORDER_INTERCEPTOR_EPILOGUE(3, args);
 }
 
 off_t WRAPPER_NAME(lseek)(int fd, off_t offset, int whence) {
     GET_CHECK_FILENAME(lseek, (fd, offset, whence), &fd, ARG_TYPE_FD);
     RECORDER_INTERCEPTOR_PROLOGUE(off_t, lseek, (fd, offset, whence));
-    off64_t stored_offset = (off64_t) offset;
-    if (logger_intraprocess_pattern_recognition())
-        stored_offset = iopr_intraprocess("lseek", (off64_t)offset);
-    char** args = assemble_args_list(3, _fname, itoa(stored_offset), itoa(whence));
+    char** args = assemble_args_list(3, _fname, itoa(offset), itoa(whence));
     RECORDER_INTERCEPTOR_EPILOGUE(3, args);
 }
 
@@ -643,15 +903,15 @@ int WRAPPER_NAME(fcntl)(int fd, int cmd, ...) {
 #endif
 
 int WRAPPER_NAME(dup)(int oldfd) {
-    GET_CHECK_FILENAME(dup, (oldfd), &oldfd, ARG_TYPE_FD);
-    RECORDER_INTERCEPTOR_PROLOGUE(int, dup, (oldfd));
+    GET_CHECK_TRACKED_FILENAME(dup, (oldfd), &oldfd, ARG_TYPE_FD);
+    RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(int, dup, (oldfd));
     add_to_map(_fname, &res, ARG_TYPE_FD);
     char** args = assemble_args_list(1, itoa(oldfd));
     RECORDER_INTERCEPTOR_EPILOGUE(1, args);
 }
 int WRAPPER_NAME(dup2)(int oldfd, int newfd) {
-    GET_CHECK_FILENAME(dup2, (oldfd, newfd), &oldfd, ARG_TYPE_FD);
-    RECORDER_INTERCEPTOR_PROLOGUE(int, dup2, (oldfd, newfd));
+    GET_CHECK_TRACKED_FILENAME(dup2, (oldfd, newfd), &oldfd, ARG_TYPE_FD);
+    RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(int, dup2, (oldfd, newfd));
     add_to_map(_fname, &res, ARG_TYPE_FD);
     char** args = assemble_args_list(2, itoa(oldfd), itoa(newfd));
     RECORDER_INTERCEPTOR_EPILOGUE(2, args);
@@ -675,8 +935,8 @@ mode_t WRAPPER_NAME(umask)(mode_t mask) {
 }
 
 FILE* WRAPPER_NAME(fdopen)(int fd, const char *mode) {
-    GET_CHECK_FILENAME(fdopen, (fd, mode), &fd, ARG_TYPE_FD);
-    RECORDER_INTERCEPTOR_PROLOGUE(FILE*, fdopen, (fd, mode));
+    GET_CHECK_TRACKED_FILENAME(fdopen, (fd, mode), &fd, ARG_TYPE_FD);
+    RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(FILE*, fdopen, (fd, mode));
     add_to_map(_fname, res, ARG_TYPE_STREAM);
     char** args = assemble_args_list(2, _fname, strdup(mode));
     RECORDER_INTERCEPTOR_EPILOGUE(2, args);
@@ -743,3 +1003,447 @@ int WRAPPER_NAME(fflush)(FILE *stream) {
     char** args = assemble_args_list(1, _fname);
     RECORDER_INTERCEPTOR_EPILOGUE(1, args)
 }
+
+
+/*
+ * Asynchronous I/O: POSIX AIO and io_uring
+ *
+ * These are bound by their own GOTCHA layer (see
+ * RECORDER_ASYNC_TRACING), so a wrapper is only
+ * called if the layer is on.
+ */
+#define GET_CHECK_ASYNC_FILENAME(func, func_args, fd)               \
+    char* _fname = logger_tracing() ? fd2name(fd) : NULL;           \
+    if(_fname == NULL || !accept_filename(_fname)) {                \
+        if(_fname) free(_fname);                                    \
+        GOTCHA_SET_REAL_CALL_NOCHECK(func);                         \
+        return GOTCHA_REAL_CALL(func) func_args;                    \
+    }
+
+/*
+ * aio_read/aio_write record the file, offset, byte count
+ * and the aiocb, which identifies the request until
+ * aio_return() collects its result.
+ */
+int WRAPPER_NAME(aio_read)(struct aiocb *aiocbp) {
+    GET_CHECK_ASYNC_FILENAME(aio_read, (aiocbp), aiocbp->aio_fildes);
+    RECORDER_INTERCEPTOR_PROLOGUE(int, aio_read, (aiocbp));
+    char** args = assemble_args_list(4, _fname, itoa(aiocbp->aio_offset), itoa(aiocbp->aio_nbytes), itoa((intptr_t)aiocbp));
+    RECORDER_INTERCEPTOR_EPILOGUE(4, args);
+}
+
+int WRAPPER_NAME(aio_read64)(struct aiocb64 *aiocbp) {
+    GET_CHECK_ASYNC_FILENAME(aio_read64, (aiocbp), aiocbp->aio_fildes);
+    RECORDER_INTERCEPTOR_PROLOGUE_AS(int, aio_read64, "aio_read", (aiocbp));
+    char** args = assemble_args_list(4, _fname, itoa(aiocbp->aio_offset), itoa(aiocbp->aio_nbytes), itoa((intptr_t)aiocbp));
+    RECORDER_INTERCEPTOR_EPILOGUE(4, args);
+}
+
+int WRAPPER_NAME(aio_write)(struct aiocb *aiocbp) {
+    GET_CHECK_ASYNC_FILENAME(aio_write, (aiocbp), aiocbp->aio_fildes);
+    RECORDER_INTERCEPTOR_PROLOGUE(int, aio_write, (aiocbp));
+    char** args = assemble_args_list(4, _fname, itoa(aiocbp->aio_offset), itoa(aiocbp->aio_nbytes), itoa((intptr_t)aiocbp));
+    RECORDER_INTERCEPTOR_EPILOGUE(4, args);
+}
+
+int WRAPPER_NAME(aio_write64)(struct aiocb64 *aiocbp) {
+    GET_CHECK_ASYNC_FILENAME(aio_write64, (aiocbp), aiocbp->aio_fildes);
+    RECORDER_INTERCEPTOR_PROLOGUE_AS(int, aio_write64, "aio_write", (aiocbp));
+    char** args = assemble_args_list(4, _fname, itoa(aiocbp->aio_offset), itoa(aiocbp->aio_nbytes), itoa((intptr_t)aiocbp));
+    RECORDER_INTERCEPTOR_EPILOGUE(4, args);
+}
+
+ssize_t WRAPPER_NAME(aio_return)(struct aiocb *aiocbp) {
+    GET_CHECK_ASYNC_FILENAME(aio_return, (aiocbp), aiocbp->aio_fildes);
+    RECORDER_INTERCEPTOR_PROLOGUE(ssize_t, aio_return, (aiocbp));
+    char** args = assemble_args_list(2, _fname, itoa((intptr_t)aiocbp));
+    RECORDER_INTERCEPTOR_EPILOGUE(2, args);
+}
+
+ssize_t WRAPPER_NAME(aio_return64)(struct aiocb64 *aiocbp) {
+    GET_CHECK_ASYNC_FILENAME(aio_return64, (aiocbp), aiocbp->aio_fildes);
+    RECORDER_INTERCEPTOR_PROLOGUE_AS(ssize_t, aio_return64, "aio_return", (aiocbp));
+    char** args = assemble_args_list(2, _fname, itoa((intptr_t)aiocbp));
+    RECORDER_INTERCEPTOR_EPILOGUE(2, args);
+}
+
+/*
+ * "[a,b,...]" of the aiocbs on files we trace, NULL if there
+ * is none. Only aio_fildes is read, which comes first in both
+ * struct aiocb and struct aiocb64.
+ */
+static char* traced_aiocbs(const struct aiocb *const aiocb_list[], int nitems) {
+    char* str = NULL;
+    int pos = 0;
+    for(int i = 0; i < nitems; i++) {
+        if(aiocb_list[i] == NULL)
+            continue;
+        char* name = fd2name(aiocb_list[i]->aio_fildes);
+        if(name == NULL)
+            continue;
+        int accept = accept_filename(name);
+        free(name);
+        if(!accept)
+            continue;
+        if(str == NULL)
+            str = calloc(24*nitems + 3, sizeof(char));
+        pos += sprintf(str+pos, "%c%lld", pos ? ',' : '[', (long long)(intptr_t)aiocb_list[i]);
+    }
+    if(str)
+        str[pos] = ']';
+    return str;
+}
+
+static char* timespec2a(const struct timespec *ts) {
+    return ts ? ftoa(ts->tv_sec + ts->tv_nsec / 1e9) : strdup("NULL");
+}
+
+int WRAPPER_NAME(aio_suspend)(const struct aiocb *const aiocb_list[], int nitems, const struct timespec *timeout) {
+    char* aiocbs = logger_tracing() ? traced_aiocbs(aiocb_list, nitems) : NULL;
+    if(aiocbs == NULL) {
+        GOTCHA_SET_REAL_CALL_NOCHECK(aio_suspend);
+        return GOTCHA_REAL_CALL(aio_suspend) (aiocb_list, nitems, timeout);
+    }
+    RECORDER_INTERCEPTOR_PROLOGUE(int, aio_suspend, (aiocb_list, nitems, timeout));
+    char** args = assemble_args_list(3, aiocbs, itoa(nitems), timespec2a(timeout));
+    RECORDER_INTERCEPTOR_EPILOGUE(3, args);
+}
+
+int WRAPPER_NAME(aio_suspend64)(const struct aiocb64 *const aiocb_list[], int nitems, const struct timespec *timeout) {
+    char* aiocbs = logger_tracing() ? traced_aiocbs((const struct aiocb *const *)aiocb_list, nitems) : NULL;
+    if(aiocbs == NULL) {
+        GOTCHA_SET_REAL_CALL_NOCHECK(aio_suspend64);
+        return GOTCHA_REAL_CALL(aio_suspend64) (aiocb_list, nitems, timeout);
+    }
+    RECORDER_INTERCEPTOR_PROLOGUE_AS(int, aio_suspend64, "aio_suspend", (aiocb_list, nitems, timeout));
+    char** args = assemble_args_list(3, aiocbs, itoa(nitems), timespec2a(timeout));
+    RECORDER_INTERCEPTOR_EPILOGUE(3, args);
+}
+
+
+#ifdef HAVE_LIBURING
+/*
+ * io_uring
+ *
+ * io_uring_submit() is recorded once for all SQEs it submits,
+ * with one "[a,b,...]" vector per field, so a batch of 64
+ * SQEs costs one record. The SQEs are read from the ring
+ * before the real call, which hands them to the kernel.
+ *
+ * SQEs on files we trace stay in uring_requests until a
+ * wait/peek call returns their CQE, which then is written as
+ * one io_uring_complete record (like MPI_File_request_complete).
+ * The reader moves its tstart back to the submitting call.
+ * CQEs consumed only by the inline io_uring_peek_cqe() or
+ * io_uring_for_each_cqe() are not seen.
+ */
+typedef struct uring_request {
+    struct {
+        struct io_uring* ring;
+        uint64_t user_data;
+    } key;
+    char* fname;
+    int   op;
+    int   pending;          // submitted with this user_data and not completed yet
+    UT_hash_handle hh;
+} uring_request_t;
+
+static uring_request_t* uring_requests = NULL;
+static pthread_mutex_t  uring_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// One traced SQE
+typedef struct uring_sqe_info {
+    int      sqe_idx;       // position in the batch
+    int      file;          // index into the file list of the batch
+    int      op;
+    int64_t  offset;        // -1: the file position
+    uint64_t bytes;         // iovec total for IORING_OP_READV/WRITEV
+    uint64_t user_data;
+} uring_sqe_info_t;
+
+typedef struct uring_batch {
+    int count;              // traced SQEs
+    int num_files;
+    char** files;
+    uring_sqe_info_t* sqes;
+} uring_batch_t;
+
+static inline struct io_uring_sqe* uring_pending_sqe(struct io_uring *ring, unsigned i) {
+    unsigned shift = 0;
+#ifdef IORING_SETUP_SQE128
+    if(ring->flags & IORING_SETUP_SQE128)
+        shift = 1;
+#endif
+    return &ring->sq.sqes[(i & *ring->sq.kring_mask) << shift];
+}
+
+/*
+ * Collect the SQEs not submitted yet. Returns false if
+ * none of them is on a file we trace.
+ */
+static bool uring_collect_batch(struct io_uring *ring, uring_batch_t *batch) {
+    unsigned head = ring->sq.sqe_head, tail = ring->sq.sqe_tail;
+    unsigned n = tail - head;
+    memset(batch, 0, sizeof(uring_batch_t));
+    if(n == 0)
+        return false;
+
+    batch->sqes = malloc(sizeof(uring_sqe_info_t) * n);
+    batch->files = NULL;
+    int last_fd = -1, last_file = -1;
+
+    for(unsigned i = 0; i < n; i++) {
+        struct io_uring_sqe *sqe = uring_pending_sqe(ring, head+i);
+        if(sqe->fd < 0 || (sqe->flags & IOSQE_FIXED_FILE))
+            continue;
+
+        // a batch usually targets a few files, look
+        // up only when the fd changes
+        if(sqe->fd != last_fd) {
+            last_fd = sqe->fd;
+            last_file = -1;
+            char* name = fd2name(sqe->fd);
+            if(name && accept_filename(name)) {
+                for(int f = 0; f < batch->num_files && last_file == -1; f++)
+                    if(strcmp(batch->files[f], name) == 0)
+                        last_file = f;
+                if(last_file == -1) {
+                    batch->files = realloc(batch->files, sizeof(char*) * (batch->num_files+1));
+                    batch->files[batch->num_files] = name;
+                    last_file = batch->num_files++;
+                    name = NULL;
+                }
+            }
+            free(name);
+        }
+        if(last_file == -1)
+            continue;
+
+        uring_sqe_info_t *info = &batch->sqes[batch->count++];
+        info->sqe_idx = i;
+        info->file = last_file;
+        info->op = sqe->opcode;
+        info->offset = (int64_t) sqe->off;
+        info->bytes = sqe->len;
+        if(sqe->opcode == IORING_OP_READV || sqe->opcode == IORING_OP_WRITEV)
+            info->bytes = iov_total((const struct iovec*)(uintptr_t)sqe->addr, sqe->len);
+        info->user_data = sqe->user_data;
+    }
+
+    if(batch->count == 0) {
+        free(batch->sqes);
+        return false;
+    }
+    return true;
+}
+
+static char* uring_files2a(uring_batch_t *batch) {
+    size_t len = 3;
+    for(int f = 0; f < batch->num_files; f++)
+        len += strlen(batch->files[f]) + 1;
+    char* str = calloc(len, sizeof(char));
+    int pos = 0;
+    for(int f = 0; f < batch->num_files; f++)
+        pos += sprintf(str+pos, "%c%s", f ? ',' : '[', batch->files[f]);
+    str[pos] = ']';
+    return str;
+}
+
+#define URING_FIELD_FILE      0
+#define URING_FIELD_OP        1
+#define URING_FIELD_OFFSET    2
+#define URING_FIELD_BYTES     3
+#define URING_FIELD_USER_DATA 4
+
+static char* uring_field2a(uring_batch_t *batch, int field) {
+    char* str = calloc(24*batch->count + 3, sizeof(char));
+    int pos = 0;
+    for(int i = 0; i < batch->count; i++) {
+        uring_sqe_info_t *info = &batch->sqes[i];
+        str[pos++] = i ? ',' : '[';
+        switch(field) {
+            case URING_FIELD_FILE:      pos += sprintf(str+pos, "%d", info->file); break;
+            case URING_FIELD_OP:        pos += sprintf(str+pos, "%d", info->op); break;
+            case URING_FIELD_OFFSET:    pos += sprintf(str+pos, "%lld", (long long)info->offset); break;
+            case URING_FIELD_BYTES:     pos += sprintf(str+pos, "%llu", (unsigned long long)info->bytes); break;
+            case URING_FIELD_USER_DATA: pos += sprintf(str+pos, "%llu", (unsigned long long)info->user_data); break;
+        }
+    }
+    str[pos] = ']';
+    return str;
+}
+
+/*
+ * Remember the SQEs the kernel accepted, i.e.,
+ * the first submitted ones of the batch.
+ */
+static void uring_add_requests(struct io_uring *ring, uring_batch_t *batch, int submitted) {
+    pthread_mutex_lock(&uring_mutex);
+    for(int i = 0; i < batch->count && batch->sqes[i].sqe_idx < submitted; i++) {
+        uring_sqe_info_t *info = &batch->sqes[i];
+        uring_request_t *entry = NULL, key;
+        memset(&key.key, 0, sizeof(key.key));
+        key.key.ring = ring;
+        key.key.user_data = info->user_data;
+        HASH_FIND(hh, uring_requests, &key.key, sizeof(key.key), entry);
+        if(!entry) {
+            entry = malloc(sizeof(uring_request_t));
+            memset(entry, 0, sizeof(uring_request_t));
+            entry->key = key.key;
+            entry->fname = strdup(batch->files[info->file]);
+            entry->op = info->op;
+            HASH_ADD(hh, uring_requests, key, sizeof(entry->key), entry);
+        }
+        entry->pending++;
+    }
+    pthread_mutex_unlock(&uring_mutex);
+}
+
+static char** uring_batch_args(struct io_uring *ring, uring_batch_t *batch, int arg_count, unsigned wait_nr) {
+    char** args = assemble_args_list(arg_count, ptoa(ring), uring_files2a(batch),
+                                     uring_field2a(batch, URING_FIELD_FILE),
+                                     uring_field2a(batch, URING_FIELD_OP),
+                                     uring_field2a(batch, URING_FIELD_OFFSET),
+                                     uring_field2a(batch, URING_FIELD_BYTES),
+                                     uring_field2a(batch, URING_FIELD_USER_DATA),
+                                     arg_count > 7 ? itoa(wait_nr) : NULL);
+    for(int f = 0; f < batch->num_files; f++)
+        free(batch->files[f]);
+    free(batch->files);
+    free(batch->sqes);
+    return args;
+}
+
+/*
+ * io_uring_submit(ring, files, file index, op, offset, bytes, user_data)
+ * io_uring_submit_and_wait(the same, wait_nr)
+ *
+ * All but ring and files are vectors over the traced SQEs,
+ * op is the IORING_OP_* code.
+ */
+int WRAPPER_NAME(io_uring_submit)(struct io_uring *ring) {
+    uring_batch_t batch;
+    if(!logger_tracing() || !uring_collect_batch(ring, &batch)) {
+        GOTCHA_SET_REAL_CALL_NOCHECK(io_uring_submit);
+        return GOTCHA_REAL_CALL(io_uring_submit) (ring);
+    }
+    RECORDER_INTERCEPTOR_PROLOGUE(int, io_uring_submit, (ring));
+    if(res > 0)
+        uring_add_requests(ring, &batch, res);
+    char** args = uring_batch_args(ring, &batch, 7, 0);
+    RECORDER_INTERCEPTOR_EPILOGUE(7, args);
+}
+
+int WRAPPER_NAME(io_uring_submit_and_wait)(struct io_uring *ring, unsigned wait_nr) {
+    uring_batch_t batch;
+    if(!logger_tracing() || !uring_collect_batch(ring, &batch)) {
+        GOTCHA_SET_REAL_CALL_NOCHECK(io_uring_submit_and_wait);
+        return GOTCHA_REAL_CALL(io_uring_submit_and_wait) (ring, wait_nr);
+    }
+    RECORDER_INTERCEPTOR_PROLOGUE(int, io_uring_submit_and_wait, (ring, wait_nr));
+    if(res > 0)
+        uring_add_requests(ring, &batch, res);
+    char** args = uring_batch_args(ring, &batch, 8, wait_nr);
+    RECORDER_INTERCEPTOR_EPILOGUE(8, args);
+}
+
+/*
+ * Write an io_uring_complete(file, ring, user_data, op, res)
+ * record if the CQE belongs to an SQE we traced. Its timestamps
+ * are the end of the wait/peek call that returned the CQE.
+ */
+static void uring_complete(Record *wait, struct io_uring *ring, struct io_uring_cqe *cqe) {
+    uring_request_t *entry = NULL, key;
+    memset(&key.key, 0, sizeof(key.key));
+    key.key.ring = ring;
+    key.key.user_data = cqe->user_data;
+
+    pthread_mutex_lock(&uring_mutex);
+    HASH_FIND(hh, uring_requests, &key.key, sizeof(key.key), entry);
+    if(!entry) {
+        pthread_mutex_unlock(&uring_mutex);
+        return;
+    }
+    char* fname = strdup(entry->fname);
+    int op = entry->op;
+    if(--entry->pending == 0) {
+        HASH_DEL(uring_requests, entry);
+        free(entry->fname);
+        free(entry);
+    }
+    pthread_mutex_unlock(&uring_mutex);
+
+    char* user_data = calloc(24, sizeof(char));
+    sprintf(user_data, "%llu", (unsigned long long)cqe->user_data);
+
+    Record *record = recorder_malloc(sizeof(Record));
+    record->func_id = get_function_id_by_name("io_uring_complete");
+    record->tid = wait->tid;
+    logger_record_enter(record);
+    // same level as the wait call, not inside it
+    record->call_depth = wait->call_depth;
+    record->stack_id = wait->stack_id;
+    record->tstart = wait->tend;
+    record->tend = wait->tend;
+    record->res = cqe->res;
+    record->arg_count = 5;
+    record->args = assemble_args_list(5, fname, ptoa(ring), user_data, itoa(op), itoa(cqe->res));
+    logger_record_exit(record);
+}
+
+/*
+ * Nothing to match the CQEs against, no need to record
+ * the wait calls. Read without the lock, the worst case
+ * is one record more or less.
+ */
+#define CHECK_URING_REQUESTS(func, func_args)                       \
+    if(!logger_initialized() || uring_requests == NULL) {           \
+        GOTCHA_SET_REAL_CALL_NOCHECK(func);                         \
+        return GOTCHA_REAL_CALL(func) func_args;                    \
+    }
+
+static char* kernel_timespec2a(struct __kernel_timespec *ts) {
+    return ts ? ftoa(ts->tv_sec + ts->tv_nsec / 1e9) : strdup("NULL");
+}
+
+// called by the inline io_uring_wait_cqe() and io_uring_wait_cqe_nr()
+int WRAPPER_NAME(__io_uring_get_cqe)(struct io_uring *ring, struct io_uring_cqe **cqe_ptr,
+                                     unsigned submit, unsigned wait_nr, sigset_t *sigmask) {
+    CHECK_URING_REQUESTS(__io_uring_get_cqe, (ring, cqe_ptr, submit, wait_nr, sigmask));
+    RECORDER_INTERCEPTOR_PROLOGUE_AS_TRACKED(int, __io_uring_get_cqe, "io_uring_wait_cqe",
+                                     (ring, cqe_ptr, submit, wait_nr, sigmask));
+    if(res == 0 && *cqe_ptr)
+        uring_complete(record, ring, *cqe_ptr);
+    char** args = assemble_args_list(2, ptoa(ring), itoa(wait_nr));
+    RECORDER_INTERCEPTOR_EPILOGUE(2, args);
+}
+
+int WRAPPER_NAME(io_uring_wait_cqes)(struct io_uring *ring, struct io_uring_cqe **cqe_ptr, unsigned wait_nr,
+                                     struct __kernel_timespec *ts, sigset_t *sigmask) {
+    CHECK_URING_REQUESTS(io_uring_wait_cqes, (ring, cqe_ptr, wait_nr, ts, sigmask));
+    RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(int, io_uring_wait_cqes, (ring, cqe_ptr, wait_nr, ts, sigmask));
+    if(res == 0 && *cqe_ptr)
+        uring_complete(record, ring, *cqe_ptr);
+    char** args = assemble_args_list(3, ptoa(ring), itoa(wait_nr), kernel_timespec2a(ts));
+    RECORDER_INTERCEPTOR_EPILOGUE(3, args);
+}
+
+int WRAPPER_NAME(io_uring_wait_cqe_timeout)(struct io_uring *ring, struct io_uring_cqe **cqe_ptr,
+                                            struct __kernel_timespec *ts) {
+    CHECK_URING_REQUESTS(io_uring_wait_cqe_timeout, (ring, cqe_ptr, ts));
+    RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(int, io_uring_wait_cqe_timeout, (ring, cqe_ptr, ts));
+    if(res == 0 && *cqe_ptr)
+        uring_complete(record, ring, *cqe_ptr);
+    char** args = assemble_args_list(2, ptoa(ring), kernel_timespec2a(ts));
+    RECORDER_INTERCEPTOR_EPILOGUE(2, args);
+}
+
+unsigned WRAPPER_NAME(io_uring_peek_batch_cqe)(struct io_uring *ring, struct io_uring_cqe **cqes, unsigned count) {
+    CHECK_URING_REQUESTS(io_uring_peek_batch_cqe, (ring, cqes, count));
+    RECORDER_INTERCEPTOR_PROLOGUE_TRACKED(unsigned, io_uring_peek_batch_cqe, (ring, cqes, count));
+    for(unsigned i = 0; i < res; i++)
+        uring_complete(record, ring, cqes[i]);
+    char** args = assemble_args_list(2, ptoa(ring), itoa(count));
+    RECORDER_INTERCEPTOR_EPILOGUE(2, args);
+}
+#endif
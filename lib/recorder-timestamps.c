@@ -9,12 +9,25 @@ void ts_get_filename(RecorderLogger *logger, char* ts_filename) {
     sprintf(ts_filename, "%s/%d.ts", logger->traces_dir, logger->rank);
 }
 
+/*
+ * The value stream, if any, follows the timestamps: as a second
+ * zlib block, or uncompressed with its size in bytes at the very end.
+ */
 void ts_write_out(RecorderLogger* logger) {
     if (logger->ts_compression) {
         size_t buf_size = logger->ts_index * sizeof(uint32_t);
         recorder_write_zlib((unsigned char*)logger->ts, buf_size, logger->ts_file);
+        if (logger->value_streams || logger->return_values) {
+            buf_size = logger->vs_index * sizeof(uint32_t);
+            recorder_write_zlib((unsigned char*)logger->vs, buf_size, logger->ts_file);
+        }
     } else {
         GOTCHA_REAL_CALL(fwrite)(logger->ts, logger->ts_index, sizeof(uint32_t), logger->ts_file);
+        if (logger->value_streams || logger->return_values) {
+            size_t buf_size = logger->vs_index * sizeof(uint32_t);
+            GOTCHA_REAL_CALL(fwrite)(logger->vs, logger->vs_index, sizeof(uint32_t), logger->ts_file);
+            GOTCHA_REAL_CALL(fwrite)(&buf_size, sizeof(size_t), 1, logger->ts_file);
+        }
     }
 }
 
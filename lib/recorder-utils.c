@@ -8,6 +8,7 @@
 #include <errno.h>
 #include <math.h>
 #include <zlib.h>
+#include <fnmatch.h>
 #include "recorder.h"
 
 #define MPI_CHUNK_SIZE (1*1024*1024*1024)
@@ -18,6 +19,7 @@
 static bool   log_pointer = false;
 static size_t memory_usage = 0;
 static int    debug_level = 2;  // 1:ERR, 2:INFO, 3:DBG
+static MPI_Comm recorder_comm_world = MPI_COMM_NULL;   // see internal_comm()
 
 
 char** inclusion_prefix;
@@ -71,30 +73,95 @@ char** str_split(char* a_str, const char a_delim) {
     return result;
 }
 
-char** read_prefix_list(const char* path) {
+/*
+ * Split a comma separated list of glob patterns,
+ * NULL terminated, NULL if the list is empty
+ */
+char** parse_glob_list(const char* list) {
+    if(list == NULL || list[0] == 0)
+        return NULL;
+    int count = 1;
+    for(const char* p = list; *p; p++)
+        if(*p == ',') count++;
+
+    char** patterns = calloc(count+1, sizeof(char*));
+    char* copy = strdup(list);
+    char* saveptr = NULL;
+    int n = 0;
+    for(char* tok = strtok_r(copy, ", ", &saveptr); tok; tok = strtok_r(NULL, ", ", &saveptr))
+        patterns[n++] = strdup(tok);
+    free(copy);
+    return patterns;
+}
+
+int match_glob_list(char** patterns, const char* name) {
+    for(int i = 0; patterns[i] != NULL; i++)
+        if(fnmatch(patterns[i], name, 0) == 0)
+            return 1;
+    return 0;
+}
+
+/*
+ * Content of a config file, NUL terminated, NULL on error.
+ * *size is set to its size (the buffer holds one more byte).
+ *
+ * Once MPI is initialized only rank 0 reads the file and
+ * broadcasts it, so a large job does not hit the shared
+ * file system with one small read per rank. All ranks
+ * must call this, i.e., see the same environment.
+ */
+static char* read_config_file(const char* path, size_t* size) {
     GOTCHA_SET_REAL_CALL(fopen,  RECORDER_POSIX);
     GOTCHA_SET_REAL_CALL(fseek,  RECORDER_POSIX);
     GOTCHA_SET_REAL_CALL(ftell,  RECORDER_POSIX);
     GOTCHA_SET_REAL_CALL(fread,  RECORDER_POSIX);
     GOTCHA_SET_REAL_CALL(fclose, RECORDER_POSIX);
 
-    FILE* f = GOTCHA_REAL_CALL(fopen)(path, "r");
-    if (f == NULL) {
-        RECORDER_LOGERR("[Recorder] invalid prefix file: %s\n", path);
-        return NULL;
+    int mpi_initialized = 0, rank = 0;
+    PMPI_Initialized(&mpi_initialized);
+    if(mpi_initialized)
+        PMPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    char* data = NULL;
+    int64_t fsize = -1;             // -1 if the file could not be read
+    if(rank == 0) {
+        FILE* f = GOTCHA_REAL_CALL(fopen)(path, "r");
+        if(f) {
+            GOTCHA_REAL_CALL(fseek)(f, 0, SEEK_END);
+            fsize = GOTCHA_REAL_CALL(ftell)(f);
+            GOTCHA_REAL_CALL(fseek)(f, 0, SEEK_SET);
+            data = recorder_malloc(fsize+1);
+            data[fsize] = 0;
+            GOTCHA_REAL_CALL(fread)(data, 1, fsize, f);
+            GOTCHA_REAL_CALL(fclose)(f);
+        }
     }
 
-    GOTCHA_REAL_CALL(fseek)(f, 0, SEEK_END);
-    size_t fsize = GOTCHA_REAL_CALL(ftell)(f);
-    GOTCHA_REAL_CALL(fseek)(f, 0, SEEK_SET);
-    char* data = recorder_malloc(fsize+1);
-    data[fsize] = 0;
+    if(mpi_initialized) {
+        recorder_bcast(&fsize, sizeof(fsize), 0, MPI_COMM_WORLD);
+        if(fsize >= 0) {
+            if(rank != 0) {
+                data = recorder_malloc(fsize+1);
+                data[fsize] = 0;
+            }
+            recorder_bcast(data, fsize, 0, MPI_COMM_WORLD);
+        }
+    }
 
-    GOTCHA_REAL_CALL(fread)(data, 1, fsize, f);
-    GOTCHA_REAL_CALL(fclose)(f);
+    if(fsize < 0 && rank == 0)
+        RECORDER_LOGERR("[Recorder] invalid prefix file: %s\n", path);
+    *size = fsize < 0 ? 0 : (size_t)fsize;
+    return data;
+}
+
+char** read_prefix_list(const char* path) {
+    size_t fsize;
+    char* data = read_config_file(path, &fsize);
+    if(data == NULL)
+        return NULL;
 
     char** res = str_split(data, '\n');
-    recorder_free(data, fsize);
+    recorder_free(data, fsize+1);
 
     return res;
 }
@@ -133,6 +200,12 @@ void utils_finalize() {
             free(exclusion_prefix[i]);
         free(exclusion_prefix);
     }
+
+    // still before PMPI_Finalize()
+    if(recorder_comm_world != MPI_COMM_NULL) {
+        GOTCHA_SET_REAL_CALL(MPI_Comm_free, RECORDER_MPI);
+        GOTCHA_REAL_CALL(MPI_Comm_free)(&recorder_comm_world);
+    }
 }
 
 
@@ -209,9 +282,35 @@ inline double recorder_wtime(void) {
   //return PMPI_Wtime();
 }
 
+/*
+ * Recorder's own collectives run on a duplicate of the
+ * communicator, so they never match the application's.
+ * The duplicate of MPI_COMM_WORLD, which is what the
+ * tracer uses, is created on first use (a collective
+ * anyway) and kept until finalize; other communicators
+ * are duplicated per call.
+ */
+static MPI_Comm internal_comm(MPI_Comm comm) {
+    GOTCHA_SET_REAL_CALL(MPI_Comm_dup, RECORDER_MPI);
+    if(comm == MPI_COMM_WORLD) {
+        if(recorder_comm_world == MPI_COMM_NULL)
+            GOTCHA_REAL_CALL(MPI_Comm_dup)(MPI_COMM_WORLD, &recorder_comm_world);
+        return recorder_comm_world;
+    }
+    MPI_Comm tmp_comm;
+    GOTCHA_REAL_CALL(MPI_Comm_dup)(comm, &tmp_comm);
+    return tmp_comm;
+}
+
+static void release_internal_comm(MPI_Comm* comm) {
+    GOTCHA_SET_REAL_CALL(MPI_Comm_free, RECORDER_MPI);
+    if(*comm != recorder_comm_world)
+        GOTCHA_REAL_CALL(MPI_Comm_free)(comm);
+}
+
 /* 
  * Our own bcast call during the tracing process
- * it creates a tmp comm to perform the bcast
+ * it runs on an internal comm (see internal_comm())
  * this avoids interfering with applicaiton's
  * bcast calls on the same communicator.
  *
@@ -221,12 +320,9 @@ inline double recorder_wtime(void) {
  * calls to avoid overflow error.
  */
 void recorder_bcast(void *buf, size_t count, int root, MPI_Comm comm) {
-    GOTCHA_SET_REAL_CALL(MPI_Comm_dup, RECORDER_MPI);
     GOTCHA_SET_REAL_CALL(MPI_Bcast, RECORDER_MPI);
-    GOTCHA_SET_REAL_CALL(MPI_Comm_free, RECORDER_MPI);
 
-    MPI_Comm tmp_comm;
-    GOTCHA_REAL_CALL(MPI_Comm_dup)(comm, &tmp_comm);
+    MPI_Comm tmp_comm = internal_comm(comm);
 
     size_t remain = count;
     void* buf_ptr = buf;
@@ -237,7 +333,7 @@ void recorder_bcast(void *buf, size_t count, int root, MPI_Comm comm) {
         buf_ptr += bcast_count;
     } while(remain > 0);
 
-    GOTCHA_REAL_CALL(MPI_Comm_free)(&tmp_comm);
+    release_internal_comm(&tmp_comm);
 }
 
 void recorder_send(void *buf, size_t count, int dst, int tag, MPI_Comm comm) {
@@ -265,14 +361,11 @@ void recorder_recv(void *buf, size_t count, int src, int tag, MPI_Comm comm) {
 }
 
 void recorder_barrier(MPI_Comm comm) {
-    GOTCHA_SET_REAL_CALL(MPI_Comm_dup, RECORDER_MPI);
     GOTCHA_SET_REAL_CALL(MPI_Barrier, RECORDER_MPI);
-    GOTCHA_SET_REAL_CALL(MPI_Comm_free, RECORDER_MPI);
 
-    MPI_Comm tmp_comm;
-    GOTCHA_REAL_CALL(MPI_Comm_dup)(comm, &tmp_comm);
+    MPI_Comm tmp_comm = internal_comm(comm);
     GOTCHA_REAL_CALL(MPI_Barrier)(tmp_comm);
-    GOTCHA_REAL_CALL(MPI_Comm_free)(&tmp_comm);
+    release_internal_comm(&tmp_comm);
 }
 
 /* Integer to stirng */
@@ -337,7 +430,7 @@ inline char** assemble_args_list(int arg_count, ...) {
 }
 
 /*
- * Convert between function name (char*) and Id (unsigned char)
+ * Convert between function name (char*) and Id (uint16_t)
  * func_list is a fixed string list defined in recorder-log-format.h
  */
 inline const char* get_function_name_by_id(int id) {
@@ -352,15 +445,15 @@ inline const char* get_function_name_by_id(int id) {
     return func_list[id];
 }
 
-unsigned char get_function_id_by_name(const char* name) {
+uint16_t get_function_id_by_name(const char* name) {
     size_t len = sizeof(func_list) / sizeof(char *);
-    unsigned char i;
+    uint16_t i;
     for(i = 0; i < len; i++) {
         if (strcmp(func_list[i], name) == 0)
             return i;
     }
     RECORDER_LOGERR("[Recorder] error: missing function %s\n", name);
-    return 255;
+    return RECORDER_USER_FUNCTION;
 }
 
 /*
@@ -455,7 +548,9 @@ void recorder_write_zlib(unsigned char* buf, size_t buf_size, FILE* out_file) {
     unsigned have;
     z_stream strm;
 
-    unsigned char out[buf_size];
+    // deflate() needs room for its trailer even if buf is empty
+    size_t out_size = buf_size > 0 ? buf_size : 64;
+    unsigned char out[out_size];
 
     /* allocate deflate state */
     strm.zalloc = Z_NULL;
@@ -473,11 +568,11 @@ void recorder_write_zlib(unsigned char* buf, size_t buf_size, FILE* out_file) {
     /* run deflate() on input until output buffer not full, finish
        compression if all of source has been read in */
     do {
-        strm.avail_out = buf_size;
+        strm.avail_out = out_size;
         strm.next_out = out;
         ret = deflate(&strm, Z_FINISH);    /* no bad return value */
         assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
-        have = buf_size - strm.avail_out;
+        have = out_size - strm.avail_out;
         compressed_size += have;
         if (GOTCHA_REAL_CALL(fwrite)(out, 1, have, out_file) != have) {
             RECORDER_LOGERR("[Recorder] fatal error: zlib write out error.");
@@ -0,0 +1,135 @@
+/*
+ * Microbenchmark: CST lookups with uthash (the previous
+ * implementation) vs. the open-addressing CSTable.
+ *
+ * Keys follow the call signature layout (15 bytes of header
+ * followed by the arguments) with a mix of lengths seen in
+ * real traces: short POSIX read/write keys, MPI keys with
+ * communicator and datatype names, and long path keys.
+ *
+ * Build: gcc -O2 -I../include bench_cst.c ../lib/recorder-cs-table.c -o bench_cst
+ * Usage: ./bench_cst [unique signatures] [lookups]
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "recorder-logger.h"
+#include "recorder-cs-table.h"
+
+#define HEADER_LEN 15
+
+typedef struct UTEntry_t {
+    void* key;
+    int key_len;
+    int terminal_id;
+    UT_hash_handle hh;
+} UTEntry;
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static char* make_key(int i, int* key_len) {
+    char args[512];
+    switch(i % 4) {
+        case 0:     // write(fd, buf, count)
+        case 1:
+            sprintf(args, "%d %%p %d ", 3 + i % 13, 512 * (1 + i % 64));
+            break;
+        case 2:     // MPI_File_write_at_all(fh, offset, buf, count, type, status)
+            sprintf(args, "0-%d %d %%p %d MPI_DOUBLE [0_0_0] ", i % 7, i * 1048576, 1 + i % 32);
+            break;
+        default:    // open("/lustre/project/run/output/...", flags, mode)
+            sprintf(args, "/lustre/project/run_%04d/output/checkpoint/step_%06d/field_%03d.dat %d %d ",
+                    i % 17, i, i % 100, 577, 420);
+            break;
+    }
+    int args_len = strlen(args);
+    *key_len = HEADER_LEN + args_len;
+    char* key = calloc(1, *key_len);
+    key[8] = i % 200;               // func id
+    memcpy(key+HEADER_LEN-sizeof(int), &args_len, sizeof(int));
+    memcpy(key+HEADER_LEN, args, args_len);
+    return key;
+}
+
+int main(int argc, char** argv) {
+    int unique  = argc > 1 ? atoi(argv[1]) : 4096;
+    int lookups = argc > 2 ? atoi(argv[2]) : 10000000;
+
+    char** keys = malloc(sizeof(char*) * unique);
+    int* key_lens = malloc(sizeof(int) * unique);
+    for(int i = 0; i < unique; i++)
+        keys[i] = make_key(i, &key_lens[i]);
+
+    // lookup stream: skewed towards a few hot signatures
+    int* stream = malloc(sizeof(int) * lookups);
+    srand(42);
+    for(int i = 0; i < lookups; i++) {
+        int r = rand();
+        stream[i] = (r % 10 < 8) ? (r / 10) % 16 % unique : (r / 10) % unique;
+    }
+
+    // uthash
+    UTEntry* ut = NULL;
+    double t1 = now();
+    for(int i = 0; i < unique; i++) {
+        UTEntry* e = malloc(sizeof(UTEntry));
+        e->key = keys[i];
+        e->key_len = key_lens[i];
+        e->terminal_id = i;
+        HASH_ADD_KEYPTR(hh, ut, e->key, e->key_len, e);
+    }
+    double t2 = now();
+    long found = 0;
+    for(int i = 0; i < lookups; i++) {
+        UTEntry* e = NULL;
+        HASH_FIND(hh, ut, keys[stream[i]], key_lens[stream[i]], e);
+        found += (e != NULL);
+    }
+    double t3 = now();
+    printf("uthash:  insert %8.1f ns/op, lookup %6.1f ns/op (found %ld)\n",
+           (t2-t1)*1e9/unique, (t3-t2)*1e9/lookups, found);
+
+    // CSTable, hashing included in the measured time
+    CSTable cst;
+    cs_table_init(&cst);
+    t1 = now();
+    for(int i = 0; i < unique; i++) {
+        CallSignature* e = malloc(sizeof(CallSignature));
+        e->key = keys[i];
+        e->key_len = key_lens[i];
+        e->terminal_id = i;
+        e->hash = cs_hash64(e->key, e->key_len);
+        cs_table_add(&cst, e);
+    }
+    t2 = now();
+    found = 0;
+    for(int i = 0; i < lookups; i++) {
+        uint64_t hash = cs_hash64(keys[stream[i]], key_lens[stream[i]]);
+        CallSignature* e = cs_table_find(&cst, keys[stream[i]], key_lens[stream[i]], hash);
+        found += (e != NULL);
+    }
+    t3 = now();
+    printf("CSTable: insert %8.1f ns/op, lookup %6.1f ns/op (found %ld)\n",
+           (t2-t1)*1e9/unique, (t3-t2)*1e9/lookups, found);
+
+    UTEntry *e, *tmp;
+    HASH_ITER(hh, ut, e, tmp) {
+        HASH_DEL(ut, e);
+        free(e);
+    }
+    for(int i = 0; i < cs_table_count(&cst); i++)
+        free(cst.entries[i]);
+    cs_table_destroy(&cst);
+    for(int i = 0; i < unique; i++)
+        free(keys[i]);
+    free(keys);
+    free(key_lens);
+    free(stream);
+    return 0;
+}
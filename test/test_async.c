@@ -0,0 +1,107 @@
+/*
+ * Drives POSIX AIO and io_uring on a local file.
+ *
+ *   gcc test_async.c -o test_async -lrt [-luring]
+ *   LD_PRELOAD=$RECORDER_INSTALL_PATH/lib/librecorder.so RECORDER_WITH_NON_MPI=1 ./test_async
+ *
+ * The io_uring part is skipped if liburing is not installed.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <aio.h>
+#if __has_include(<liburing.h>)
+#include <liburing.h>
+#define HAVE_LIBURING
+#endif
+
+#define BLOCK_SIZE  4096
+#define NUM_BLOCKS  64
+
+static char buf[NUM_BLOCKS][BLOCK_SIZE];
+
+void test_aio(int fd) {
+    struct aiocb cbs[4];
+    const struct aiocb *list[4];
+    memset(cbs, 0, sizeof(cbs));
+
+    for(int i = 0; i < 4; i++) {
+        cbs[i].aio_fildes = fd;
+        cbs[i].aio_buf = buf[i];
+        cbs[i].aio_nbytes = BLOCK_SIZE;
+        cbs[i].aio_offset = (off_t)i * BLOCK_SIZE;
+        list[i] = &cbs[i];
+        aio_write(&cbs[i]);
+    }
+    for(int i = 0; i < 4; i++) {
+        while(aio_error(&cbs[i]) == EINPROGRESS)
+            aio_suspend(list, 4, NULL);
+        printf("aio_write %d: %zd\n", i, aio_return(&cbs[i]));
+    }
+
+    for(int i = 0; i < 4; i++)
+        aio_read(&cbs[i]);
+    for(int i = 0; i < 4; i++) {
+        while(aio_error(&cbs[i]) == EINPROGRESS)
+            aio_suspend(list, 4, NULL);
+        printf("aio_read %d: %zd\n", i, aio_return(&cbs[i]));
+    }
+}
+
+#ifdef HAVE_LIBURING
+void test_io_uring(int fd) {
+    struct io_uring ring;
+    struct io_uring_cqe *cqe, *cqes[NUM_BLOCKS];
+    if(io_uring_queue_init(NUM_BLOCKS, &ring, 0) < 0) {
+        printf("io_uring not available, skipped\n");
+        return;
+    }
+
+    // one submit of 64 writes
+    for(int i = 0; i < NUM_BLOCKS; i++) {
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+        io_uring_prep_write(sqe, fd, buf[i], BLOCK_SIZE, (off_t)i * BLOCK_SIZE);
+        io_uring_sqe_set_data64(sqe, i);
+    }
+    printf("io_uring_submit: %d\n", io_uring_submit(&ring));
+
+    int done = 0;
+    while(done < NUM_BLOCKS) {
+        io_uring_wait_cqe(&ring, &cqe);
+        unsigned n = io_uring_peek_batch_cqe(&ring, cqes, NUM_BLOCKS);
+        io_uring_cq_advance(&ring, n);
+        done += n;
+    }
+
+    // and read them back, one by one
+    for(int i = 0; i < NUM_BLOCKS; i++) {
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+        io_uring_prep_read(sqe, fd, buf[i], BLOCK_SIZE, (off_t)i * BLOCK_SIZE);
+        io_uring_sqe_set_data64(sqe, NUM_BLOCKS + i);
+        io_uring_submit_and_wait(&ring, 1);
+        io_uring_wait_cqe(&ring, &cqe);
+        if(cqe->res != BLOCK_SIZE)
+            printf("io_uring read %d: %d\n", i, cqe->res);
+        io_uring_cqe_seen(&ring, cqe);
+    }
+
+    io_uring_queue_exit(&ring);
+}
+#endif
+
+int main() {
+    for(int i = 0; i < NUM_BLOCKS; i++)
+        memset(buf[i], 'a' + i % 26, BLOCK_SIZE);
+
+    int fd = open("./workfile.out", O_CREAT|O_RDWR|O_TRUNC, 0644);
+    test_aio(fd);
+#ifdef HAVE_LIBURING
+    test_io_uring(fd);
+#endif
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,43 @@
+/*
+ * Pause/resume and region markers (include/recorder-control.h).
+ *
+ *   mpicc test_control.c -o test_control -I$RECORDER_INSTALL_PATH/include -L$RECORDER_INSTALL_PATH/lib -lrecorder
+ *   mpirun -np 2 ./test_control
+ *
+ * The trace should hold no I/O of the warm-up loop, and the
+ * writes of each step inside a "step" region.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "mpi.h"
+#include "recorder-control.h"
+
+int main(int argc, char *argv[]) {
+    MPI_Init(&argc, &argv);
+
+    int rank;
+    char buf[1024], fname[64];
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    memset(buf, 'a', sizeof(buf));
+    sprintf(fname, "./control-%d.out", rank);
+
+    // opened while paused, written after resume
+    recorder_pause();
+    int fd = open(fname, O_CREAT|O_RDWR|O_TRUNC, 0644);
+    for(int i = 0; i < 100; i++)
+        pwrite(fd, buf, sizeof(buf), 0);
+    recorder_resume();
+
+    for(int step = 0; step < 4; step++) {
+        recorder_region_begin("step");
+        write(fd, buf, sizeof(buf));
+        MPI_Barrier(MPI_COMM_WORLD);
+        recorder_region_end();
+    }
+
+    close(fd);
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * Check that timestamps survive long idle gaps between two
+ * traced calls (e.g., hourly checkpoints).
+ *
+ * The clock is mocked so the test runs instantly. Records
+ * are encoded the same way as write_record() does, and
+ * decoded the same way as the reader's rule_application().
+ *
+ * The second part checks that the predictive coder
+ * (RECORDER_TIME_PREDICTION) reconstructs a loop exactly.
+ *
+ * Build: gcc -I../include test_timestamps.c -o test_timestamps -lm
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "recorder-timestamps.h"
+
+#define NUM_RECORDS 8
+
+static double mock_now = 1000.0;
+
+static double mock_wtime() {
+    return mock_now;
+}
+
+static void mock_sleep(double secs) {
+    mock_now += secs;
+}
+
+static int test_long_gaps() {
+    double resolution = 1e-7;       // default 100ns
+    double start_ts = mock_wtime();
+
+    // idle time before each call, in seconds
+    double gaps[NUM_RECORDS] = { 0.5, 3600, 0.001, 7200*3, 429.5, 430, 0, 86400 };
+    double durations[NUM_RECORDS] = { 0.1, 1.5, 0.0, 3600, 0.2, 500, 0.0, 10 };
+    double tstarts[NUM_RECORDS], tends[NUM_RECORDS];
+
+    // Tracer side
+    uint32_t ts[NUM_RECORDS * RECORDER_TS_MAX_RECORD_WORDS];
+    int ts_index = 0;
+    double prev_tstart = start_ts;
+    for(int i = 0; i < NUM_RECORDS; i++) {
+        mock_sleep(gaps[i]);
+        tstarts[i] = mock_wtime();
+        mock_sleep(durations[i]);
+        tends[i] = mock_wtime();
+
+        ts_index += ts_encode_record(ts+ts_index, tstarts[i], tends[i], prev_tstart, resolution);
+        prev_tstart = tstarts[i];
+    }
+
+    // Reader side
+    int errors = 0;
+    uint32_t* cursor = ts;
+    prev_tstart = 0.0;
+    for(int i = 0; i < NUM_RECORDS; i++) {
+        double tstart, tend;
+        ts_decode_record(&cursor, resolution, &prev_tstart, &tstart, &tend);
+
+        double expected_tstart = tstarts[i] - start_ts;
+        double expected_tend   = tends[i] - start_ts;
+        // allow one tick of truncation per record
+        double tolerance = (i+1) * resolution + 1e-6;
+        if (fabs(tstart - expected_tstart) > tolerance ||
+            fabs(tend - expected_tend) > tolerance) {
+            printf("record %d: expected (%.7f, %.7f), got (%.7f, %.7f)\n",
+                   i, expected_tstart, expected_tend, tstart, tend);
+            errors++;
+        }
+    }
+
+    if (cursor != ts + ts_index) {
+        printf("decoded %ld words, but %d were encoded\n", (long)(cursor-ts), ts_index);
+        errors++;
+    }
+
+    printf("long gaps %s: %d records, %d words\n", errors ? "FAILED" : "PASSED", NUM_RECORDS, ts_index);
+    return errors;
+}
+
+#define LOOP_ITERATIONS 1000
+#define LOOP_TERMINALS  3
+
+static int test_prediction() {
+    double resolution = 1e-7;
+    double start_ts = mock_wtime();
+
+    // open(), write(), close() in a loop with a
+    // checkpoint-like pause every 100 iterations
+    double durations[LOOP_TERMINALS] = { 0.0002, 0.01, 0.0001 };
+    int num_records = LOOP_ITERATIONS * LOOP_TERMINALS;
+    double* tstarts = malloc(sizeof(double) * num_records);
+    double* tends   = malloc(sizeof(double) * num_records);
+    uint32_t* ts = malloc(sizeof(uint32_t) * num_records * RECORDER_TS_MAX_RECORD_WORDS);
+
+    TimestampPredictor pred;
+    ts_predictor_init(&pred);
+    int ts_index = 0, zeros = 0;
+    double prev_tstart = start_ts;
+    for(int i = 0; i < num_records; i++) {
+        int terminal = i % LOOP_TERMINALS;
+        mock_sleep((i % 300 == 0) ? 3600 : 0.001);
+        tstarts[i] = mock_wtime();
+        mock_sleep(durations[terminal]);
+        tends[i] = mock_wtime();
+
+        int n = ts_encode_record_predicted(ts+ts_index, &pred, terminal, tstarts[i], tends[i],
+                                           prev_tstart, resolution);
+        for(int j = 0; j < n; j++)
+            zeros += (ts[ts_index+j] == 0);
+        ts_index += n;
+        prev_tstart = tstarts[i];
+    }
+    ts_predictor_free(&pred);
+
+    // Decode with a fresh predictor, as the reader does
+    ts_predictor_init(&pred);
+    int errors = 0;
+    uint32_t* cursor = ts;
+    prev_tstart = 0.0;
+    for(int i = 0; i < num_records; i++) {
+        double tstart, tend;
+        ts_decode_record_predicted(&cursor, &pred, i % LOOP_TERMINALS, resolution,
+                                   &prev_tstart, &tstart, &tend);
+        double tolerance = (i+1) * resolution + 1e-6;
+        if (fabs(tstart - (tstarts[i]-start_ts)) > tolerance ||
+            fabs(tend - (tends[i]-start_ts)) > tolerance) {
+            if (errors < 10)
+                printf("record %d: expected (%.7f, %.7f), got (%.7f, %.7f)\n", i,
+                       tstarts[i]-start_ts, tends[i]-start_ts, tstart, tend);
+            errors++;
+        }
+    }
+    ts_predictor_free(&pred);
+
+    if (cursor != ts + ts_index) {
+        printf("decoded %ld words, but %d were encoded\n", (long)(cursor-ts), ts_index);
+        errors++;
+    }
+
+    printf("prediction %s: %d records, %d words, %d zero residuals\n",
+           errors ? "FAILED" : "PASSED", num_records, ts_index, zeros);
+    free(tstarts);
+    free(tends);
+    free(ts);
+    return errors;
+}
+
+int main() {
+    int errors = test_long_gaps();
+    errors += test_prediction();
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,106 @@
+/*
+ * Round trip of timestamps through a real trace: records with
+ * long idle gaps between them (e.g., hourly checkpoints) are
+ * written with write_record(), flushed by logger_finalize()
+ * (ts_write_out()), and read back with the reader.
+ *
+ * The timestamps are set by hand, so the test runs instantly.
+ * Build and run from the build directory (Recorder/build, see
+ * docs/source/build.rst), HDF5_INCLUDE_DIR being the directory
+ * of hdf5.h, e.g., /usr/include/hdf5/serial:
+ *
+ *   mpicc -D_GNU_SOURCE -D_LARGEFILE64_SOURCE                       \
+ *         -I../include -I../tools -I../deps/GOTCHA/include -I$HDF5_INCLUDE_DIR \
+ *         ../test/test_trace_timestamps.c -o test_trace_timestamps  \
+ *         -Lbin -Wl,-rpath,$PWD/bin -lrecorder -lreader -lz -lm
+ *   ./test_trace_timestamps
+ *   RECORDER_TIME_PREDICTION=1 ./test_trace_timestamps
+ *   RECORDER_TIME_COMPRESSION=0 ./test_trace_timestamps
+ *   RECORDER_VALUE_STREAMS=1 ./test_trace_timestamps
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "recorder.h"
+#include "reader.h"
+
+#define NUM_RECORDS 64
+#define TRACES_DIR  "./test-trace-timestamps"
+
+// lib/recorder-init-finalize.c
+void recorder_init();
+void recorder_finalize();
+
+static double tstarts[NUM_RECORDS], tends[NUM_RECORDS];
+static double start_ts;
+static int decoded = 0, errors = 0;
+
+static void write_records() {
+    // idle time before each call and its duration, in seconds
+    double gaps[] = { 0.5, 3600, 0.001, 7200*3, 429.5, 430, 0, 86400 };
+    double durations[] = { 0.1, 1.5, 0.0, 3600, 0.2, 500, 0.0, 10 };
+    int n = sizeof(gaps) / sizeof(gaps[0]);
+
+    double now = recorder_wtime();
+    for(int i = 0; i < NUM_RECORDS; i++) {
+        now += gaps[i % n];
+        tstarts[i] = now;
+        now += durations[i % n];
+        tends[i] = now;
+
+        Record *record = recorder_malloc(sizeof(Record));
+        record->func_id = get_function_id_by_name("fsync");
+        record->tid = recorder_gettid();
+        record->call_depth = 0;
+        record->stack_id = 0;
+        record->tstart = tstarts[i];
+        record->tend = tends[i];
+        record->res = 0;
+        record->arg_count = 1;
+        record->args = assemble_args_list(1, strdup("/tmp/checkpoint"));
+        write_record(record);
+        free_record(record);
+    }
+}
+
+static void check_record(Record* record, void* arg) {
+    int i = decoded++;
+    if(i >= NUM_RECORDS)
+        return;
+
+    double expected_tstart = tstarts[i] - start_ts;
+    double expected_tend   = tends[i] - start_ts;
+    // allow one tick of truncation per record
+    double tolerance = (i+1) * 1e-7 + 1e-6;
+    if (fabs(record->tstart - expected_tstart) > tolerance ||
+        fabs(record->tend - expected_tend) > tolerance) {
+        if (errors < 10)
+            printf("record %d: expected (%.7f, %.7f), got (%.7f, %.7f)\n",
+                   i, expected_tstart, expected_tend, record->tstart, record->tend);
+        errors++;
+    }
+}
+
+int main() {
+    setenv(RECORDER_WITH_NON_MPI, "1", 1);
+    setenv(RECORDER_TRACES_DIR, TRACES_DIR, 1);
+
+    recorder_init();
+    write_records();
+    recorder_finalize();
+
+    RecorderReader reader;
+    recorder_init_reader(TRACES_DIR, &reader);
+    start_ts = reader.metadata.start_ts;
+    recorder_decode_records(&reader, 0, check_record, NULL);
+    recorder_free_reader(&reader);
+
+    if (decoded != NUM_RECORDS) {
+        printf("decoded %d records, but %d were written\n", decoded, NUM_RECORDS);
+        errors++;
+    }
+
+    printf("trace timestamps %s: %d records\n", errors ? "FAILED" : "PASSED", NUM_RECORDS);
+    return errors ? 1 : 0;
+}
@@ -19,6 +19,25 @@ typedef struct RRecord_t {
 } RRecord;
 
 
+/*
+ * MPI-IO file view of one file handle, as recorded by
+ * MPI_File_set_view(): displacement, etype size, and the
+ * (offset, length) byte runs of one filetype extent.
+ */
+typedef struct MPIView_t {
+    string filename;
+    size_t disp = 0;
+    size_t esize = 1;
+    size_t extent = 0;
+    vector<pair<size_t, size_t>> runs;  // empty if unknown
+    size_t pointer = 0;                 // individual file pointer, in etypes
+    bool pointer_known = true;
+} MPIView;
+
+// An access with more runs falls back to
+// the POSIX calls it made
+#define MAX_ACCESS_RUNS 1024
+
 RecorderReader *reader;
 vector<RRecord> records;
 
@@ -62,7 +81,17 @@ void handle_data_operation(RRecord &rr,
         strcpy(I.mpifh, current_mpifh.c_str());
 
     string filename = "";
-    if(strstr(func, "writev") || strstr(func, "readv")) {
+    // aio_read/aio_write(file, offset, nbytes, aiocb)
+    if(strncmp(func, "aio_", 4) == 0) {
+        filename = R->args[0];
+        I.offset = str2sizet(R->args[1]);
+        I.count = str2sizet(R->args[2]);
+    // offset -1 of preadv2/pwritev2: the file offset is used
+    } else if((strstr(func, "pwritev") || strstr(func, "preadv")) && atoll(R->args[3]) != -1) {
+        filename = R->args[0];
+        I.count = str2sizet(R->args[1]);
+        I.offset = str2sizet(R->args[3]);
+    } else if(strstr(func, "writev") || strstr(func, "readv")) {
         filename = R->args[0];
         I.offset = offset_book[filename];
         I.count = str2sizet(R->args[1]);
@@ -105,6 +134,225 @@ void handle_data_operation(RRecord &rr,
     }
 }
 
+/*
+ * Parse "[a,b,...]" into vals, return false if arg is not one
+ */
+static bool parse_int_vector(const char* arg, vector<size_t> &vals) {
+    vals.clear();
+    if(arg[0] != '[')
+        return false;
+    const char* p = arg + 1;
+    while(*p && *p != ']') {
+        char* end;
+        long long v = strtoll(p, &end, 10);
+        if(end == p)
+            return false;
+        vals.push_back((size_t) v);
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return *p == ']';
+}
+
+/*
+ * io_uring_submit*(ring, files, file index, op, offset, bytes, user_data)
+ * One interval per read/write SQE, stamped with the submit time.
+ */
+void handle_uring_data_operation(RRecord &rr,
+                                 unordered_map<string, size_t> &offset_book,
+                                 unordered_map<string, size_t> &local_eof,
+                                 unordered_map<string, size_t> &global_eof,
+                                 unordered_map<string, vector<Interval>> &intervals)
+{
+    Record *R = rr.record;
+    if(R->arg_count < 7 || R->args[1][0] != '[')
+        return;
+
+    vector<string> files;
+    string list(R->args[1]+1);
+    size_t start = 0, end;
+    while((end = list.find_first_of(",]", start)) != string::npos) {
+        files.push_back(list.substr(start, end-start));
+        start = end + 1;
+    }
+
+    vector<size_t> file_idx, ops, offsets, bytes;
+    if(!parse_int_vector(R->args[2], file_idx) || !parse_int_vector(R->args[3], ops) ||
+       !parse_int_vector(R->args[4], offsets) || !parse_int_vector(R->args[5], bytes))
+        return;
+
+    for(size_t i = 0; i < ops.size() && i < file_idx.size() && i < offsets.size() && i < bytes.size(); i++) {
+        // IORING_OP_READV, WRITEV, READ_FIXED, WRITE_FIXED, READ, WRITE
+        bool is_read = (ops[i] == 1 || ops[i] == 4 || ops[i] == 22);
+        bool is_write = (ops[i] == 2 || ops[i] == 5 || ops[i] == 23);
+        if((!is_read && !is_write) || file_idx[i] >= files.size())
+            continue;
+
+        string &filename = files[file_idx[i]];
+        Interval I;
+        I.rank = rr.rank;
+        I.seqId = rr.seq_id;
+        I.tstart = R->tstart;
+        I.isRead = is_read;
+        I.count = bytes[i];
+        // offset -1: the file offset is used
+        if(offsets[i] == (size_t)-1) {
+            I.offset = offset_book[filename];
+            offset_book[filename] += I.count;
+        } else {
+            I.offset = offsets[i];
+        }
+        memset(I.mpifh, 0, sizeof(I.mpifh));
+        strcpy(I.mpifh, "-");
+
+        local_eof[filename] = max(local_eof[filename], I.offset+I.count);
+        global_eof[filename] = get_eof(filename, local_eof, global_eof);
+        intervals[filename].push_back(I);
+    }
+}
+
+/*
+ * Keep track of the views and individual file pointers
+ * of MPI-IO file handles (one table per rank).
+ */
+void handle_mpiio_metadata_operation(RRecord &rr, unordered_map<string, MPIView> &views)
+{
+    Record *R = rr.record;
+    const char* func = recorder_get_func_name(reader, R);
+
+    if(strcmp(func, "MPI_File_open") == 0) {
+        // default view: bytes, contiguous
+        MPIView view;
+        view.filename = R->args[1];
+        views[R->args[R->arg_count-1]] = view;
+        return;
+    }
+
+    auto it = views.find(R->args[0]);
+    if(it == views.end())
+        return;
+    MPIView &view = it->second;
+
+    if(strcmp(func, "MPI_File_set_view") == 0) {
+        vector<size_t> vals;
+        view.disp = str2sizet(R->args[1]);
+        view.pointer = 0;
+        view.pointer_known = true;
+        view.runs.clear();
+        // older traces do not have the flattened filetype
+        if(R->arg_count > 6 && parse_int_vector(R->args[6], vals) && vals.size() >= 2) {
+            view.esize  = vals[0];
+            view.extent = vals[1];
+            for(size_t k = 2; k+1 < vals.size(); k += 2)
+                view.runs.push_back(make_pair(vals[k], vals[k+1]));
+        }
+    } else if(strcmp(func, "MPI_File_seek") == 0) {
+        // MPI_SEEK_END would need the file size
+        long long offset = atoll(R->args[1]);
+        if(strcmp(R->args[2], "MPI_SEEK_SET") == 0) {
+            view.pointer = offset;
+            view.pointer_known = true;
+        } else if(strcmp(R->args[2], "MPI_SEEK_CUR") == 0)
+            view.pointer += offset;
+        else
+            view.pointer_known = false;
+    }
+}
+
+/*
+ * Map an MPI-IO read or write to the byte ranges it
+ * accessed, using the view of its file handle.
+ * Return false if that is not possible, e.g., shared file
+ * pointers, a filetype that could not be flattened, or
+ * traces without the byte count of accesses.
+ */
+bool handle_mpiio_data_operation(RRecord &rr, unordered_map<string, MPIView> &views,
+                                 unordered_map<string, size_t> &local_eof,
+                                 unordered_map<string, size_t> &global_eof,
+                                 unordered_map<string, vector<Interval>> &intervals)
+{
+    Record *R = rr.record;
+    const char* func = recorder_get_func_name(reader, R);
+
+    auto it = views.find(R->args[0]);
+    if(it == views.end() || it->second.runs.empty())
+        return false;
+    MPIView &view = it->second;
+
+    // the byte count is the last argument
+    char* end;
+    long long bytes = strtoll(R->args[R->arg_count-1], &end, 10);
+    if(*end != 0 || bytes < 0)
+        return false;
+
+    bool explicit_offset = strstr(func, "_at") != NULL;
+    bool shared = strstr(func, "shared") || strstr(func, "ordered");
+    if(shared)
+        return false;
+    if(!explicit_offset && !view.pointer_known)
+        return false;
+
+    size_t start = explicit_offset ? str2sizet(R->args[1]) : view.pointer;
+    if(!explicit_offset && view.esize > 0)
+        view.pointer += bytes / view.esize;
+
+    // The POSIX calls of a nonblocking access may come after the
+    // post returns (e.g., in MPI_Wait), past mapped_until, so they
+    // are left to describe it; only the file pointer moves here.
+    if(strncmp(func, "MPI_File_i", 10) == 0)
+        return false;
+
+    size_t tile_bytes = 0;
+    for(auto &run : view.runs)
+        tile_bytes += run.second;
+    if(tile_bytes == 0)
+        return false;
+
+    // position in the data of the view, then walk the runs
+    vector<pair<size_t, size_t>> accessed;
+    size_t pos = start * view.esize;
+    size_t remain = bytes;
+    size_t tile = pos / tile_bytes, in_tile = pos % tile_bytes;
+    size_t r = 0;
+    while(in_tile >= view.runs[r].second) {
+        in_tile -= view.runs[r].second;
+        r++;
+    }
+    while(remain > 0) {
+        size_t len = min(remain, view.runs[r].second - in_tile);
+        size_t off = view.disp + tile*view.extent + view.runs[r].first + in_tile;
+        if(!accessed.empty() && accessed.back().first + accessed.back().second == off)
+            accessed.back().second += len;
+        else if(accessed.size() == MAX_ACCESS_RUNS)
+            return false;
+        else
+            accessed.push_back(make_pair(off, len));
+        remain -= len;
+        in_tile = 0;
+        if(++r == view.runs.size()) {
+            r = 0;
+            tile++;
+        }
+    }
+
+    string &filename = view.filename;
+    for(auto &a : accessed) {
+        Interval I;
+        I.rank = rr.rank;
+        I.seqId = rr.seq_id;
+        I.tstart = R->tstart;
+        I.isRead = strstr(func, "read") ? true: false;
+        I.offset = a.first;
+        I.count = a.second;
+        memset(I.mpifh, 0, sizeof(I.mpifh));
+        strncpy(I.mpifh, R->args[0], sizeof(I.mpifh)-1);
+
+        local_eof[filename] = max(local_eof[filename], I.offset+I.count);
+        global_eof[filename] = get_eof(filename, local_eof, global_eof);
+        intervals[filename].push_back(I);
+    }
+    return true;
+}
+
 /*
  * Inspect metadata operations to make
  * sure we can correctly keep track of
@@ -190,10 +438,12 @@ void insert_one_record(Record* r, void* arg) {
     if((func_type != RECORDER_POSIX) && (func_type != RECORDER_MPIIO))
         return;
 
-    // For MPI-IO calls keep only MPI_File_write* and MPI_File_read*
+    // For MPI-IO calls keep only MPI_File_write* and MPI_File_read*,
+    // and the calls that change views and file pointers
     if((func_type == RECORDER_MPIIO) && (!strstr(func, "MPI_File_write")) 
         && (!strstr(func, "MPI_File_read")) && (!strstr(func, "MPI_File_iread"))
-        && (!strstr(func, "MPI_File_iwrite")))
+        && (!strstr(func, "MPI_File_iwrite")) && strcmp(func, "MPI_File_open")
+        && strcmp(func, "MPI_File_set_view") && strcmp(func, "MPI_File_seek"))
         return;
     
     if(strstr(func, "dir") || strstr(func, "link"))
@@ -237,6 +487,11 @@ IntervalsMap* build_offset_intervals(RecorderReader *_reader, int *num_files) {
     unordered_map<string, size_t> offset_books[reader->metadata.total_ranks];
     unordered_map<string, size_t> local_eofs[reader->metadata.total_ranks];
     unordered_map<string, size_t> global_eof;
+    unordered_map<string, MPIView> mpi_views[reader->metadata.total_ranks];
+
+    // POSIX calls made by an MPI-IO call whose byte ranges
+    // are already known from its view end here (per rank)
+    vector<double> mapped_until(reader->metadata.total_ranks, -1);
 
     string current_mpifh = "";
     int current_mpi_call_depth;
@@ -245,14 +500,24 @@ IntervalsMap* build_offset_intervals(RecorderReader *_reader, int *num_files) {
     for(i = 0; i < records.size(); i++) {
         RRecord rr = records[i];
         const char* func = recorder_get_func_name(reader, rr.record);
-        // Only MPI_File_write* and MPI_File_read* calls here
-        // thanks to insert_one_record()
+        // MPI_File_write*, MPI_File_read* and MPI-IO
+        // metadata calls here thanks to insert_one_record()
         if(strstr(func, "MPI")) {
+            if(!strstr(func, "read") && !strstr(func, "write")) {
+                handle_mpiio_metadata_operation(rr, mpi_views[rr.rank]);
+                continue;
+            }
             current_mpifh = rr.record->args[0];
             current_mpi_call_depth = (int) rr.record->call_depth;
+            if(handle_mpiio_data_operation(rr, mpi_views[rr.rank], local_eofs[rr.rank], global_eof, intervals))
+                mapped_until[rr.rank] = rr.record->tend;
         // POSIX calls
+        } else if(strncmp(func, "io_uring_submit", 15) == 0) {
+            handle_uring_data_operation(rr, offset_books[rr.rank], local_eofs[rr.rank], global_eof, intervals);
         } else {
             handle_metadata_operation(rr, offset_books[rr.rank], local_eofs[rr.rank], global_eof);
+            if(rr.record->tstart <= mapped_until[rr.rank])
+                continue;
             handle_data_operation(rr, offset_books[rr.rank], local_eofs[rr.rank], global_eof, intervals, current_mpifh, current_mpi_call_depth);
         }
     }
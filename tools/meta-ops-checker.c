@@ -13,10 +13,12 @@ Record callers[4];
 // [func_id] = 2 by hdf5
 // [func_id] = 1 by mpi
 // [func_id] = 0 not used
-int meta_op_caller[256] = {0};
+int meta_op_caller[RECORDER_MAX_FUNCS] = {0};
 
 
 bool ignore_function(int func_id) {
+    if(func_id >= RECORDER_MAX_FUNCS)     // user functions
+        return true;
     const char *func = func_list[func_id];
     if(strstr(func, "MPI") || strstr(func, "H5"))
         return true;
@@ -54,7 +56,7 @@ void test(Record *records, int len, RecorderReader *reader) {
 
         if(!ignore_function(record.func_id)) {
             if(depth > 1) {
-                const char* caller_func = reader->func_list[caller.func_id];
+                const char* caller_func = recorder_get_func_name(reader, &caller);
                 if(strstr(caller_func, "MPI"))
                     meta_op_caller[record.func_id] = max(meta_op_caller[record.func_id], 1);
                 if(strstr(caller_func, "H5"))
@@ -46,6 +46,30 @@ void reader_decode_cst_2_3(RecorderReader *reader, int rank, CST *cst) {
     fclose(f);
 }
 
+/*
+ * Keys of traces before 2.6 have a one-byte func_id, with
+ * 255 for user functions. Rewrite them to the current
+ * two-byte layout so reader_cs_to_record() decodes both.
+ */
+void reader_widen_cst_func_ids(CST *cst) {
+    size_t pos = sizeof(pthread_t);
+    for(int i = 0; i < cst->entries; i++) {
+        CallSignature* cs = &cst->cs_list[i];
+        char* old_key = cs->key;
+        uint16_t func_id = (uint8_t) old_key[pos];
+        if(func_id == 255)
+            func_id = RECORDER_USER_FUNCTION;
+
+        char* key = malloc(cs->key_len + 1);
+        memcpy(key, old_key, pos);
+        memcpy(key+pos, &func_id, sizeof(func_id));
+        memcpy(key+pos+sizeof(func_id), old_key+pos+1, cs->key_len-pos-1);
+        free(old_key);
+        cs->key = key;
+        cs->key_len += 1;
+    }
+}
+
 void reader_decode_cfg_2_3(RecorderReader *reader, int rank, CFG* cfg) {
     cfg->rank = rank;
     char cfg_filename[1096] = {0};
@@ -143,6 +167,7 @@ CFG* reader_get_cfg(RecorderReader* reader, int rank) {
 Record* reader_cs_to_record(CallSignature *cs) {
 
     Record *record = malloc(sizeof(Record));
+    record->res = 0;    // filled in from the value stream, if stored
 
     char* key = cs->key;
 
@@ -173,6 +198,11 @@ Record* reader_cs_to_record(CallSignature *cs) {
     }
 
     assert(ai == record->arg_count);
+
+    // followed by the stack id if a call site was captured
+    record->stack_id = 0;
+    if(cs->key_len >= pos + arg_strlen + (int)sizeof(record->stack_id))
+        memcpy(&record->stack_id, key+pos+arg_strlen, sizeof(record->stack_id));
     return record;
 }
 
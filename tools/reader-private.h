@@ -20,7 +20,7 @@ typedef struct Interval_t {
     size_t offset;
     size_t count;
     bool isRead;
-    char mpifh[10];
+    char mpifh[32];
 } Interval;
 
 /* Per-file intervals
@@ -52,6 +52,7 @@ void reader_decode_cst_2_3(RecorderReader *reader, int rank, CST *cst);
 void reader_decode_cfg_2_3(RecorderReader *reader, int rank, CFG *cfg);
 void reader_decode_cst(int rank, void* buf, CST* cst);
 void reader_decode_cfg(int rank, void* buf, CFG* cfg);
+void reader_widen_cst_func_ids(CST *cst);
 void reader_free_cst(CST *cst);
 void reader_free_cfg(CFG *cfg);
 CST* reader_get_cst(RecorderReader* reader, int rank);
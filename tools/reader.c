@@ -6,6 +6,7 @@
 #include <zlib.h>
 #include "reader.h"
 #include "reader-private.h"
+#include "recorder-pattern-recognition.h"
 
 void* read_zlib(FILE* source) {
     const int CHUNK = 65536;
@@ -78,6 +79,11 @@ void check_version(RecorderReader* reader, int* v_major, int* v_minor) {
 
     double v1 = major + minor/10.0;
     double v2 = RECORDER_VERSION_MAJOR + RECORDER_VERSION_MINOR/10.0;
+    // the layout of recorder.mt is only known from 2.3 on
+    if (major < 2 || (major == 2 && minor < 3)) {
+        fprintf(stderr, "unsupported version: trace=%d.%d.%d < 2.3\n", major, minor, patch);
+        exit(1);
+    }
     if (v1 > v2) {
         fprintf(stderr, "incompatible version: trace=%d.%d.%d > reader=%d.%d.%d\n",
                 major, minor, patch, RECORDER_VERSION_MAJOR,
@@ -93,6 +99,10 @@ void read_metadata(RecorderReader* reader) {
 
     FILE* fp = fopen(metadata_file, "rb");
     assert(fp != NULL);
+    // Fields not in the older layouts below keep these values
+    memset(&reader->metadata, 0, sizeof(reader->metadata));
+    memset(reader->metadata.traced_funcs, 0xFF, sizeof(reader->metadata.traced_funcs));
+
     if (reader->trace_version_major == 2 && reader->trace_version_minor == 3) {
         struct RecorderMetadata_2_3 {
             int    total_ranks;
@@ -113,10 +123,41 @@ void read_metadata(RecorderReader* reader) {
         reader->metadata.start_ts = metadata_2_3.start_ts;
         reader->metadata.time_resolution = metadata_2_3.time_resolution;
         reader->metadata.ts_buffer_elements= metadata_2_3.ts_buffer_elements;
-        reader->metadata.interprocess_compression = 0;
-        reader->metadata.interprocess_pattern_recognition = 0;
-        reader->metadata.intraprocess_pattern_recognition = 0;
-        reader->metadata.ts_compression = 0;
+    } else if (reader->trace_version_major == 2 && reader->trace_version_minor < 6) {
+        // 2.4 and 2.5, before timestamp prediction, value
+        // streams and the traced function bitmap were added
+        struct RecorderMetadata_2_5 {
+            int    total_ranks;
+            bool   posix_tracing;
+            bool   mpi_tracing;
+            bool   mpiio_tracing;
+            bool   hdf5_tracing;
+            bool   store_tid;
+            bool   store_call_depth;
+            double start_ts;
+            double time_resolution;
+            int    ts_buffer_elements;
+            bool   ts_compression;
+            bool   interprocess_compression;
+            bool   interprocess_pattern_recognition;
+            bool   intraprocess_pattern_recognition;
+        };
+        struct RecorderMetadata_2_5 metadata_2_5;
+        fread(&metadata_2_5, sizeof(metadata_2_5), 1, fp);
+        reader->metadata.total_ranks = metadata_2_5.total_ranks;
+        reader->metadata.posix_tracing = metadata_2_5.posix_tracing;
+        reader->metadata.mpi_tracing = metadata_2_5.mpi_tracing;
+        reader->metadata.mpiio_tracing = metadata_2_5.mpiio_tracing;
+        reader->metadata.hdf5_tracing = metadata_2_5.hdf5_tracing;
+        reader->metadata.store_tid = metadata_2_5.store_tid;
+        reader->metadata.store_call_depth = metadata_2_5.store_call_depth;
+        reader->metadata.start_ts = metadata_2_5.start_ts;
+        reader->metadata.time_resolution = metadata_2_5.time_resolution;
+        reader->metadata.ts_buffer_elements = metadata_2_5.ts_buffer_elements;
+        reader->metadata.ts_compression = metadata_2_5.ts_compression;
+        reader->metadata.interprocess_compression = metadata_2_5.interprocess_compression;
+        reader->metadata.interprocess_pattern_recognition = metadata_2_5.interprocess_pattern_recognition;
+        reader->metadata.intraprocess_pattern_recognition = metadata_2_5.intraprocess_pattern_recognition;
     } else {
         fread(&reader->metadata, sizeof(reader->metadata), 1, fp);
     }
@@ -133,7 +174,7 @@ void read_metadata(RecorderReader* reader) {
     int start_pos = 0, end_pos = 0;
     int func_id = 0;
 
-    for(end_pos = 0; end_pos < fsize; end_pos++) {
+    for(end_pos = 0; end_pos < fsize && func_id < RECORDER_MAX_FUNCS; end_pos++) {
         if(buf[end_pos] == '\n') {
             memset(reader->func_list[func_id], 0, sizeof(reader->func_list[func_id]));
             memcpy(reader->func_list[func_id], buf+start_pos, end_pos-start_pos);
@@ -147,6 +188,10 @@ void read_metadata(RecorderReader* reader) {
 
                 reader->hdf5_start_idx = func_id;
 
+            if((reader->marker_start_idx==-1) &&
+                (0==strncmp(reader->func_list[func_id], "recorder_", 9)))
+                reader->marker_start_idx = func_id;
+
             func_id++;
         }
     }
@@ -154,6 +199,152 @@ void read_metadata(RecorderReader* reader) {
     fclose(fp);
 }
 
+/*
+ * recorder.sym: "symbol\tobject" of each user function,
+ * one line per id from RECORDER_USER_FUNCTION_START.
+ * Missing if no user function was traced.
+ */
+void read_user_funcs(RecorderReader* reader) {
+    char sym_fname[1096] = {0};
+    sprintf(sym_fname, "%s/recorder.sym", reader->logs_dir);
+    FILE* fp = fopen(sym_fname, "r");
+    if(fp == NULL) return;
+
+    int capacity = 64;
+    reader->user_funcs = malloc(sizeof(char*) * capacity);
+
+    char* line = NULL;
+    size_t n = 0;
+    ssize_t len;
+    while((len = getline(&line, &n, fp)) != -1) {
+        if(len > 0 && line[len-1] == '\n')
+            line[len-1] = 0;
+        // keep the symbol, the object follows the tab
+        char* tab = strchr(line, '\t');
+        if(tab) *tab = 0;
+        if(reader->num_user_funcs == capacity) {
+            capacity *= 2;
+            reader->user_funcs = realloc(reader->user_funcs, sizeof(char*) * capacity);
+        }
+        reader->user_funcs[reader->num_user_funcs++] = strdup(line);
+    }
+    free(line);
+    fclose(fp);
+}
+
+/*
+ * Stack table and maps of one rank, see recorder-call-sites.h
+ */
+typedef struct map_region {
+    uint64_t start, end, offset;
+    char* path;
+} map_region_t;
+
+struct call_site_table {
+    bool      loaded;
+    uint32_t  num_stacks;
+    uint8_t*  depths;       // of stack id i+1
+    uint64_t* addrs;        // metadata.call_sites per stack
+    int           num_regions;
+    map_region_t* regions;
+};
+
+static void load_call_sites(RecorderReader* reader, int rank, struct call_site_table* t) {
+    int max_depth = reader->metadata.call_sites;
+    char fname[1096];
+    t->loaded = true;
+
+    sprintf(fname, "%s/%d.stk", reader->logs_dir, rank);
+    FILE* f = fopen(fname, "rb");
+    if(f) {
+        if(fread(&t->num_stacks, sizeof(uint32_t), 1, f) != 1)
+            t->num_stacks = 0;
+        t->depths = calloc(t->num_stacks, sizeof(uint8_t));
+        t->addrs  = calloc((size_t)t->num_stacks * max_depth, sizeof(uint64_t));
+        for(uint32_t i = 0; i < t->num_stacks; i++) {
+            uint8_t n = 0;
+            if(fread(&n, sizeof(n), 1, f) != 1 || n > max_depth)
+                break;
+            t->depths[i] = n;
+            fread(t->addrs + (size_t)i*max_depth, sizeof(uint64_t), n, f);
+        }
+        fclose(f);
+    }
+
+    sprintf(fname, "%s/%d.maps", reader->logs_dir, rank);
+    f = fopen(fname, "r");
+    if(f) {
+        int capacity = 0;
+        char* line = NULL;
+        size_t n = 0;
+        while(getline(&line, &n, f) != -1) {
+            unsigned long long start, end, offset;
+            char path[1024] = {0};
+            if(sscanf(line, "%llx-%llx %*s %llx %*s %*s %1023[^\n]", &start, &end, &offset, path) != 4 ||
+               path[0] != '/')
+                continue;
+            if(t->num_regions == capacity) {
+                capacity = capacity ? capacity*2 : 64;
+                t->regions = realloc(t->regions, sizeof(map_region_t) * capacity);
+            }
+            map_region_t* r = &t->regions[t->num_regions++];
+            r->start  = start;
+            r->end    = end;
+            r->offset = offset;
+            r->path   = strdup(path);
+        }
+        free(line);
+        fclose(f);
+    }
+}
+
+static struct call_site_table* get_call_sites(RecorderReader* reader, int rank) {
+    if(reader->metadata.call_sites == 0 || rank < 0 || rank >= reader->metadata.total_ranks)
+        return NULL;
+    if(!reader->call_sites)
+        reader->call_sites = calloc(reader->metadata.total_ranks, sizeof(struct call_site_table));
+    struct call_site_table* t = &reader->call_sites[rank];
+    if(!t->loaded)
+        load_call_sites(reader, rank, t);
+    return t;
+}
+
+int recorder_get_call_stack(RecorderReader* reader, int rank, Record* record, const uint64_t** addrs) {
+    struct call_site_table* t = get_call_sites(reader, rank);
+    if(!t || record->stack_id == 0 || record->stack_id > t->num_stacks)
+        return 0;
+    *addrs = t->addrs + (size_t)(record->stack_id-1) * reader->metadata.call_sites;
+    return t->depths[record->stack_id-1];
+}
+
+bool recorder_resolve_address(RecorderReader* reader, int rank, uint64_t addr,
+                              const char** object, uint64_t* offset) {
+    struct call_site_table* t = get_call_sites(reader, rank);
+    if(!t) return false;
+    for(int i = 0; i < t->num_regions; i++) {
+        map_region_t* r = &t->regions[i];
+        if(addr >= r->start && addr < r->end) {
+            *object = r->path;
+            *offset = addr - r->start + r->offset;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void free_call_sites(RecorderReader* reader) {
+    if(!reader->call_sites) return;
+    for(int rank = 0; rank < reader->metadata.total_ranks; rank++) {
+        struct call_site_table* t = &reader->call_sites[rank];
+        free(t->depths);
+        free(t->addrs);
+        for(int i = 0; i < t->num_regions; i++)
+            free(t->regions[i].path);
+        free(t->regions);
+    }
+    free(reader->call_sites);
+}
+
 void recorder_init_reader(const char* logs_dir, RecorderReader *reader) {
     assert(logs_dir);
     assert(reader);
@@ -162,11 +353,13 @@ void recorder_init_reader(const char* logs_dir, RecorderReader *reader) {
     strcpy(reader->logs_dir, logs_dir);
     reader->mpi_start_idx = -1;
     reader->hdf5_start_idx = -1;
+    reader->marker_start_idx = -1;
     reader->prev_tstart = 0.0;
 
     check_version(reader, &reader->trace_version_major, &reader->trace_version_minor);
 
     read_metadata(reader);
+    read_user_funcs(reader);
 
 	int nprocs= reader->metadata.total_ranks;
 
@@ -190,6 +383,8 @@ void recorder_init_reader(const char* logs_dir, RecorderReader *reader) {
 		reader_decode_cst(0, buf_cst, reader->csts[0]);
         fclose(cst_file);
         free(buf_cst);
+        if (reader->trace_version_major == 2 && reader->trace_version_minor < 6)
+            reader_widen_cst_func_ids(reader->csts[0]);
 
 		char ug_metadata_fname[1096] = {0};
 		sprintf(ug_metadata_fname, "%s/ug.mt", reader->logs_dir);
@@ -229,6 +424,8 @@ void recorder_init_reader(const char* logs_dir, RecorderReader *reader) {
                 free(buf_cst);
                 fclose(cst_file);
             }
+            if (reader->trace_version_major == 2 && reader->trace_version_minor < 6)
+                reader_widen_cst_func_ids(reader->csts[rank]);
             
             if (reader->trace_version_major == 2 && reader->trace_version_minor == 3) {
                 reader->cfgs[rank] = (CFG*) malloc(sizeof(CFG));
@@ -269,16 +466,32 @@ void recorder_free_reader(RecorderReader *reader) {
 	free(reader->ugs);
 	free(reader->ug_ids);
 
+    for(int i = 0; i < reader->num_user_funcs; i++)
+        free(reader->user_funcs[i]);
+    free(reader->user_funcs);
+    free_call_sites(reader);
+
     memset(reader, 0, sizeof(*reader));
 }
 
 const char* recorder_get_func_name(RecorderReader* reader, Record* record) {
+    int user_func = record->func_id - RECORDER_USER_FUNCTION_START;
     if(record->func_id == RECORDER_USER_FUNCTION)
-        return record->args[1];
+        return record->arg_count > 1 ? record->args[1] : "user_function";
+    if(user_func >= 0)
+        return user_func < reader->num_user_funcs ? reader->user_funcs[user_func] : "user_function";
     return reader->func_list[record->func_id];
 }
 
+bool recorder_func_traced(RecorderReader* reader, int func_id) {
+    if(func_id < 0 || func_id >= RECORDER_MAX_FUNCS)
+        return false;
+    return reader->metadata.traced_funcs[func_id/8] & (1 << (func_id%8));
+}
+
 int recorder_get_func_type(RecorderReader* reader, Record* record) {
+    if(record->func_id >= RECORDER_USER_FUNCTION_START)
+        return RECORDER_FTRACE;
     if(record->func_id < reader->mpi_start_idx)
         return RECORDER_POSIX;
     if(record->func_id < reader->hdf5_start_idx) {
@@ -287,11 +500,23 @@ int recorder_get_func_type(RecorderReader* reader, Record* record) {
             return RECORDER_MPIIO;
         return RECORDER_MPI;
     }
-    if(record->func_id == RECORDER_USER_FUNCTION)
-        return RECORDER_FTRACE;
+    if(reader->marker_start_idx != -1 && record->func_id >= reader->marker_start_idx)
+        return RECORDER_MARKER;
     return RECORDER_HDF5;
 }
 
+int recorder_region_marker(RecorderReader* reader, Record* record, const char** name) {
+    if(recorder_get_func_type(reader, record) != RECORDER_MARKER || record->arg_count < 1)
+        return 0;
+    const char* func_name = recorder_get_func_name(reader, record);
+    *name = record->args[0];
+    if(strcmp(func_name, "recorder_region_begin") == 0)
+        return 1;
+    if(strcmp(func_name, "recorder_region_end") == 0)
+        return -1;
+    return 0;
+}
+
 void recorder_free_record(Record* r) {
     for(int i = 0; i < r->arg_count; i++)
         free(r->args[i]);
@@ -302,7 +527,315 @@ void recorder_free_record(Record* r) {
 
 #define TERMINAL_START_ID 0
 
-void rule_application(RecorderReader* reader, CFG* cfg, CST* cst, int rule_id, uint32_t* ts_buf,
+/**
+ * Expand the rank patterns of iopr_interprocess() and
+ * iopr_filename_templates(): "%r", "%0Wr", "%{a*r+b}" and
+ * "%0W{a*r+b}", and unescape "%%" (see iopr_escape_args()).
+ * Return NULL if arg has none.
+ */
+char* expand_rank_template(const char* arg, int rank) {
+    if(!strchr(arg, '%'))
+        return NULL;
+
+    size_t cap = strlen(arg) + 64;
+    char* out = calloc(cap, sizeof(char));
+    size_t pos = 0;
+    const char* p = arg;
+    while(*p) {
+        long int a = 1, b = 0;
+        int width = 0, n = 0;
+        const char* q = p + 1;
+        if(*p != '%') {
+            out[pos++] = *p++;
+            continue;
+        }
+        if(*q == '%') {
+            out[pos++] = '%';
+            p = q + 1;
+            continue;
+        }
+        if(*q == '0' && sscanf(q, "%d%n", &width, &n) == 1)
+            q += n;
+        if(*q == 'r') {
+            q += 1;
+        } else if(*q == '{' && sscanf(q, "{%ld*r+%ld}%n", &a, &b, &n) == 2 && n > 0) {
+            q += n;
+        } else {
+            out[pos++] = *p++;
+            continue;
+        }
+        if(pos + 32 + strlen(q) >= cap) {
+            cap = pos + 32 + strlen(q) + 64;
+            out = realloc(out, cap);
+        }
+        pos += sprintf(out+pos, "%0*ld", width, a*rank+b);
+        p = q;
+    }
+    out[pos] = 0;
+    return out;
+}
+
+/**
+ * Interprocess pattern recognition stores offsets (or
+ * offset vector elements) that follow offset = a * rank + b
+ * as "%{a*r+b}", and rank dependent paths as templates, with
+ * literal '%' escaped (see lib/recorder-pattern-recognition.c).
+ * Expand them back into the actual value for this rank.
+ */
+void resolve_rank_patterns(Record* record, int rank) {
+    for(int i = 0; i < record->arg_count; i++) {
+        char* arg = expand_rank_template(record->args[i], rank);
+        if(arg) {
+            free(record->args[i]);
+            record->args[i] = arg;
+        }
+    }
+}
+
+/**
+ * Intraprocess pattern recognition stores the offset
+ * of an offset-carrying call as the difference to the
+ * previous one of the same thread, function and file
+ * (see iopr_delta_code()). Undo it; records must be
+ * visited in the order they were written.
+ */
+void resolve_offset_deltas(RecorderReader* reader, Record* record) {
+    int f = iopr_offset_func_index(recorder_get_func_name(reader, record));
+    if(f == -1)
+        return;
+
+    int file_idx   = iopr_offset_funcs[f].file_arg_idx;
+    int offset_idx = iopr_offset_funcs[f].offset_arg_idx;
+    if(record->arg_count <= offset_idx || record->arg_count <= file_idx)
+        return;
+
+    char* arg = iopr_delta_code(&reader->offset_map, record->tid, record->func_id,
+                                record->args[file_idx], record->args[offset_idx], 1);
+    if(arg) {
+        free(record->args[offset_idx]);
+        record->args[offset_idx] = arg;
+    }
+}
+
+/**
+ * My rank in, and the topology of, each communicator
+ * seen so far. Needed to resolve relative peers.
+ */
+struct peer_comm {
+    char name[32];          // e.g., "0-1", key
+    int  rank;
+    int  ndims;
+    int  dims[IOPR_MAX_DIMS];
+    int  periods[IOPR_MAX_DIMS];
+    UT_hash_handle hh;
+};
+
+/*
+ * Functions that create a communicator store
+ * it and my rank in it as the last two arguments.
+ */
+static const char* comm_create_funcs[] = {
+    "MPI_Comm_split", "MPI_Comm_split_type", "MPI_Comm_create",
+    "MPI_Comm_dup", "MPI_Cart_create", "MPI_Cart_sub",
+};
+
+/*
+ * Point-to-point functions, their peer argument(s)
+ * and communicator argument.
+ */
+static const struct {
+    const char* func;
+    int peer_idx[2];
+    int comm_idx;
+} p2p_funcs[] = {
+    {"MPI_Send",  {3, -1}, 5},    {"MPI_Ssend", {3, -1}, 5},
+    {"MPI_Isend", {3, -1}, 5},    {"MPI_Recv",  {3, -1}, 5},
+    {"MPI_Irecv", {3, -1}, 5},    {"MPI_Sendrecv", {3, 8}, 10},
+};
+
+static void parse_int_vector(const char* str, int* vals, int count) {
+    const char* p = str + 1;    // skip '['
+    for(int i = 0; i < count; i++) {
+        vals[i] = (int) strtol(p, (char**)&p, 10);
+        p++;                    // skip ',' or ']'
+    }
+}
+
+/**
+ * Resolve peers stored relative to the caller
+ * ("@+d" or "@[dx,dy,...]", see peer2str() in
+ * lib/recorder-mpi.c) into absolute ranks.
+ */
+void resolve_relative_peers(RecorderReader* reader, Record* record, int rank) {
+    const char* func = recorder_get_func_name(reader, record);
+
+    for(int f = 0; f < sizeof(comm_create_funcs)/sizeof(char*); f++) {
+        if(strcmp(func, comm_create_funcs[f]) != 0 || record->arg_count < 2)
+            continue;
+        const char* name = record->args[record->arg_count-2];
+        struct peer_comm* comm = NULL;
+        HASH_FIND_STR(reader->peer_comms, name, comm);
+        if(!comm) {
+            comm = calloc(1, sizeof(struct peer_comm));
+            strncpy(comm->name, name, sizeof(comm->name)-1);
+            HASH_ADD_STR(reader->peer_comms, name, comm);
+        }
+        comm->rank = atoi(record->args[record->arg_count-1]);
+        comm->ndims = 0;
+        if(strcmp(func, "MPI_Cart_create") == 0 && record->args[2][0] == '[') {
+            comm->ndims = atoi(record->args[1]);
+            if(comm->ndims > IOPR_MAX_DIMS)
+                comm->ndims = 0;
+            parse_int_vector(record->args[2], comm->dims, comm->ndims);
+            parse_int_vector(record->args[3], comm->periods, comm->ndims);
+        }
+        return;
+    }
+
+    for(int f = 0; f < sizeof(p2p_funcs)/sizeof(p2p_funcs[0]); f++) {
+        if(strcmp(func, p2p_funcs[f].func) != 0)
+            continue;
+        const char* comm_name = record->args[p2p_funcs[f].comm_idx];
+        struct peer_comm* comm = NULL;
+        int my_rank = 0;
+        if(strcmp(comm_name, "MPI_COMM_WORLD") == 0) {
+            my_rank = rank;
+        } else if(strcmp(comm_name, "MPI_COMM_SELF") != 0) {
+            HASH_FIND_STR(reader->peer_comms, comm_name, comm);
+            if(!comm) return;
+            my_rank = comm->rank;
+        }
+
+        for(int k = 0; k < 2; k++) {
+            int idx = p2p_funcs[f].peer_idx[k];
+            if(idx == -1 || record->args[idx][0] != '@')
+                continue;
+            int peer;
+            if(record->args[idx][1] == '[' && comm && comm->ndims > 0) {
+                int disp[IOPR_MAX_DIMS];
+                parse_int_vector(record->args[idx]+1, disp, comm->ndims);
+                // ranks are laid out in row-major order
+                int stride = 1;
+                peer = 0;
+                for(int i = comm->ndims-1; i >= 0; i--) {
+                    int c = (my_rank / stride) % comm->dims[i] + disp[i];
+                    if(comm->periods[i])
+                        c = ((c % comm->dims[i]) + comm->dims[i]) % comm->dims[i];
+                    peer += c * stride;
+                    stride *= comm->dims[i];
+                }
+            } else {
+                peer = my_rank + atoi(record->args[idx]+1);
+            }
+            free(record->args[idx]);
+            record->args[idx] = calloc(16, sizeof(char));
+            sprintf(record->args[idx], "%d", peer);
+        }
+        return;
+    }
+}
+
+/**
+ * Asynchronous requests posted and not yet completed:
+ * nonblocking MPI-IO requests keyed by the request handle,
+ * AIO requests by "aio:<aiocb>" and io_uring SQEs by
+ * "<ring>:<user_data>".
+ */
+struct pending_request {
+    char   request[64];
+    double tstart;
+    UT_hash_handle hh;
+};
+
+static void post_request(RecorderReader* reader, const char* request, double tstart) {
+    struct pending_request* req = NULL;
+    HASH_FIND_STR(reader->pending_requests, request, req);
+    if(!req) {
+        req = malloc(sizeof(struct pending_request));
+        strncpy(req->request, request, sizeof(req->request)-1);
+        req->request[sizeof(req->request)-1] = 0;
+        HASH_ADD_STR(reader->pending_requests, request, req);
+    }
+    req->tstart = tstart;
+}
+
+static void complete_request(RecorderReader* reader, const char* request, Record* record) {
+    struct pending_request* req = NULL;
+    HASH_FIND_STR(reader->pending_requests, request, req);
+    if(req) {
+        record->tstart = req->tstart;
+        HASH_DEL(reader->pending_requests, req);
+        free(req);
+    }
+}
+
+/**
+ * MPI_File_request_complete records are written by the
+ * tracer when the Wait/Test call that completes a request
+ * of MPI_File_iread*, MPI_File_iwrite* returns, with both
+ * timestamps set to that point. Move tstart back to the
+ * start of the posting call, so the record covers the
+ * whole life of the request. Needs the timestamps, and
+ * records visited in the order they were written.
+ *
+ * The same goes for io_uring_complete records and the SQEs
+ * of io_uring_submit*, and for aio_return and the
+ * aio_read/aio_write that posted the request.
+ */
+void resolve_request_interval(RecorderReader* reader, Record* record) {
+    const char* func = recorder_get_func_name(reader, record);
+    char key[64];
+
+    // the request is the second last argument of
+    // the posting calls, the last one is the byte count
+    if(strncmp(func, "MPI_File_iread", 14) == 0 || strncmp(func, "MPI_File_iwrite", 15) == 0) {
+        if(record->arg_count < 2)
+            return;
+        post_request(reader, record->args[record->arg_count-2], record->tstart);
+        return;
+    }
+
+    if(strcmp(func, "MPI_File_request_complete") == 0 && record->arg_count > 1) {
+        complete_request(reader, record->args[1], record);
+        return;
+    }
+
+    // aio_read/aio_write(file, offset, nbytes, aiocb), aio_return(file, aiocb)
+    if((strcmp(func, "aio_read") == 0 || strcmp(func, "aio_write") == 0) && record->arg_count > 3) {
+        snprintf(key, sizeof(key), "aio:%s", record->args[3]);
+        post_request(reader, key, record->tstart);
+        return;
+    }
+    if(strcmp(func, "aio_return") == 0 && record->arg_count > 1) {
+        snprintf(key, sizeof(key), "aio:%s", record->args[1]);
+        complete_request(reader, key, record);
+        return;
+    }
+
+    // io_uring_submit(ring, files, file index, op, offset, bytes, user_data, ...)
+    if(strncmp(func, "io_uring_submit", 15) == 0 && record->arg_count > 6) {
+        const char* p = record->args[6];
+        if(*p++ != '[')
+            return;
+        while(*p && *p != ']') {
+            size_t len = strcspn(p, ",]");
+            snprintf(key, sizeof(key), "%s:%.*s", record->args[0], (int)len, p);
+            post_request(reader, key, record->tstart);
+            p += len;
+            if(*p == ',')
+                p++;
+        }
+        return;
+    }
+    // io_uring_complete(file, ring, user_data, op, res)
+    if(strcmp(func, "io_uring_complete") == 0 && record->arg_count > 2) {
+        snprintf(key, sizeof(key), "%s:%s", record->args[1], record->args[2]);
+        complete_request(reader, key, record);
+    }
+}
+
+void rule_application(RecorderReader* reader, CFG* cfg, CST* cst, int rule_id, int rank,
+                      uint32_t** ts_buf, uint32_t** vs_buf,
                       void (*user_op)(Record*, void*), void* user_arg, int free_record) {
 
     RuleHash *rule = NULL;
@@ -317,13 +850,36 @@ void rule_application(RecorderReader* reader, CFG* cfg, CST* cst, int rule_id, u
             for(int j = 0; j < sym_exp; j++) {
 
                 Record* record = reader_cs_to_record(&(cst->cs_list[sym_val]));
-
-                // Fill in timestamps
-                uint32_t ts[2] = {ts_buf[0], ts_buf[1]};
-                ts_buf += 2;
-                record->tstart = ts[0] * reader->metadata.time_resolution + reader->prev_tstart;
-                record->tend   = ts[1] * reader->metadata.time_resolution + reader->prev_tstart;
-                reader->prev_tstart = record->tstart;
+                // user functions may share names with func_list
+                bool builtin = record->func_id < RECORDER_MAX_FUNCS;
+                if (reader->metadata.value_streams && builtin) {
+                    int schema = vs_schema_index(recorder_get_func_name(reader, record));
+                    if (schema != -1)
+                        vs_decode_args(vs_buf, &reader->vs_state, schema, record->func_id,
+                                       record->args, record->arg_count);
+                }
+                if (reader->metadata.return_values && builtin) {
+                    int ret_idx = vs_return_index(recorder_get_func_name(reader, record));
+                    if (ret_idx != -1)
+                        record->res = vs_decode_return(vs_buf, ret_idx, record->args, record->arg_count);
+                }
+                if (reader->metadata.interprocess_pattern_recognition)
+                    resolve_rank_patterns(record, rank);
+                if (reader->metadata.intraprocess_pattern_recognition)
+                    resolve_offset_deltas(reader, record);
+                if (reader->metadata.relative_peers)
+                    resolve_relative_peers(reader, record, rank);
+
+                // Fill in timestamps, ts_buf is a cursor shared
+                // by all levels of the recursion
+                if (reader->metadata.ts_prediction)
+                    ts_decode_record_predicted(ts_buf, &reader->ts_predictor, sym_val,
+                                               reader->metadata.time_resolution,
+                                               &reader->prev_tstart, &record->tstart, &record->tend);
+                else
+                    ts_decode_record(ts_buf, reader->metadata.time_resolution,
+                                     &reader->prev_tstart, &record->tstart, &record->tend);
+                resolve_request_interval(reader, record);
 
                 user_op(record, user_arg);
 
@@ -332,14 +888,18 @@ void rule_application(RecorderReader* reader, CFG* cfg, CST* cst, int rule_id, u
             }
         } else {                            // non-terminal (i.e., rule)
             for(int j = 0; j < sym_exp; j++)
-                rule_application(reader, cfg, cst, sym_val, ts_buf, user_op, user_arg, free_record);
+                rule_application(reader, cfg, cst, sym_val, rank, ts_buf, vs_buf, user_op, user_arg, free_record);
         }
     }
 }
 
 // caller must free the timestamp
 // buffer after use
-uint32_t* read_timestamp_file(RecorderReader* reader, int rank) {
+/*
+ * Also reads the value stream, which follows the timestamps
+ * of each rank (see ts_write_out() in lib/recorder-timestamps.c).
+ */
+uint32_t* read_timestamp_file(RecorderReader* reader, int rank, uint32_t** vs_buf) {
 
     char ts_fname[1096] = {0};
     uint32_t* ts_buf = NULL;
@@ -380,9 +940,18 @@ uint32_t* read_timestamp_file(RecorderReader* reader, int rank) {
     // finally read to the buffer
     if (reader->metadata.ts_compression) {
         ts_buf = (uint32_t*) read_zlib(ts_file);
+        if (reader->metadata.value_streams || reader->metadata.return_values)
+            *vs_buf = (uint32_t*) read_zlib(ts_file);
     } else {
         ts_buf = (uint32_t*) malloc(buf_sizes[rank]); 
         fread(ts_buf, 1, buf_sizes[rank], ts_file);
+        if ((reader->metadata.value_streams || reader->metadata.return_values) &&
+            buf_sizes[rank] >= sizeof(size_t)) {
+            size_t vs_size;
+            memcpy(&vs_size, (char*)ts_buf + buf_sizes[rank] - sizeof(size_t), sizeof(size_t));
+            *vs_buf = (uint32_t*) malloc(vs_size);
+            memcpy(*vs_buf, (char*)ts_buf + buf_sizes[rank] - sizeof(size_t) - vs_size, vs_size);
+        }
     }
     fclose(ts_file);
     return ts_buf;
@@ -396,12 +965,33 @@ void decode_records_core(RecorderReader *reader, int rank,
 	CFG* cfg = reader_get_cfg(reader, rank);
 
     reader->prev_tstart = 0.0;
-
-    uint32_t* ts_buf = read_timestamp_file(reader, rank);
-
-    rule_application(reader, cfg, cst, -1, ts_buf, user_op, user_arg, free_record);
-
+    ts_predictor_init(&reader->ts_predictor);
+    reader->offset_map = NULL;
+    reader->peer_comms = NULL;
+    reader->pending_requests = NULL;
+
+    vs_state_init(&reader->vs_state);
+    uint32_t* vs_buf = NULL;
+    uint32_t* ts_buf = read_timestamp_file(reader, rank, &vs_buf);
+
+    uint32_t* ts_cursor = ts_buf;
+    uint32_t* vs_cursor = vs_buf;
+    rule_application(reader, cfg, cst, -1, rank, &ts_cursor, &vs_cursor, user_op, user_arg, free_record);
+
+    ts_predictor_free(&reader->ts_predictor);
+    iopr_free_offset_map(&reader->offset_map);
+    struct peer_comm *comm, *tmp;
+    HASH_ITER(hh, reader->peer_comms, comm, tmp) {
+        HASH_DEL(reader->peer_comms, comm);
+        free(comm);
+    }
+    struct pending_request *req, *req_tmp;
+    HASH_ITER(hh, reader->pending_requests, req, req_tmp) {
+        HASH_DEL(reader->pending_requests, req);
+        free(req);
+    }
     free(ts_buf);
+    free(vs_buf);
 }
 
 // Decode all records for one rank
@@ -2,6 +2,8 @@
 #define _RECORDER_READER_H_
 #include <stdbool.h>
 #include "recorder-logger.h"
+#include "recorder-timestamps.h"
+#include "recorder-value-streams.h"
 
 #define POSIX_SEMANTICS 	0
 #define COMMIT_SEMANTICS 	1
@@ -35,13 +37,24 @@ typedef struct RecorderReader_t {
 
     RecorderMetadata metadata;
 
-    char func_list[256][64];
+    char func_list[RECORDER_MAX_FUNCS][64];
     char logs_dir[1024];
 
     int mpi_start_idx;
     int hdf5_start_idx;
+    int marker_start_idx;   // -1 for traces without markers
+
+    char** user_funcs;      // symbol of user function id RECORDER_USER_FUNCTION_START+i
+    int    num_user_funcs;
+
+    struct call_site_table* call_sites;     // per rank, loaded on first use
 
     double prev_tstart;
+    TimestampPredictor ts_predictor;    // used when metadata.ts_prediction is set
+    struct offset_map* offset_map;      // used when metadata.intraprocess_pattern_recognition is set
+    struct peer_comm*  peer_comms;      // used when metadata.relative_peers is set
+    ValueStreamState   vs_state;        // used when metadata.value_streams is set
+    struct pending_request* pending_requests;   // nonblocking MPI-IO requests not yet completed
 
     // in the case of metadata.interprocess_compression = true
     // store the unique grammars in ugs.
@@ -69,7 +82,7 @@ typedef struct RecorderReader_t {
 typedef struct PyRecord_t {
     double tstart, tend;
     unsigned char call_depth;
-    unsigned char func_id;
+    uint16_t func_id;
     int tid;
     unsigned char arg_count;
     char **args;
@@ -98,6 +111,14 @@ void recorder_decode_records2(RecorderReader* reader, int rank,
 
 const char* recorder_get_func_name(RecorderReader* reader, Record* record);
 
+/*
+ * Whether func_list[func_id] was wrapped while tracing.
+ * Functions not traced (layer off, or left out by
+ * RECORDER_FUNCTION_INCLUSION/EXCLUSION) have no records
+ * even if the application called them.
+ */
+bool recorder_func_traced(RecorderReader* reader, int func_id);
+
 /*
  * Return one of the follows (mutual exclusive) :
  *  - RECORDER_POSIX
@@ -105,9 +126,42 @@ const char* recorder_get_func_name(RecorderReader* reader, Record* record);
  *  - RECORDER_MPI
  *  - RECORDER_HDF5
  *  - RECORDER_FTRACE
+ *  - RECORDER_MARKER
  */
 int recorder_get_func_type(RecorderReader* reader, Record* record);
 
+/*
+ * Region markers of recorder_region_begin/end(), see
+ * include/recorder-control.h. Returns 1 for a begin,
+ * -1 for an end and 0 for any other record; *name is
+ * set to the region name for the first two.
+ *
+ * Regions nest per thread, so to attribute records to
+ * phases keep a stack of names per (rank, tid) while
+ * visiting the records of recorder_decode_records().
+ */
+int recorder_region_marker(RecorderReader* reader, Record* record, const char** name);
+
+/*
+ * Call site of a record of the rank, if traced with
+ * RECORDER_CALL_SITES. Sets *addrs to the return addresses,
+ * innermost first, and returns their number, 0 if none.
+ */
+int recorder_get_call_stack(RecorderReader* reader, int rank, Record* record, const uint64_t** addrs);
+
+/*
+ * Object (file path) an address of the rank belongs to and
+ * the file offset of the address, from the copy of
+ * /proc/self/maps saved with the trace. Returns false if
+ * the address is not in a mapped file.
+ *
+ * For shared objects and PIE executables the offset can be
+ * passed to `addr2line -f -e <object>`; subtract 1 from a
+ * return address to land on the call instruction.
+ */
+bool recorder_resolve_address(RecorderReader* reader, int rank, uint64_t addr,
+                              const char** object, uint64_t* offset);
+
 #ifdef __cplusplus
 }
 #endif
@@ -22,7 +22,7 @@ void print_cst(RecorderReader* reader, CST* cst) {
         const char* func_name = recorder_get_func_name(reader, record);
         printf("%s(", func_name);
 
-        bool user_func = (recorder_get_func_type(reader, record) == RECORDER_USER_FUNCTION);
+        bool user_func = (recorder_get_func_type(reader, record) == RECORDER_FTRACE);
         for(int arg_id = 0; !user_func && arg_id < record->arg_count; arg_id++) {
             char *arg = record->args[arg_id];
             printf(" %s", arg);
@@ -35,8 +35,8 @@ void print_cst(RecorderReader* reader, CST* cst) {
 
 void print_statistics(RecorderReader* reader, CST* cst) {
 
-    int unique_signature[256] = {0};
-    int call_count[256] = {0};
+    int unique_signature[RECORDER_MAX_FUNCS] = {0};
+    int call_count[RECORDER_MAX_FUNCS] = {0};
     int mpi_count = 0, mpiio_count = 0, hdf5_count = 0, posix_count = 0;
 
     for(int i = 0; i < cst->entries; i++) {
@@ -53,8 +53,10 @@ void print_statistics(RecorderReader* reader, CST* cst) {
         if(type == RECORDER_POSIX)
             posix_count += cst->cs_list[i].count;
 
-        unique_signature[record->func_id]++;
-        call_count[record->func_id] += cst->cs_list[i].count;
+        if(record->func_id < RECORDER_MAX_FUNCS) {
+            unique_signature[record->func_id]++;
+            call_count[record->func_id] += cst->cs_list[i].count;
+        }
 
         recorder_free_record(record);
     }
@@ -63,9 +65,9 @@ void print_statistics(RecorderReader* reader, CST* cst) {
            total, posix_count, mpi_count, mpiio_count, hdf5_count);
 
     printf("\n%-25s %18s %18s\n", "Func", "Unique Signature", "Total Call Count");
-    for(int i = 0; i < 256; i++) {
+    for(int i = 0; i < RECORDER_MAX_FUNCS; i++) {
         if(unique_signature[i] > 0) {
-            printf("%-25s %18d %18d\n", func_list[i], unique_signature[i], call_count[i]);
+            printf("%-25s %18d %18d\n", reader->func_list[i], unique_signature[i], call_count[i]);
         }
     }
 }
@@ -91,6 +93,9 @@ void print_metadata(RecorderReader* reader) {
     printf("Interprocess compression: %s\n", meta->interprocess_compression?"True":"False");
     printf("Intraprocess pattern recognition: %s\n", meta->intraprocess_pattern_recognition?"True":"False");
     printf("Interprocess pattern recognition: %s\n", meta->interprocess_pattern_recognition?"True":"False");
+    printf("Relative peers: %s\n", meta->relative_peers?"True":"False");
+    printf("Value streams: %s\n", meta->value_streams?"True":"False");
+    printf("Return values: %s\n", meta->return_values?"True":"False");
     printf("===========================================\n\n");
 }
 
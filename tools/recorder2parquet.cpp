@@ -112,7 +112,7 @@ void handle_one_record(Record* record, void* arg) {
     writer->tstartBuilder.Append(record->tstart);
     writer->tendBuilder.Append(record->tend);
     int cat = recorder_get_func_type(&reader, record);
-    if (cat == RECORDER_FTRACE){
+    if (record->func_id == RECORDER_USER_FUNCTION){
         writer->func_idBuilder.Append(record->args[0]);
         record->arg_count = 0;
     }else {
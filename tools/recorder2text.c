@@ -25,7 +25,7 @@ int digits_count(int n) {
 void write_to_textfile(Record *record, void* arg) {
     FILE* f = (FILE*) arg;
 
-    bool user_func = (record->func_id == RECORDER_USER_FUNCTION);
+    bool user_func = (recorder_get_func_type(&reader, record) == RECORDER_FTRACE);
 
     const char* func_name = recorder_get_func_name(&reader, record);
 